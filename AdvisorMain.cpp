@@ -7,10 +7,15 @@
 #include "CSVReader.h"
 #include "Calculator.h"
 #include "AdvisorMain.h"
+#include "Metrics.h"
 
 // AdvisorMain constructor
-// Initializes member variables to their default values
-AdvisorMain::AdvisorMain() = default;
+// Initializes member variables to their default values and starts loading the data file
+AdvisorMain::AdvisorMain(const std::string &dataFile, std::size_t memoryBudget, bool blockStorage)
+        : dataset(LoadOptions{LoadMode::parallel, CSVLOADTHREADS, true, CSVFOLLOW, nullptr, blockStorage},
+                  memoryBudget) {
+    dataset.load(dataFile);
+}
 
 std::string AdvisorMain::readUserCommand() {
     // variable to store the line of input from the user
@@ -71,6 +76,16 @@ void AdvisorMain::handleUserCommand(std::string &userCommand){
         // print the average value of the specified product over a given number of timesteps
         printProductAvgOfTypeOverTimesteps(cmd);
     } 
+    else if (cmd[0] == "vwap" || cmd[0] == "volume" || cmd[0] == "notional"){
+        // if the command is "vwap", "volume" or "notional"
+        // print the volume-weighted figure of the specified product
+        printProductVolumeOfType(cmd);
+    } 
+    else if (cmd[0] == "best" || cmd[0] == "spread" || cmd[0] == "mid" || cmd[0] == "depth"){
+        // if the command is "best", "spread", "mid" or "depth"
+        // print the top of the book or its price levels for the specified product
+        printProductLadderOfType(cmd);
+    } 
     else if (cmd[0] == "predict"){
         // if the command is "predict"
         // predict the next maximum or minimum value of the specified product
@@ -95,6 +110,21 @@ void AdvisorMain::handleUserCommand(std::string &userCommand){
         // print the list of current orders of the specified type (bid or ask)
         printAllCurrentOrdersOfType(cmd[1]);
     } 
+    else if (cmd[0] == "backtest"){
+        // if the command is "backtest"
+        // score every prediction model over the whole dataset
+        printBacktest(cmd);
+    } 
+    else if (cmd[0] == "stats"){
+        // if the command is "stats"
+        // print what has been measured so far
+        printStats();
+    } 
+    else if (cmd[0] == "load"){
+        // if the command is "load"
+        // load another data file, or report on the loads
+        loadDataFile(cmd);
+    } 
     else if (cmd[0] == "exit"){
         // if the command is "exit"
         // terminate the program gracefully
@@ -128,6 +158,10 @@ void AdvisorMain::userPrompt(){
 
         // read the user's command
         userCommand = readUserCommand();
+        // pick up the orders appended to the data file in the meantime (when following it), and find the
+        // current time again in case the time steps were renumbered, or the file was replaced
+        if (dataset.follow() > 0)
+            currentTime = source(LoadStage::ready).book->findTime(currentTime.first);
         // handle the user's command
         handleUserCommand(userCommand);
 
@@ -136,10 +170,7 @@ void AdvisorMain::userPrompt(){
 
 
 void AdvisorMain::init() {
-    if (currentTime.first.empty()) {
-        // initialize the current time to the earliest time step in the order book
-        currentTime = {orderBook.getEarliestTime(), 0}; 
-    }
+    // the current time starts at the earliest time step once the data is there, see source()
     try {
         // prompt the user for a command
         userPrompt();
@@ -155,6 +186,30 @@ void AdvisorMain::init() {
     }
 }
 
+std::size_t AdvisorMain::runBatch(std::istream &input, std::ostream &output, const BatchOptions &options) {
+    // a script needs the whole book, and always starts at its earliest time step
+    QuerySource loaded = dataset.get(LoadStage::ready);
+    if (!loaded)
+        throw std::runtime_error("No data loaded!");
+    currentTime = QueryEngine{loaded}.start();
+    return BatchRunner::run(loaded, currentTime, input, output, options);
+}
+
+void AdvisorMain::serve(const ServerOptions &options) {
+    QuerySource loaded = dataset.get(LoadStage::ready);
+    if (!loaded)
+        throw std::runtime_error("No data loaded!");
+    QueryServer server{loaded, options};
+    server.run();
+}
+
+void AdvisorMain::runBacktest(std::ostream &output, const BatchOptions &options) {
+    QuerySource loaded = dataset.get(LoadStage::ready);
+    if (!loaded)
+        throw std::runtime_error("No data loaded!");
+    Backtest::write(output, Backtest::run(loaded, options.threads), options.format);
+}
+
 void AdvisorMain::printHelp() {
     // print a message to the console
     std::cout << BOTPROMPT << "The available commands are:" << std::endl;
@@ -178,206 +233,129 @@ void AdvisorMain::printHelpForCmd(const std::string &cmd) {
 }
 
 void AdvisorMain::printAvailableProducts() {
-    // flag to aid in comma printing logic (no comma before first product etc.)
-    bool first = true; 
-
-    // iterate through the list of products
-    for (const std::string &p: orderBook.getProducts()) {
-        if (!first) {
-            // if this is not the first product
-            // print a comma
-            std::cout << ',';
-        } 
-        else {
-            // if this is the first product
-            // print a prompt
-            std::cout << BOTPROMPT;
-            // set the flag to false
-            first = false;
-        }
-        // print the product name
-        std::cout << p;
-    }
-    // print a newline
-    std::cout << std::endl;
+    // the engine lists the products comma separated
+    runQuery({"prod"});
 }
 
 void AdvisorMain::printProductMinMaxOfType(const std::vector<std::string> &cmd) {
-    if (cmd.size() < 3) // must be something like '<min/max> <product> <bid/ask>'
-        throw std::invalid_argument("Invalid arguments to 'min'/'max'");
-
-    // the first argument specifies whether to find the minimum or maximum value
-    std::string min_or_max = cmd[0];
-
-    // the second argument specifies the product
-    std::string product = cmd[1];
-
-    // the third argument specifies the order type (bid or ask)
-    std::string orderType = cmd[2];
-
-    // verify that the product specified by the user actually exists
-    auto products = orderBook.getProducts();
-    if (!orderBook.checkProductExists(product)) {
-        // print an error message
-        std::cout << "Unknown product: " << product << std::endl;
-        // throw an exception
-        throw std::invalid_argument("Unknown product");
-    }
-
-    // verify that the order type specified by the user is a valid one
-    OrderBookType orderBookType;
-    // if the order type is valid
-    if (orderBook.isValidOrderType(orderType)) {
-        // retrieve the corresponding OrderBookType object
-        orderBookType = orderBook.orderBookTypes[orderType];
-    } 
-    // if the order type is not valid
-    else {
-        // print an error message
-        std::cout << "Invalid argument for <bid/ask>: " << orderType << std::endl;
-        // throw an exception
-        throw std::invalid_argument("Invalid argument for <bid/ask>");
-    }
-
-    // retrieve the orders of the specified type and product at the current time
-    std::vector<OrderBookEntry> orders = orderBook.getOrders(orderBookType, product, currentTime.first);
-
-    // variable to store the minimum or maximum price
-    double price;
-
-    // if the user wants to find the minimum price
-    if (min_or_max == "min"){
-        // find the minimum price
-        price = Calculator::getLowPrice(orders);
-    }
-    // if the user wants to find the maximum price
-    else if (min_or_max == "max"){
-        // find the maximum price
-        price = Calculator::getHighPrice(orders);
-    }
-    // if the user specified an invalid argument for min/max
-    else{
-        throw std::invalid_argument("Invalid argument for <min/max>");
-    }
-
-    // print the result to the console
-    std::cout << BOTPROMPT << "The " << min_or_max << " " << orderType << " for " << product << " is " << price << std::endl;
+    // must be something like '<min/max> <product> <bid/ask> [<window>]'
+    runQuery(cmd);
 }
 
 void AdvisorMain::printProductAvgOfTypeOverTimesteps(const std::vector<std::string> &cmd) {
-    // if there are not enough arguments, throw an exception
-    if (cmd.size() < 4) // must be something like 'avg <product> <ask/bid> <timesteps>'
-        throw std::invalid_argument("Invalid arguments to 'avg'");
+    // must be something like 'avg <product> <ask/bid> <timesteps/window>'
+    runQuery(cmd);
+}
 
-    // the second argument specifies the product
-    std::string product = cmd[1];
-    // the third argument specifies the order type (bid or ask)
-    std::string orderType = cmd[2];
+void AdvisorMain::printProductVolumeOfType(const std::vector<std::string> &cmd) {
+    // must be something like '<vwap/volume/notional> <product> <ask/bid> [<timesteps/window>]'
+    runQuery(cmd);
+}
 
+void AdvisorMain::printProductLadderOfType(const std::vector<std::string> &cmd) {
+    // must be something like 'best <product> <ask/bid>', '<spread/mid> [<product>]' or
+    // 'depth <product> <ask/bid> [<levels>]'
+    runQuery(cmd);
+}
 
-    int timeSteps;
+void AdvisorMain::predictProductNextMaxMinOfType(const std::vector<std::string> &cmd) {
+    // must be something like 'predict <min/max> <product> <bid/ask> [<model>]'
+    runQuery(cmd);
+}
+
+void AdvisorMain::printBacktest(const std::vector<std::string> &cmd) {
+    // the whole dataset is needed; a day of a catalog that can't be read ends the backtest
+    QuerySource loaded = source(LoadStage::ready);
+    std::vector<BacktestScore> scores;
     try {
-        // the fourth argument specifies the number of time steps
-        timeSteps = std::stoi(cmd[3]);
-    } 
-    catch (const std::exception &e) {
-        std::cout << "Bad value for 'timesteps' when calling 'avg': " << cmd[3] << std::endl;
-        throw;
+        scores = Backtest::run(loaded);
+    } catch (const std::runtime_error &e) {
+        throw std::invalid_argument(std::string("Couldn't load the data for this command: ") + e.what());
     }
 
-    // verify that the product specified by the user actually exists
-    if (!orderBook.checkProductExists(product)) {
-        // print an error message
-        std::cout << "Unknown product: " << product << std::endl;
-        // throw an exception
-        throw std::invalid_argument("Unknown product");
+    // one line per (product, side, min/max, model), for every product or just the one asked for
+    if (cmd.size() > 1 && std::none_of(scores.begin(), scores.end(), [&cmd](const BacktestScore &score) {
+        return score.product == cmd[1];
+    }))
+        throw std::invalid_argument("Unknown product: " + cmd[1]);
+    std::cout << BOTPROMPT << "product side min/max model: predictions, MAE, RMSE, bias" << std::endl;
+    for (const BacktestScore &score: scores) {
+        if (cmd.size() > 1 && score.product != cmd[1])
+            continue;
+        std::cout << score.product << " " << OrderBookEntry::orderBookTypeToString(score.type) << " "
+                  << (score.max ? "max" : "min") << " " << Backtest::modelName(score.model) << ": "
+                  << score.predictions << ", " << score.mae() << ", " << score.rmse() << ", " << score.bias()
+                  << std::endl;
     }
+}
 
-    // verify that the order type specified by the user is a valid one
-    OrderBookType orderBookType;
-    // if the order type is valid
-    if (orderBook.isValidOrderType(orderType)) {
-        // retrieve the corresponding OrderBookType object
-        orderBookType = orderBook.orderBookTypes[orderType];
-    } 
-    // if the order type is not valid
-    else {
-        // print an error message
-        std::cout << "Invalid argument for <bid/ask>: " << orderType << std::endl;
-        // throw an exception
-        throw std::invalid_argument("Invalid argument for <bid/ask>");
-    }
+void AdvisorMain::printStats() {
+    std::cout << BOTPROMPT << dataset.status() << std::endl;
+    for (const std::string &line: Metrics::report())
+        std::cout << line << std::endl;
+}
 
-    // retrieve all orders of the specified type and product
-    std::vector<OrderBookEntry> orders = orderBook.getOrders(orderBookType, product);
-    // sort the orders by ascending timestamp
-    std::sort(orders.begin(), orders.end(), OrderBookEntry::compareByTimestampAsc);
-
-    // variables to store the number of time steps to consider and the number to skip
-    int timeStepsBack, timeStepsSkip;
-
-    // if the requested number of time steps is further back than the current time step
-    if (timeSteps > currentTime.second) {
-        // consider only the current time step
-        timeStepsBack = std::max(currentTime.second, 1);
-        timeStepsSkip = 0;
-        std::cout << BOTPROMPT << "number of timesteps (" << timeSteps << ") is too far back." << std::endl;
-        std::cout << BOTPROMPT << "current step is " << timeStepsBack << ", therefore the maximum amount of "
-                  << timeStepsBack << " timesteps will be used." << std::endl;
-    } else {
-        timeStepsBack = timeSteps;
-        timeStepsSkip = std::max(currentTime.second - timeSteps, 0);
+void AdvisorMain::loadDataFile(const std::vector<std::string> &cmd) {
+    // without a file name, report on the loads
+    if (cmd.size() < 2) {
+        std::cout << BOTPROMPT << dataset.status() << std::endl;
+        return;
     }
-
-    std::vector<OrderBookEntry> ordersBack;
-    ordersBack = std::vector<OrderBookEntry>(orders.begin() + timeStepsSkip, orders.begin() + timeStepsBack);
-
-    double calculatedAvg = Calculator::calculateAveragePriceOfOrders(ordersBack);
-    std::cout << BOTPROMPT << "The average " << product << " " << orderType << " price over the last " << timeStepsBack
-              << " timesteps was " << calculatedAvg << std::endl;
+    if (dataset.load(cmd[1]))
+        std::cout << BOTPROMPT << "Loading " << cmd[1] << " in the background" << std::endl;
 }
 
-void AdvisorMain::predictProductNextMaxMinOfType(const std::vector<std::string> &cmd) {
-    std::string minOrMax = cmd[1];
-    std::string product = cmd[2];
-    std::string orderType = cmd[3];
-
-    if (minOrMax != "min" && minOrMax != "max")
-        throw std::invalid_argument("Invalid argument for <min/max>");
-
-    // verify product passed by user actually exists
-    if (!orderBook.checkProductExists(product)) {
-        std::cout << "Unknown product: " << product << std::endl;
-        throw std::invalid_argument("Unknown product");
+QuerySource AdvisorMain::source(LoadStage stage) {
+    QuerySource loaded = dataset.get(stage);
+    if (!loaded)
+        throw std::invalid_argument("No data loaded, use load <file>");
+
+    // a new book has its own time steps, so start again from its earliest one
+    if (generation != dataset.generation()) {
+        generation = dataset.generation();
+        try {
+            currentTime = QueryEngine{loaded}.start();
+        } catch (const QueryError &e) {
+            // e.g. the first day of a catalog couldn't be read
+            if (!e.detail().empty())
+                std::cout << e.detail() << std::endl;
+            throw;
+        }
     }
+    return loaded;
+}
 
-    // verify order type passed by user is a valid one
-    OrderBookType orderBookType;
-    if (orderBook.isValidOrderType(orderType)) {
-        orderBookType = orderBook.orderBookTypes[orderType];
-    } else {
-        std::cout << "Invalid argument for <bid/ask>: " << orderType << std::endl;
-        throw std::invalid_argument("Invalid argument for <bid/ask>");
+void AdvisorMain::runQuery(const std::vector<std::string> &cmd) {
+    // wait until the book can answer this command
+    QuerySource loaded = source(QueryEngine::requiredStage(cmd));
+    QueryResult result;
+    try {
+        // answer the command at the current time step
+        result = QueryEngine{loaded}.run(cmd, currentTime);
+    } catch (const QueryError &e) {
+        // show the offending input, then let init() report the reason and prompt again
+        if (!e.detail().empty())
+            std::cout << e.detail() << std::endl;
+        throw;
     }
 
-    std::vector<std::vector<OrderBookEntry>> ordersPerTimestep;
-    for (int i = 0; i <= currentTime.second; i++) {
-        ordersPerTimestep.push_back(orderBook.getOrders(orderBookType, product, orderBook.getTimestamps()[i]));
+    // print the answer after the bot prompt, followed by any listed items
+    for (const std::string &message: result.messages) {
+        std::cout << BOTPROMPT << message << std::endl;
+    }
+    if (result.itemsInText) {
+        for (const std::string &item: result.items) {
+            std::cout << item << std::endl;
+        }
     }
-
-    double predicted = Calculator::calculateAverageMinMaxOverTimesteps(ordersPerTimestep, minOrMax);
-
-    std::cout << BOTPROMPT << "The predicted " << minOrMax << " " << orderType << " price of " << product
-              << " for the next time step is " << predicted << std::endl;
 }
 
-void AdvisorMain::printTime() const {
-    std::cout << BOTPROMPT << currentTime.first << std::endl;
+void AdvisorMain::printTime() {
+    runQuery({"time"});
 }
 
 void AdvisorMain::moveToNextTimestep() {
-    currentTime = orderBook.getNextTime(currentTime.first);
-    std::cout << BOTPROMPT << "now at " << currentTime.first << std::endl;
+    runQuery({"step"});
 }
 
 void AdvisorMain::terminateGracefully() {
@@ -386,22 +364,6 @@ void AdvisorMain::terminateGracefully() {
 }
 
 void AdvisorMain::printAllCurrentOrdersOfType(const std::string &orderType) {
-    if (orderType.empty() || !orderBook.isValidOrderType(orderType)) {
-        std::cout << "Invalid argument for list <bid/ask>: " << orderType << std::endl;
-        throw std::invalid_argument("Invalid argument for list <bid/ask>");
-    }
-
-    std::vector<OrderBookEntry> orders;
-    orders = orderBook.getOrders(OrderBookEntry::stringToOrderBookType(orderType), "", currentTime.first);
-
-    if (orders.empty()) {
-        std::cout << BOTPROMPT << "No " << orderType << "s found for current time step: ("
-                  << currentTime.first << ")." << std::endl;
-    } else {
-        std::cout << BOTPROMPT << orderType << "s for current time step (" << currentTime.first << "):" << std::endl;
-        for (const OrderBookEntry &e: orders) {
-            std::cout << e.toString() << std::endl;
-        }
-    }
+    runQuery({"list", orderType});
 }
 //
@@ -3,24 +3,46 @@
 #ifndef ADVISORBOT_ADVISORMAIN_H
 #define ADVISORBOT_ADVISORMAIN_H
 
-// Constants for the CSV data file, bot prompt, and user prompt.
+// Constants for the default CSV data file, the number of CSV parser threads (0 = one per core), whether to keep following
+// the data file as it grows, the memory budget for the days of a directory of daily files, bot prompt, and user prompt.
 #define CSVDATAFILE "20200601.csv"
+#define CSVLOADTHREADS 0
+#define CSVFOLLOW false
+#define CATALOGMEMORYMB 1024
 #define BOTPROMPT "advisorbot> "
 #define USERPROMPT "user>"
 
 #include "OrderBook.h"
+#include "Dataset.h"
+#include "QueryEngine.h"
+#include "BatchRunner.h"
+#include "QueryServer.h"
+#include "Backtest.h"
 #include <string>
 #include <map>
 
 // AdvisorMain class
 class AdvisorMain {
 public:
-    // constructor
-    AdvisorMain();
+    // constructor, starts loading the data file (or opens the directory of daily files) in the background; with
+    // blockStorage the file is kept in column blocks on disk, of which at most memoryBudget bytes are mapped
+    explicit AdvisorMain(const std::string &dataFile = CSVDATAFILE,
+                         std::size_t memoryBudget = std::size_t(CATALOGMEMORYMB) * 1024 * 1024,
+                         bool blockStorage = false);
 
     // Initialises the program
     void init();
 
+    // Runs a script of commands from the earliest time step without prompts, writing one JSON or CSV result per
+    // command to output. Returns the number of commands that failed.
+    std::size_t runBatch(std::istream &input, std::ostream &output, const BatchOptions &options);
+
+    // Serves the commands to clients over a socket until SIGINT or SIGTERM, each client with its own current time.
+    void serve(const ServerOptions &options);
+
+    // Scores every prediction model over the whole dataset and writes the scores as JSON or CSV to output.
+    void runBacktest(std::ostream &output, const BatchOptions &options);
+
 private:
     // Terminate the program upon user signal
     static void terminateGracefully();
@@ -43,17 +65,17 @@ private:
     // C3: prod - List available products 
     void printAvailableProducts();
 
-    // C4 + C5: min/max - Find minimum/maximum bid or ask for product in current time step 
+    // C4 + C5: min/max - Find minimum/maximum bid or ask for product in current time step, or in a time window
     void printProductMinMaxOfType(const std::vector<std::string> &cmd);
 
-    // C6: avg - compute average ask/bid for the sent product over the sent number of time steps  
+    // C6: avg - compute average ask/bid for the sent product over the sent number of time steps, or a time window
     void printProductAvgOfTypeOverTimesteps(const std::vector<std::string> &cmd);
 
     // C7: predict - predict (max or min) (ask or bid) for the sent product for the next time step 
     void predictProductNextMaxMinOfType(const std::vector<std::string> &cmd);
 
     // C8: time - state current time in dataset, i.e. which timeframe are we looking at 
-    void printTime() const;
+    void printTime();
 
     // C9: step - move to next time step 
     void moveToNextTimestep();
@@ -61,7 +83,33 @@ private:
     // (EXTRA COMMAND) C10: list - list all ask/bid prices that happened in the current time step 
     void printAllCurrentOrdersOfType(const std::string &orderType);
 
-    // current timestamp along with its index in the OrderBook object assigned to this instance (orderBook) 
+    // (EXTRA COMMAND) C11: load [<file>] - load another data file in the background, or show how the loads are going
+    void loadDataFile(const std::vector<std::string> &cmd);
+
+    // (EXTRA COMMAND) C12: vwap/volume/notional - volume-weighted average price, total amount or total value of the
+    // ask/bid orders for a product in the current time step, over a number of time steps, or in a time window
+    void printProductVolumeOfType(const std::vector<std::string> &cmd);
+
+    // (EXTRA COMMAND) C13: best/spread/mid/depth - best ask/bid, spread and mid price, and the best price levels of
+    // a product in the current time step, from its sorted price ladders
+    void printProductLadderOfType(const std::vector<std::string> &cmd);
+
+    // (EXTRA COMMAND) C14: backtest [<product>] - replay the dataset and show how well each predict model did
+    void printBacktest(const std::vector<std::string> &cmd);
+
+    // (EXTRA COMMAND) C15: stats - show the rows parsed, load phase times, command latencies and memory use so far
+    void printStats();
+
+    // Return the order book (or catalog) once it has reached the stage, waiting for it if needed, and move the
+    // current time to its earliest time step if it is a different one than last time. Throws std::invalid_argument
+    // if no data file could be loaded.
+    QuerySource source(LoadStage stage);
+
+    // Answer a command with the query engine at the current time step and print the answer; prints the offending
+    // input and rethrows if the command is invalid.
+    void runQuery(const std::vector<std::string> &cmd);
+
+    // current timestamp along with its index in the order book of this instance (see source())
     std::pair<std::string, int> currentTime = {"", 0};
 
     // container for printing the contents of the help and help <cmd> functions 
@@ -69,16 +117,30 @@ private:
             {"help",       {"help",                                  "list all available commands"}},
             {"help <cmd>", {"help <cmd>",                            "output help for the specified command"}},
             {"prod",       {"prod",                                  "list available products"}},
-            {"min",        {"min <product> <ask/bid>",               "find the minimum bid or ask for a product in the current time step"}},
-            {"max",        {"max <product> <ask/bid>",               "find the maximum bid or ask for a product in the current time step"}},
-            {"avg",        {"avg <product> <ask/bid> <timesteps>",   "compute the average ask or bid for a product over a number of time steps"}},
-            {"predict",    {"predict <min/max> <product> <ask/bid>", "predict the maximum or minimum ask or bid of a product for the next time step"}},
+            {"min",        {"min <product> <ask/bid> [<window>]",    "find the minimum bid or ask for a product in the current time step, or in a time window such as 5m or between <t1> <t2>"}},
+            {"max",        {"max <product> <ask/bid> [<window>]",    "find the maximum bid or ask for a product in the current time step, or in a time window such as 5m or between <t1> <t2>"}},
+            {"avg",        {"avg <product> <ask/bid> <timesteps/window>", "compute the average ask or bid for a product over a number of time steps, or a time window such as 5m or between <t1> <t2>"}},
+            {"predict",    {"predict <min/max> <product> <ask/bid> [<model>]", "predict the maximum or minimum ask or bid of a product for the next time step, with the model mean (the average of every time step so far, the default), ewma, linear (trend of the last 20 time steps) or holt"}},
             {"time",       {"time",                                  "state current time in dataset, i.e. which timeframe are we looking at"}},
             {"step",       {"step",                                  "move to the next time step"}},
-            {"list",       {"list <ask/bid>",                        "list all ask/bid prices in the current time step"}}
+            {"list",       {"list <ask/bid>",                        "list all ask/bid prices in the current time step"}},
+            {"load",       {"load [<file>]",                         "load another data file in the background and switch to it once loaded, or show how loading is going"}},
+            {"vwap",       {"vwap <product> <ask/bid> [<timesteps/window>]", "compute the volume-weighted average ask or bid price for a product in the current time step, over a number of time steps, or in a time window"}},
+            {"volume",     {"volume <product> <ask/bid> [<timesteps/window>]", "compute the total amount of the asks or bids for a product in the current time step, over a number of time steps, or in a time window"}},
+            {"notional",   {"notional <product> <ask/bid> [<timesteps/window>]", "compute the total value (price times amount) of the asks or bids for a product in the current time step, over a number of time steps, or in a time window"}},
+            {"best",       {"best <product> <ask/bid>",              "find the best (lowest) ask or best (highest) bid for a product in the current time step"}},
+            {"spread",     {"spread [<product>]",                    "compute the difference between the best ask and the best bid of a product, or of every product, in the current time step"}},
+            {"mid",        {"mid [<product>]",                       "compute the price halfway between the best ask and the best bid of a product, or of every product, in the current time step"}},
+            {"backtest",   {"backtest [<product>]",                  "replay the whole dataset and show the mean absolute error, root mean squared error and bias of every predict model, for every product or the given one"}},
+            {"depth",      {"depth <product> <ask/bid> [<levels>]",  "list the best price levels (5 unless given) of the asks or bids for a product in the current time step, with the amount and number of orders at each"}},
+            {"stats",      {"stats",                                 "show the rows parsed, the time spent in each load phase, the latency percentiles of every command and the memory taken by the order book so far"}}
     };
 
-    OrderBook orderBook{CSVDATAFILE};
+    // the order book the commands are answered from, loaded in the background
+    Dataset dataset;
+
+    // the dataset's generation that currentTime refers to; 0 before the first book is seen
+    std::size_t generation = 0;
 };
 
 
@@ -0,0 +1,210 @@
+#include <cmath>
+#include <algorithm>
+#include "AggregateTable.h"
+
+namespace {
+    // Add a value to a running total, keeping what rounding takes off in 'error' (Neumaier's variant of Kahan)
+    void compensatedAdd(double &total, double &error, double value) {
+        double next = total + value;
+        if (std::fabs(total) >= std::fabs(value))
+            error += (total - next) + value;
+        else
+            error += (value - next) + total;
+        total = next;
+    }
+}
+
+// Buckets are laid out timestamp first, then product, then order type
+std::size_t AggregateTable::key(std::uint32_t timestampId, std::uint32_t productId, OrderBookType type) const {
+    return (timestampId * productCount + productId) * orderTypeCount + static_cast<std::size_t>(type);
+}
+
+// Summarise the whole store from scratch
+void AggregateTable::build(const OrderStore &store) {
+    buckets.clear();
+    prefix.clear();
+    productCount = 0;
+    timestampCount = 0;
+    addRows(store, 0);
+}
+
+// Fold the given rows into their buckets in one pass over the columns they need
+void AggregateTable::addRows(const OrderStore &store, std::size_t firstRow) {
+    std::size_t oldTimestampCount = timestampCount;
+    std::size_t oldProductCount = productCount;
+    resize(store.timestamps.size(), store.products.size());
+
+    // remember the earliest time step that changed, the running totals after it have to be redone; new products
+    // change the layout of the running totals, which are then redone from zeros
+    std::size_t firstChanged = oldTimestampCount;
+    if (productCount != oldProductCount) {
+        prefix.clear();
+        firstChanged = 0;
+    }
+    std::size_t i = firstRow;
+    while (i < store.size()) {
+        // rows of the same bucket are adjacent once the store is indexed, so fold each run with one kernel call
+        std::size_t runEnd = i + 1;
+        while (runEnd < store.size() && store.timestampIds[runEnd] == store.timestampIds[i] &&
+               store.productIds[runEnd] == store.productIds[i] && store.orderTypes[runEnd] == store.orderTypes[i])
+            ++runEnd;
+
+        ColumnSpan<double> run{store.prices.data() + i, runEnd - i};
+        ColumnSpan<double> amounts{store.amounts.data() + i, runEnd - i};
+        buckets[key(store.timestampIds[i], store.productIds[i], store.orderTypes[i])]
+                .add(PriceKernels::minMaxSum(run), PriceKernels::volumeNotional(run, amounts), run.size());
+        firstChanged = std::min<std::size_t>(firstChanged, store.timestampIds[i]);
+        i = runEnd;
+    }
+    updatePrefix(firstChanged);
+    updateExtremes(firstChanged);
+}
+
+// Running totals per (product, order type), one time step at a time
+void AggregateTable::updatePrefix(std::size_t fromTimestep) {
+    std::size_t series = productCount * orderTypeCount;
+    prefix.resize((timestampCount + 1) * series);
+
+    for (std::size_t t = fromTimestep; t < timestampCount; ++t) {
+        for (std::size_t s = 0; s < series; ++s) {
+            const PriceAggregate &bucket = buckets[t * series + s];
+            WindowAggregate next = prefix[t * series + s];
+            if (!bucket.empty()) {
+                compensatedAdd(next.sum, next.sumError, bucket.sum);
+                next.count += bucket.count;
+                next.minSum += bucket.min;
+                next.maxSum += bucket.max;
+                ++next.steps;
+                compensatedAdd(next.volume, next.volumeError, bucket.volume);
+                compensatedAdd(next.notional, next.notionalError, bucket.notional);
+            }
+            prefix[(t + 1) * series + s] = next;
+        }
+    }
+}
+
+// Totals of a run of time steps: the difference between two prefix entries
+WindowAggregate AggregateTable::window(std::uint32_t productId, OrderBookType type,
+                                       std::uint32_t firstTimestep, std::uint32_t lastTimestep) const {
+    WindowAggregate result;
+    if (productId >= productCount || firstTimestep > lastTimestep || firstTimestep >= timestampCount)
+        return result;
+    if (lastTimestep >= timestampCount)
+        lastTimestep = static_cast<std::uint32_t>(timestampCount - 1);
+
+    const WindowAggregate &end = prefix[key(lastTimestep + 1, productId, type)];
+    const WindowAggregate &begin = prefix[key(firstTimestep, productId, type)];
+    result.sum = (end.sum - begin.sum) + (end.sumError - begin.sumError);
+    result.count = end.count - begin.count;
+    result.minSum = end.minSum - begin.minSum;
+    result.maxSum = end.maxSum - begin.maxSum;
+    result.steps = end.steps - begin.steps;
+    result.volume = (end.volume - begin.volume) + (end.volumeError - begin.volumeError);
+    result.notional = (end.notional - begin.notional) + (end.notionalError - begin.notionalError);
+    return result;
+}
+
+// Leaves take the extremes of their bucket, every other node those of its two children
+void AggregateTable::updateExtremes(std::size_t fromTimestep) {
+    std::size_t series = productCount * orderTypeCount;
+
+    // the trees have a power of two leaves; when they run out, or the products change, start over with bigger ones
+    if (treeLeaves < timestampCount || extremes.size() != series * 2 * treeLeaves) {
+        treeLeaves = 1;
+        while (treeLeaves < timestampCount) treeLeaves *= 2;
+        extremes.assign(series * 2 * treeLeaves, Extremes{});
+        fromTimestep = 0;
+    }
+    if (fromTimestep >= timestampCount)
+        return;
+
+    for (std::size_t s = 0; s < series; ++s) {
+        Extremes *tree = extremes.data() + s * 2 * treeLeaves;
+        for (std::size_t t = fromTimestep; t < timestampCount; ++t) {
+            const PriceAggregate &bucket = buckets[t * series + s];
+            tree[treeLeaves + t] = {bucket.min, bucket.max};
+        }
+
+        // walk up level by level, only over the nodes above the changed leaves
+        for (std::size_t first = (treeLeaves + fromTimestep) / 2, last = (treeLeaves + timestampCount - 1) / 2;
+             first >= 1; first /= 2, last /= 2) {
+            for (std::size_t n = first; n <= last; ++n) {
+                tree[n].min = std::min(tree[2 * n].min, tree[2 * n + 1].min);
+                tree[n].max = std::max(tree[2 * n].max, tree[2 * n + 1].max);
+            }
+        }
+    }
+}
+
+// Totals from the prefix sums, extremes from the segment tree
+PriceAggregate AggregateTable::range(std::uint32_t productId, OrderBookType type,
+                                     std::uint32_t firstTimestep, std::uint32_t lastTimestep) const {
+    PriceAggregate result;
+    WindowAggregate totals = window(productId, type, firstTimestep, lastTimestep);
+    if (totals.count == 0)
+        return result;
+    result.sum = totals.sum;
+    result.count = totals.count;
+    result.volume = totals.volume;
+    result.notional = totals.notional;
+
+    // cover [first, last] with O(log n) tree nodes, climbing from both ends towards the root
+    if (lastTimestep >= timestampCount)
+        lastTimestep = static_cast<std::uint32_t>(timestampCount - 1);
+    const Extremes *tree = extremes.data() + key(0, productId, type) * 2 * treeLeaves;
+    for (std::size_t l = treeLeaves + firstTimestep, r = treeLeaves + lastTimestep + 1; l < r; l /= 2, r /= 2) {
+        if (l & 1) {
+            result.min = std::min(result.min, tree[l].min);
+            result.max = std::max(result.max, tree[l].max);
+            ++l;
+        }
+        if (r & 1) {
+            --r;
+            result.min = std::min(result.min, tree[r].min);
+            result.max = std::max(result.max, tree[r].max);
+        }
+    }
+    return result;
+}
+
+// Grow the table; new timestamps only add buckets at the end, a new product needs the table laid out again
+void AggregateTable::resize(std::size_t newTimestampCount, std::size_t newProductCount) {
+    if (newProductCount == productCount) {
+        if (newTimestampCount > timestampCount) {
+            buckets.resize(newTimestampCount * productCount * orderTypeCount);
+            timestampCount = newTimestampCount;
+        }
+        return;
+    }
+
+    newTimestampCount = std::max(timestampCount, newTimestampCount);
+    std::vector<PriceAggregate> grown(newTimestampCount * newProductCount * orderTypeCount);
+    for (std::size_t t = 0; t < timestampCount; ++t) {
+        for (std::size_t p = 0; p < productCount; ++p) {
+            for (std::size_t o = 0; o < orderTypeCount; ++o) {
+                grown[(t * newProductCount + p) * orderTypeCount + o] = buckets[(t * productCount + p) * orderTypeCount + o];
+            }
+        }
+    }
+    buckets.swap(grown);
+    productCount = newProductCount;
+    timestampCount = newTimestampCount;
+}
+
+// Look up the summary of one bucket
+const PriceAggregate &AggregateTable::at(std::uint32_t timestampId, std::uint32_t productId, OrderBookType type) const {
+    if (timestampId >= timestampCount || productId >= productCount)
+        return none;
+    return buckets[key(timestampId, productId, type)];
+}
+
+// Return the number of timestamps covered by the table
+std::size_t AggregateTable::timestamps() const {
+    return timestampCount;
+}
+
+// The three tables by their capacity
+std::size_t AggregateTable::memoryUsage() const {
+    return buckets.capacity() * sizeof(PriceAggregate) + prefix.capacity() * sizeof(WindowAggregate) +
+           extremes.capacity() * sizeof(Extremes);
+}
@@ -0,0 +1,157 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_AGGREGATETABLE_H
+#define ADVISORBOT_AGGREGATETABLE_H
+
+// include necessary standard C++ libraries and header files
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+#include "OrderStore.h"
+#include "OrderBookEntry.h"
+#include "PriceKernels.h"
+
+// Summary of the prices and amounts of all orders in one (timestamp, product, order type) bucket.
+struct PriceAggregate {
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double sum = 0;
+    std::uint64_t count = 0;
+    // total amount, and total price times amount
+    double volume = 0;
+    double notional = 0;
+
+    // Fold one more order into the summary.
+    void add(double price, double amount) {
+        min = price < min ? price : min;
+        max = price > max ? price : max;
+        sum += price;
+        ++count;
+        volume += amount;
+        notional += price * amount;
+    }
+
+    // Fold a whole run of orders into the summary, given the minimum, maximum and sum of its prices and its
+    // volume and notional.
+    void add(const MinMaxSum &run, const VolumeNotional &runVolume, std::uint64_t runCount) {
+        min = run.min < min ? run.min : min;
+        max = run.max > max ? run.max : max;
+        sum += run.sum;
+        count += runCount;
+        volume += runVolume.volume;
+        notional += runVolume.notional;
+    }
+
+    // Fold another summary into this one.
+    void add(const PriceAggregate &other) {
+        add(MinMaxSum{other.min, other.max, other.sum}, VolumeNotional{other.volume, other.notional}, other.count);
+    }
+
+    bool empty() const { return count == 0; }
+};
+
+// Totals over a run of time steps of one product and order type, taken from the prefix sums of an AggregateTable.
+struct WindowAggregate {
+    // sum and number of all prices in the window
+    double sum = 0;
+    std::uint64_t count = 0;
+    // sums of the per time step minimum and maximum, over the time steps that had orders
+    double minSum = 0;
+    double maxSum = 0;
+    std::uint64_t steps = 0;
+    // total amount, and total price times amount, of all orders in the window
+    double volume = 0;
+    double notional = 0;
+    // what rounding took off sum, volume and notional while they were added up (Neumaier compensation); only the
+    // prefix entries of an AggregateTable carry these, a window has them folded back into its totals
+    double sumError = 0;
+    double volumeError = 0;
+    double notionalError = 0;
+
+    // Add the totals of another window (or a single bucket).
+    void add(const WindowAggregate &other) {
+        sum += other.sum;
+        count += other.count;
+        minSum += other.minSum;
+        maxSum += other.maxSum;
+        steps += other.steps;
+        volume += other.volume;
+        notional += other.notional;
+    }
+};
+
+// Dense table with one PriceAggregate per (timestamp, product, order type) bucket, laid out timestamp first
+// like OrderIndex. It is filled in a single pass over the store and can be extended as rows are appended,
+// so min, max, sum, count, volume and notional of any bucket are available in constant time.
+// For every (product, order type) it also keeps running totals over the time steps, so that the totals of any
+// run of consecutive time steps are the difference of two prefix entries and also take constant time (the price,
+// amount and notional totals are compensated, so that a long run loses no more accuracy than a short one), and a
+// segment tree of the per time step minimum and maximum, so that the extremes of any run take logarithmic time.
+class AggregateTable {
+    public:
+        // Number of order types per (timestamp, product) pair (bid, ask, unknown).
+        static const std::size_t orderTypeCount = 3;
+
+        // Discard everything and summarise every row of the store.
+        void build(const OrderStore &store);
+
+        // Summarise the rows [firstRow, store.size()) that were appended to the store after the last call,
+        // growing the table for timestamps and products that are new.
+        void addRows(const OrderStore &store, std::size_t firstRow);
+
+        // Return the summary of one bucket; ids outside the table give an empty summary.
+        const PriceAggregate &at(std::uint32_t timestampId, std::uint32_t productId, OrderBookType type) const;
+
+        // Return the totals of the time steps [firstTimestep, lastTimestep] of one product and order type.
+        WindowAggregate window(std::uint32_t productId, OrderBookType type,
+                               std::uint32_t firstTimestep, std::uint32_t lastTimestep) const;
+
+        // Return the minimum, maximum, sum, count, volume and notional of all orders of one product and order type in the time steps
+        // [firstTimestep, lastTimestep], as if they were one bucket.
+        PriceAggregate range(std::uint32_t productId, OrderBookType type,
+                             std::uint32_t firstTimestep, std::uint32_t lastTimestep) const;
+
+        // Return the number of timestamps covered by the table.
+        std::size_t timestamps() const;
+
+        // Return how many bytes the summaries, prefix sums and trees take up.
+        std::size_t memoryUsage() const;
+
+    private:
+        // Make room for the given number of timestamps and products, keeping existing summaries.
+        void resize(std::size_t newTimestampCount, std::size_t newProductCount);
+
+        // Recompute the prefix sums from the given time step onwards.
+        void updatePrefix(std::size_t fromTimestep);
+
+        // Refresh the minimum/maximum trees from the given time step onwards, rebuilding them when they are too small.
+        void updateExtremes(std::size_t fromTimestep);
+
+        // Position of a bucket in 'buckets'.
+        std::size_t key(std::uint32_t timestampId, std::uint32_t productId, OrderBookType type) const;
+
+        std::vector<PriceAggregate> buckets;
+
+        // prefix[key(t, p, o)] holds the totals of time steps [0, t) of product p and order type o,
+        // with one extra time step at the end for the totals of the whole day.
+        std::vector<WindowAggregate> prefix;
+        std::size_t productCount = 0;
+        std::size_t timestampCount = 0;
+
+        // Smallest and largest price of a run of time steps.
+        struct Extremes {
+            double min = std::numeric_limits<double>::infinity();
+            double max = -std::numeric_limits<double>::infinity();
+        };
+
+        // One segment tree per (product, order type), 2 * treeLeaves nodes each: node 1 is the root, the children
+        // of node n are 2n and 2n + 1, and time step t is the leaf treeLeaves + t.
+        std::vector<Extremes> extremes;
+        std::size_t treeLeaves = 0;
+
+        // Returned for lookups outside the table.
+        PriceAggregate none;
+};
+
+#endif //ADVISORBOT_AGGREGATETABLE_H
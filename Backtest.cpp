@@ -0,0 +1,164 @@
+// include necessary C++ libraries and header files
+#include <cmath>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include "Backtest.h"
+#include "WorkerPool.h"
+
+namespace {
+    // the sides, extremes and models of one product, in the order the scores are reported
+    const OrderBookType sides[] = {OrderBookType::bid, OrderBookType::ask};
+    const PredictionModel models[] = {PredictionModel::mean, PredictionModel::ewma, PredictionModel::linear,
+                                      PredictionModel::holt};
+    const std::size_t modelCount = sizeof(models) / sizeof(models[0]);
+    const std::size_t scoresPerProduct = 2 * 2 * modelCount;
+
+    // Running totals of one (product, side, min/max) that outlive a day: the mean model's sum and number of steps.
+    struct SeriesTotals {
+        double sum = 0;
+        std::uint64_t steps = 0;
+    };
+
+    // Everything one product keeps from one day to the next.
+    struct ProductState {
+        std::string product;
+        BacktestScore scores[scoresPerProduct];
+        SeriesTotals totals[2 * 2];
+    };
+
+    // Score one product over one day.
+    void replay(const OrderBook &dayBook, std::uint32_t productId, ProductState &state) {
+        const AggregateTable &aggregates = dayBook.getAggregates();
+        const PredictionTable &predictions = dayBook.getPredictions();
+        std::size_t timesteps = aggregates.timestamps();
+
+        for (std::size_t s = 0; s < 2; ++s) {
+            for (std::size_t extreme = 0; extreme < 2; ++extreme) {
+                SeriesTotals &totals = state.totals[s * 2 + extreme];
+                BacktestScore *scores = state.scores + (s * 2 + extreme) * modelCount;
+                // whether the incremental models have seen a value of this day yet
+                bool observedToday = false;
+
+                for (std::size_t t = 0; t < timesteps; ++t) {
+                    const PriceAggregate &bucket = aggregates.at(static_cast<std::uint32_t>(t), productId, sides[s]);
+                    if (!bucket.empty()) {
+                        totals.sum += extreme == 0 ? bucket.min : bucket.max;
+                        ++totals.steps;
+                        observedToday = true;
+                    }
+                    if (t + 1 >= timesteps || !observedToday)
+                        continue;
+
+                    // the value to predict is the next time step's minimum or maximum, if it has orders
+                    const PriceAggregate &next = aggregates.at(static_cast<std::uint32_t>(t + 1), productId, sides[s]);
+                    if (next.empty())
+                        continue;
+                    double realised = extreme == 0 ? next.min : next.max;
+
+                    for (std::size_t m = 0; m < modelCount; ++m) {
+                        double predicted = models[m] == PredictionModel::mean
+                                           ? totals.sum / (double) totals.steps
+                                           : predictions.forecast(models[m], productId, sides[s], extreme == 1,
+                                                                  static_cast<std::uint32_t>(t));
+                        double error = predicted - realised;
+                        ++scores[m].predictions;
+                        scores[m].absoluteError += std::fabs(error);
+                        scores[m].squaredError += error * error;
+                        scores[m].error += error;
+                    }
+                }
+            }
+        }
+    }
+}
+
+double BacktestScore::mae() const {
+    return predictions == 0 ? 0 : absoluteError / (double) predictions;
+}
+
+double BacktestScore::rmse() const {
+    return predictions == 0 ? 0 : std::sqrt(squaredError / (double) predictions);
+}
+
+double BacktestScore::bias() const {
+    return predictions == 0 ? 0 : error / (double) predictions;
+}
+
+std::string Backtest::modelName(PredictionModel model) {
+    switch (model) {
+        case PredictionModel::mean: return "mean";
+        case PredictionModel::ewma: return "ewma";
+        case PredictionModel::linear: return "linear";
+        case PredictionModel::holt: return "holt";
+    }
+    return "unknown";
+}
+
+// Day by day, in time order, with the products of each day spread over the pool
+std::vector<BacktestScore> Backtest::run(const QuerySource &source, unsigned threads) {
+    if (source.blocks)
+        throw std::runtime_error("the backtest needs the order book in memory, not block storage");
+    WorkerPool pool{threads};
+    // products by name, so that a product keeps its state across the days of a catalog
+    std::map<std::string, std::unique_ptr<ProductState>> states;
+
+    std::size_t days = source.catalog ? source.catalog->size() : 1;
+    for (std::size_t d = 0; d < days; ++d) {
+        std::shared_ptr<const OrderBook> dayBook = source.catalog ? source.catalog->day(d) : source.book;
+
+        // find every product's state before the threads start, so that they only touch their own
+        const std::vector<std::string> &products = dayBook->getProducts();
+        std::vector<ProductState *> dayStates;
+        for (const std::string &product: products) {
+            std::unique_ptr<ProductState> &state = states[product];
+            if (!state) {
+                state = std::make_unique<ProductState>();
+                state->product = product;
+            }
+            dayStates.push_back(state.get());
+        }
+
+        pool.run(products.size(), [&](std::size_t p) {
+            replay(*dayBook, static_cast<std::uint32_t>(p), *dayStates[p]);
+        });
+    }
+
+    // label the scores and hand them out in product order
+    std::vector<BacktestScore> scores;
+    for (const auto &entry: states) {
+        for (std::size_t i = 0; i < scoresPerProduct; ++i) {
+            BacktestScore score = entry.second->scores[i];
+            score.product = entry.first;
+            score.type = sides[i / (2 * modelCount)];
+            score.max = (i / modelCount) % 2 == 1;
+            score.model = models[i % modelCount];
+            scores.push_back(score);
+        }
+    }
+    return scores;
+}
+
+// {"product":"BTC/USDT","side":"bid","extreme":"min","model":"ewma","predictions":58,"mae":..,"rmse":..,"bias":..}
+// or product,side,extreme,model,predictions,mae,rmse,bias
+void Backtest::write(std::ostream &output, const std::vector<BacktestScore> &scores, BatchFormat format) {
+    if (format == BatchFormat::csv)
+        output << "product,side,extreme,model,predictions,mae,rmse,bias\n";
+    for (const BacktestScore &score: scores) {
+        std::string side = OrderBookEntry::orderBookTypeToString(score.type);
+        std::string extreme = score.max ? "max" : "min";
+        if (format == BatchFormat::json) {
+            output << "{\"product\":" << BatchRunner::jsonString(score.product)
+                   << ",\"side\":\"" << side << "\",\"extreme\":\"" << extreme
+                   << "\",\"model\":\"" << modelName(score.model) << "\",\"predictions\":" << score.predictions
+                   << ",\"mae\":" << BatchRunner::number(score.mae(), "null")
+                   << ",\"rmse\":" << BatchRunner::number(score.rmse(), "null")
+                   << ",\"bias\":" << BatchRunner::number(score.bias(), "null") << "}\n";
+        } else {
+            output << BatchRunner::csvField(score.product) << ',' << side << ',' << extreme << ','
+                   << modelName(score.model) << ',' << score.predictions << ','
+                   << BatchRunner::number(score.mae(), "") << ',' << BatchRunner::number(score.rmse(), "") << ','
+                   << BatchRunner::number(score.bias(), "") << '\n';
+        }
+    }
+}
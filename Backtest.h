@@ -0,0 +1,56 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_BACKTEST_H
+#define ADVISORBOT_BACKTEST_H
+
+// include necessary standard C++ libraries and header files
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include "BatchRunner.h"
+#include "QueryEngine.h"
+#include "PredictionTable.h"
+
+// How well one model predicted one product's per time step minimum or maximum bid or ask.
+struct BacktestScore {
+    std::string product;
+    OrderBookType type = OrderBookType::bid;
+    bool max = false;
+    PredictionModel model = PredictionModel::mean;
+
+    // number of predictions scored, and the sums of their errors (prediction - realised value)
+    std::uint64_t predictions = 0;
+    double absoluteError = 0;
+    double squaredError = 0;
+    double error = 0;
+
+    // mean absolute error, root mean squared error and mean error (positive if the model predicts too high)
+    double mae() const;
+    double rmse() const;
+    double bias() const;
+};
+
+// Replays a whole dataset the way a user stepping through it with predict would: at every time step each model
+// predicts the minimum and maximum bid and ask of every product for the next time step, and the prediction is
+// scored against what the next time step turned out to be. Time steps without orders are neither predicted
+// from nor scored against, the first time step of a day is not scored against the last one of the day before,
+// and each model sees what predict would see (mean reaches back into earlier days of a catalog, the incremental
+// models start again with every day).
+// Everything comes from the per time step summaries and model states, no order is looked at; the products are
+// shared out over a pool of threads.
+class Backtest {
+    public:
+        // Score every model for every product, side and min/max, using the given number of threads (0 = one per
+        // core). The scores are in product order, then bid before ask, min before max, and the order of the models.
+        // Throws std::runtime_error for a block store, which has no summaries, or a day that can't be loaded.
+        static std::vector<BacktestScore> run(const QuerySource &source, unsigned threads = 0);
+
+        // Write scores as JSON (one object per line) or CSV with a header row.
+        static void write(std::ostream &output, const std::vector<BacktestScore> &scores, BatchFormat format);
+
+        // Return the name of a model as predict takes it.
+        static std::string modelName(PredictionModel model);
+};
+
+#endif //ADVISORBOT_BACKTEST_H
@@ -0,0 +1,233 @@
+// include necessary C++ libraries and header files
+#include <cmath>
+#include <cstdio>
+#include <charconv>
+#include "BatchRunner.h"
+#include "CSVReader.h"
+#include "WorkerPool.h"
+
+// the most commands read and answered together, so that a long script is read, answered and written a part at a time
+static const std::size_t maxSegment = 4096;
+
+// Read the script one segment of read-only commands at a time, answer it and write its results before reading on
+std::size_t BatchRunner::run(const QuerySource &source, QueryCursor &cursor, std::istream &input,
+                             std::ostream &output, const BatchOptions &options) {
+    if (options.format == BatchFormat::csv)
+        output << csvHeader() << '\n';
+
+    QueryEngine engine{source};
+    WorkerPool pool{options.threads};
+    std::size_t failed = 0;
+    std::size_t number = 0;
+    std::vector<Command> segment;
+    // a step read after a run of read-only commands, which starts the next segment
+    Command next;
+    bool held = false;
+    bool ended = false;
+    while (true) {
+        // a segment is either one step or a run of commands that leave the cursor where it is
+        segment.clear();
+        if (held) {
+            segment.push_back(std::move(next));
+            held = false;
+        }
+        while (!ended && segment.size() < maxSegment &&
+               (segment.empty() || QueryEngine::isReadOnly(segment.front().tokens))) {
+            Command command;
+            if (!read(input, number, command)) {
+                ended = true;
+            } else if (!segment.empty() && !QueryEngine::isReadOnly(command.tokens)) {
+                next = std::move(command);
+                held = true;
+                break;
+            } else {
+                segment.push_back(std::move(command));
+            }
+        }
+        if (segment.empty())
+            break;
+
+        // pick up the orders appended to the data file since the last segment (when following it), and find
+        // the current time again in case the time steps were renumbered, or the file was replaced
+        if (source.book && source.book->follow() > 0)
+            cursor = source.book->findTime(cursor.first);
+
+        if (segment.size() == 1) {
+            answer(engine, segment.front(), cursor);
+        } else {
+            // every command of the segment starts from its own copy of the cursor, which none of them moves
+            const QueryCursor shared = cursor;
+            pool.run(segment.size(), [&](std::size_t i) {
+                QueryCursor own = shared;
+                answer(engine, segment[i], own);
+            });
+        }
+
+        // write the segment in input order, and hand it on before reading the next one
+        for (const Command &command: segment) {
+            if (!command.ok)
+                ++failed;
+            write(output, command, options.format);
+        }
+        output.flush();
+    }
+    return failed;
+}
+
+// Skip blank lines and comments, and stop at exit
+bool BatchRunner::read(std::istream &input, std::size_t &number, Command &command) {
+    std::string line;
+    while (std::getline(input, line)) {
+        ++number;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        std::vector<std::string> tokens = CSVReader::tokenise(line, ' ');
+        if (tokens.empty() || tokens[0][0] == '#')
+            continue;
+        if (tokens[0] == "exit")
+            return false;
+        command.line = number;
+        command.text = line;
+        command.tokens = std::move(tokens);
+        return true;
+    }
+    return false;
+}
+
+bool BatchRunner::parseFormat(const std::string &name, BatchFormat &format) {
+    if (name == "json") {
+        format = BatchFormat::json;
+        return true;
+    }
+    if (name == "csv") {
+        format = BatchFormat::csv;
+        return true;
+    }
+    return false;
+}
+
+// Run the command; the engine reports bad input by throwing
+void BatchRunner::answer(const QueryEngine &engine, Command &command, QueryCursor &cursor) {
+    command.timestamp = cursor.first;
+    try {
+        command.result = engine.run(command.tokens, cursor);
+        command.ok = true;
+    } catch (const QueryError &e) {
+        command.error = e.what();
+        command.detail = e.detail();
+    } catch (const std::exception &e) {
+        // anything else is reported against the command as well, rather than ending the whole batch
+        command.error = e.what();
+    }
+}
+
+void BatchRunner::write(std::ostream &output, const Command &command, BatchFormat format) {
+    if (format == BatchFormat::json)
+        writeJson(output, command);
+    else
+        writeCsv(output, command);
+}
+
+const char *BatchRunner::csvHeader() {
+    return "line,command,timestamp,status,value,message,items";
+}
+
+// {"line":3,"command":"min ETH/BTC ask","timestamp":"...","ok":true,"value":0.02,"text":["..."]}
+void BatchRunner::writeJson(std::ostream &output, const Command &command) {
+    output << "{\"line\":" << command.line
+           << ",\"command\":" << jsonString(command.text)
+           << ",\"timestamp\":" << jsonString(command.timestamp)
+           << ",\"ok\":" << (command.ok ? "true" : "false");
+
+    if (!command.ok) {
+        output << ",\"error\":" << jsonString(command.error);
+        if (!command.detail.empty())
+            output << ",\"detail\":" << jsonString(command.detail);
+        output << "}\n";
+        return;
+    }
+
+    const QueryResult &result = command.result;
+    if (result.hasValue)
+        output << ",\"value\":" << number(result.value, "null");
+    if (!result.items.empty()) {
+        output << ",\"items\":[";
+        for (std::size_t i = 0; i < result.items.size(); ++i) {
+            output << (i == 0 ? "" : ",") << jsonString(result.items[i]);
+        }
+        output << ']';
+    }
+    output << ",\"text\":[";
+    for (std::size_t i = 0; i < result.messages.size(); ++i) {
+        output << (i == 0 ? "" : ",") << jsonString(result.messages[i]);
+    }
+    output << "]}\n";
+}
+
+// line,command,timestamp,status,value,message,items - the messages are joined with "; " and the items with '|';
+// a failed command has its error, with the offending input if known, as the message
+void BatchRunner::writeCsv(std::ostream &output, const Command &command) {
+    std::string message, items, value;
+    if (command.ok) {
+        const QueryResult &result = command.result;
+        for (const std::string &m: result.messages) {
+            if (!message.empty()) message += "; ";
+            message += m;
+        }
+        for (const std::string &item: result.items) {
+            if (!items.empty()) items += '|';
+            items += item;
+        }
+        if (result.hasValue)
+            value = number(result.value, "");
+    } else {
+        message = command.detail.empty() ? command.error : command.detail;
+    }
+
+    output << command.line << ',' << csvField(command.text) << ',' << csvField(command.timestamp) << ','
+           << (command.ok ? "ok" : "error") << ',' << value << ',' << csvField(message) << ',' << csvField(items)
+           << '\n';
+}
+
+std::string BatchRunner::jsonString(const std::string &text) {
+    std::string quoted = "\"";
+    for (char c: text) {
+        switch (c) {
+            case '"': quoted += "\\\""; break;
+            case '\\': quoted += "\\\\"; break;
+            case '\n': quoted += "\\n"; break;
+            case '\r': quoted += "\\r"; break;
+            case '\t': quoted += "\\t"; break;
+            default:
+                // the other control characters have no short escape
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    quoted += escaped;
+                } else {
+                    quoted += c;
+                }
+        }
+    }
+    return quoted + '"';
+}
+
+std::string BatchRunner::csvField(const std::string &text) {
+    if (text.find_first_of(",\"\r\n") == std::string::npos)
+        return text;
+    // quotes inside a quoted field are doubled
+    std::string quoted = "\"";
+    for (char c: text) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + '"';
+}
+
+std::string BatchRunner::number(double value, const std::string &notFinite) {
+    if (!std::isfinite(value))
+        return notFinite;
+    char text[32];
+    std::to_chars_result written = std::to_chars(text, text + sizeof(text), value);
+    return std::string(text, written.ptr);
+}
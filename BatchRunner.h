@@ -0,0 +1,83 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_BATCHRUNNER_H
+#define ADVISORBOT_BATCHRUNNER_H
+
+// include necessary standard C++ libraries and header files
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include "OrderBook.h"
+#include "QueryEngine.h"
+
+// The formats batch results can be written in: one JSON object per line, or CSV with a header row.
+enum class BatchFormat { json, csv };
+
+// How a batch is run: the result format and the number of threads answering queries (0 = one per core).
+struct BatchOptions {
+    BatchFormat format = BatchFormat::json;
+    unsigned threads = 0;
+};
+
+// Runs a script of bot commands without prompts, e.g. from cron. Blank lines and lines starting with '#' are
+// skipped, and exit ends the script early. Consecutive read-only commands all see the same time step, so they are
+// answered concurrently; step runs on its own. The script is read a segment at a time (a step, or the read-only
+// commands up to the next step, at most a few thousand of them), and the results of each segment are written, in the
+// order of the commands, before the next one is read.
+class BatchRunner {
+    public:
+        // Run every command read from input against the book or catalog, starting at the cursor, and write one
+        // result per command to output. Returns the number of commands that failed.
+        static std::size_t run(const QuerySource &source, QueryCursor &cursor, std::istream &input,
+                               std::ostream &output, const BatchOptions &options);
+
+        // Parse "json" or "csv"; returns false for anything else.
+        static bool parseFormat(const std::string &name, BatchFormat &format);
+
+        // One command of the script and what became of it.
+        struct Command {
+            std::size_t line = 0;
+            std::string text;
+            std::vector<std::string> tokens;
+            // the time step the command was answered at
+            std::string timestamp;
+            bool ok = false;
+            QueryResult result;
+            std::string error;
+            std::string detail;
+        };
+
+        // Answer one command at the cursor, recording the answer or the reason it failed.
+        static void answer(const QueryEngine &engine, Command &command, QueryCursor &cursor);
+
+        // Write a result in the given format: a JSON object on one line, or a CSV row.
+        static void write(std::ostream &output, const Command &command, BatchFormat format);
+
+        // The header row of CSV results.
+        static const char *csvHeader();
+
+        // Quote and escape a string for JSON.
+        static std::string jsonString(const std::string &text);
+
+        // Quote a CSV field if it contains a comma, a quote or a line break.
+        static std::string csvField(const std::string &text);
+
+        // Format a number in the shortest form that reads back exactly; null in JSON (empty in CSV) if it is
+        // not finite.
+        static std::string number(double value, const std::string &notFinite);
+
+    private:
+        // Read the next command of the script, counting lines in 'number'. Returns false at the end of the script
+        // or at exit.
+        static bool read(std::istream &input, std::size_t &number, Command &command);
+
+        // Write a result as a JSON object on one line.
+        static void writeJson(std::ostream &output, const Command &command);
+
+        // Write a result as a CSV row.
+        static void writeCsv(std::ostream &output, const Command &command);
+};
+
+#endif //ADVISORBOT_BATCHRUNNER_H
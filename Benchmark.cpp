@@ -0,0 +1,206 @@
+// End-to-end benchmark of advisorbot on one data file: reading the CSV, building the order book with each ingestion
+// mode, the order book lookups, and the commands the bot answers.
+// Build and run with:
+//   make benchmark
+//   ./benchmark [--repetitions N] [--csv] [--quick] <data.csv>
+// --csv prints one line per measurement (rows,benchmark,best_ms,operations,operations_per_second) for scaling curves,
+// see "make scaling"; --quick leaves out the original vector reader and the line by line load, which need far more
+// memory and time than the others on large files.
+// The snapshot is neither read nor written, so every load parses the CSV.
+
+// include necessary C++ libraries and header files
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <cstdlib>
+#include "CSVReader.h"
+#include "OrderBook.h"
+#include "QueryEngine.h"
+#include "PriceKernels.h"
+
+namespace {
+    // How to run and report the benchmarks.
+    struct BenchmarkOptions {
+        std::string file;
+        int repetitions = 5;
+        bool csv = false;
+        bool quick = false;
+    };
+
+    BenchmarkOptions options;
+    // number of rows of the file, the first column of the CSV output
+    std::size_t rowCount = 0;
+
+    // Swallows what the loaders print about themselves while they are being timed.
+    class Quiet {
+        public:
+            Quiet() : saved(std::cout.rdbuf(discard.rdbuf())) {
+            }
+
+            ~Quiet() { std::cout.rdbuf(saved); }
+
+        private:
+            std::ostringstream discard;
+            std::streambuf *saved;
+    };
+
+    // Time a function over the repetitions; return the best time per call in milliseconds.
+    template<typename Function>
+    double timeIt(Function function, int repetitions) {
+        double best = 1e300;
+        for (int r = 0; r < repetitions; ++r) {
+            auto start = std::chrono::steady_clock::now();
+            function();
+            auto end = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            best = ms < best ? ms : best;
+        }
+        return best;
+    }
+
+    // Print one line of the report: the best time of a run of 'operations' rows, calls or commands.
+    void report(const std::string &name, double ms, std::size_t operations, const std::string &unit) {
+        double perSecond = ms > 0 ? (double) operations / (ms / 1e3) : 0;
+        if (options.csv) {
+            std::cout << rowCount << ',' << name << ',' << std::fixed << std::setprecision(3) << ms << ','
+                      << operations << ',' << std::setprecision(0) << perSecond << std::endl;
+            return;
+        }
+        std::cout << std::left << std::setw(36) << name << std::right << std::setw(12) << std::fixed
+                  << std::setprecision(3) << ms << " ms" << std::setw(14) << std::setprecision(0) << perSecond
+                  << ' ' << unit << "/s" << std::endl;
+    }
+
+    // Time a load of the whole file into an order book with one ingestion mode.
+    void benchmarkLoad(const std::string &name, LoadMode mode) {
+        LoadOptions load;
+        load.mode = mode;
+        load.useSnapshot = false;
+        double ms = timeIt([&] {
+            Quiet quiet;
+            OrderBook book{options.file, load};
+        }, options.repetitions);
+        report(name, ms, rowCount, "rows");
+    }
+
+    // Time a command at evenly spread time steps, with a cursor at each; reports nothing if the command fails.
+    void benchmarkCommand(const std::string &name, const QueryEngine &engine, const OrderBook &book,
+                          const std::vector<std::string> &cmd, const std::vector<std::uint32_t> &timesteps) {
+        std::vector<QueryCursor> cursors;
+        for (std::uint32_t t: timesteps)
+            cursors.emplace_back(book.getTimestamps()[t], static_cast<int>(t));
+        try {
+            QueryCursor cursor = cursors.front();
+            engine.run(cmd, cursor);
+        } catch (const QueryError &e) {
+            std::cerr << "benchmark: " << name << " failed: " << e.what() << std::endl;
+            return;
+        }
+        double ms = timeIt([&] {
+            for (QueryCursor cursor: cursors)
+                engine.run(cmd, cursor);
+        }, options.repetitions);
+        report(name, ms, cursors.size(), "commands");
+    }
+
+    int usage() {
+        std::cerr << "usage: benchmark [--repetitions N] [--csv] [--quick] <data.csv>" << std::endl;
+        return 2;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--csv") options.csv = true;
+        else if (arg == "--quick") options.quick = true;
+        else if (arg == "--repetitions" && i + 1 < argc) options.repetitions = std::atoi(argv[++i]);
+        else if (arg.rfind("--", 0) != 0 && options.file.empty()) options.file = arg;
+        else return usage();
+    }
+    if (options.file.empty() || options.repetitions <= 0)
+        return usage();
+
+    // the book every lookup and command runs against
+    LoadOptions load;
+    load.useSnapshot = false;
+    std::unique_ptr<OrderBook> book;
+    try {
+        Quiet quiet;
+        book = std::make_unique<OrderBook>(options.file, load);
+    } catch (const std::exception &e) {
+        std::cerr << "benchmark: " << e.what() << std::endl;
+        return 1;
+    }
+    const std::vector<std::string> &products = book->getProducts();
+    const std::vector<std::string> &timestamps = book->getTimestamps();
+    if (products.empty() || timestamps.empty()) {
+        std::cerr << "benchmark: " << options.file << " has no orders" << std::endl;
+        return 1;
+    }
+    for (std::uint32_t t = 0; t < timestamps.size(); ++t)
+        for (std::uint32_t p = 0; p < products.size(); ++p)
+            rowCount += book->getOrderRange(OrderBookType::bid, p, t).size() +
+                        book->getOrderRange(OrderBookType::ask, p, t).size();
+
+    if (!options.csv)
+        std::cout << "Benchmark: " << options.file << ", " << rowCount << " rows, " << products.size()
+                  << " products, " << timestamps.size() << " time steps, " << book->memoryUsage() / (1024 * 1024)
+                  << " MB in memory, kernels use " << PriceKernels::instructionSet() << std::endl;
+
+    // ---- ingestion
+    if (!options.quick) {
+        double ms = timeIt([&] {
+            Quiet quiet;
+            Dictionary timestampDictionary, productDictionary;
+            CSVReader::readCSV(options.file, timestampDictionary, productDictionary);
+        }, options.repetitions);
+        report("CSVReader::readCSV", ms, rowCount, "rows");
+        benchmarkLoad("OrderBook stream", LoadMode::stream);
+    }
+    benchmarkLoad("OrderBook mapped", LoadMode::mapped);
+    benchmarkLoad("OrderBook parallel", LoadMode::parallel);
+
+    // ---- lookups, at up to 1000 time steps spread evenly over the file
+    std::vector<std::uint32_t> steps;
+    std::size_t stride = timestamps.size() > 1000 ? timestamps.size() / 1000 : 1;
+    for (std::size_t t = 0; t < timestamps.size(); t += stride)
+        steps.push_back(static_cast<std::uint32_t>(t));
+    const std::string &product = products.front();
+
+    double ms = timeIt([&] {
+        for (std::uint32_t t: steps)
+            book->getOrders(OrderBookType::bid, product, timestamps[t]);
+    }, options.repetitions);
+    report("getOrders product timestamp", ms, steps.size(), "calls");
+    ms = timeIt([&] {
+        for (std::uint32_t t: steps)
+            book->getNextTime(timestamps[t]);
+    }, options.repetitions);
+    report("getNextTime by timestamp", ms, steps.size(), "calls");
+    ms = timeIt([&] {
+        for (std::uint32_t t: steps)
+            book->getNextTime(t);
+    }, options.repetitions);
+    report("getNextTime by id", ms, steps.size(), "calls");
+
+    // ---- the commands, as the bot answers them
+    QueryEngine engine{*book};
+    benchmarkCommand("prod", engine, *book, {"prod"}, steps);
+    benchmarkCommand("min", engine, *book, {"min", product, "ask"}, steps);
+    benchmarkCommand("max", engine, *book, {"max", product, "bid"}, steps);
+    benchmarkCommand("avg 10 timesteps", engine, *book, {"avg", product, "ask", "10"}, steps);
+    benchmarkCommand("avg 1h window", engine, *book, {"avg", product, "ask", "1h"}, steps);
+    benchmarkCommand("vwap", engine, *book, {"vwap", product, "bid"}, steps);
+    benchmarkCommand("depth", engine, *book, {"depth", product, "bid"}, steps);
+    benchmarkCommand("predict mean", engine, *book, {"predict", "max", product, "ask"}, steps);
+    benchmarkCommand("predict ewma", engine, *book, {"predict", "max", product, "ask", "ewma"}, steps);
+    benchmarkCommand("predict linear", engine, *book, {"predict", "max", product, "ask", "linear"}, steps);
+    benchmarkCommand("predict holt", engine, *book, {"predict", "max", product, "ask", "holt"}, steps);
+    benchmarkCommand("list", engine, *book, {"list", "bid"}, steps);
+    return 0;
+}
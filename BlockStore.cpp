@@ -0,0 +1,539 @@
+// include necessary C++ libraries and header files
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "BlockStore.h"
+#include "Snapshot.h"
+#include "OrderStore.h"
+#include "Metrics.h"
+
+namespace {
+    // Fixed-size header at the start of every block file.
+    struct BlockFileHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint64_t sourceSize;
+        std::int64_t sourceModifiedNanos;
+        std::uint64_t rows;
+        std::uint64_t blocks;
+        std::uint32_t rowsPerBlock;
+        std::uint32_t products;
+        std::uint64_t timesteps;
+        std::uint64_t directoryOffset;
+        std::uint64_t directoryLength;
+        std::uint64_t directoryChecksum;
+        // checksum of all the header fields above
+        std::uint64_t headerChecksum;
+    };
+
+    const char blockMagic[8] = {'C', 'I', 'B', 'L', 'O', 'C', 'K', 'S'};
+    const std::uint32_t byteOrderMarker = 0x01020304;
+
+    // Bytes per row of a block: micros, price, amount, product id and side.
+    const std::size_t rowBytes = 2 * sizeof(double) + sizeof(std::int64_t) + sizeof(std::uint32_t) +
+                                 sizeof(std::uint8_t);
+
+    // How much of the CSV file is read at a time while writing.
+    const std::size_t readChunk = 4 << 20;
+
+    // Look up the size and modification time (in nanoseconds) of the source CSV file. Whole seconds aren't enough:
+    // a file rewritten with the same size within the same second would look unchanged.
+    bool sourceInfo(const std::string &filename, std::uint64_t &size, std::int64_t &modifiedNanos) {
+        struct stat info{};
+        if (stat(filename.c_str(), &info) != 0)
+            return false;
+        size = static_cast<std::uint64_t>(info.st_size);
+        modifiedNanos = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+        return true;
+    }
+
+    // Round a position up to the next block boundary.
+    std::uint64_t aligned(std::uint64_t position) {
+        return (position + BlockStore::blockAlignment - 1) / BlockStore::blockAlignment * BlockStore::blockAlignment;
+    }
+
+    // Append the raw bytes of a run of values to a buffer.
+    template<typename T>
+    void appendRaw(std::string &buffer, const T *values, std::size_t count) {
+        buffer.append(reinterpret_cast<const char *>(values), count * sizeof(T));
+    }
+
+    // Copy a run of values out of a buffer, moving the position past them. Returns false if the buffer is too short.
+    template<typename T>
+    bool readRaw(const std::string &buffer, std::size_t &position, T *values, std::size_t count) {
+        if (buffer.size() - position < count * sizeof(T))
+            return false;
+        if (count != 0) std::memcpy(values, buffer.data() + position, count * sizeof(T));
+        position += count * sizeof(T);
+        return true;
+    }
+
+    // Read exactly 'length' bytes at an offset of the file. Returns false on a short read.
+    bool readAt(int fd, void *data, std::size_t length, std::uint64_t offset) {
+        char *target = static_cast<char *>(data);
+        while (length > 0) {
+            ssize_t n = ::pread(fd, target, length, static_cast<off_t>(offset));
+            if (n <= 0)
+                return false;
+            target += n;
+            length -= static_cast<std::size_t>(n);
+            offset += static_cast<std::uint64_t>(n);
+        }
+        return true;
+    }
+
+    // The columns of the block being written.
+    struct PendingBlock {
+        std::vector<std::int64_t> micros;
+        std::vector<double> prices;
+        std::vector<double> amounts;
+        std::vector<std::uint32_t> productIds;
+        std::vector<std::uint8_t> sides;
+
+        std::size_t size() const { return prices.size(); }
+
+        void clear() {
+            micros.clear();
+            prices.clear();
+            amounts.clear();
+            productIds.clear();
+            sides.clear();
+        }
+    };
+}
+
+// The block file lives next to its CSV file.
+std::string BlockStore::pathFor(const std::string &csvFile) {
+    return csvFile + ".blocks";
+}
+
+// Parse the CSV a chunk at a time into a scratch store and cut its rows into blocks as they come
+void BlockStore::write(const std::string &csvFile, const std::string &blockFile, std::uint32_t rowsPerBlock,
+                       LoadProgress *progress) {
+    BlockFileHeader header{};
+    std::memcpy(header.magic, blockMagic, sizeof(header.magic));
+    header.version = version;
+    header.byteOrder = byteOrderMarker;
+    header.rowsPerBlock = rowsPerBlock;
+    if (rowsPerBlock == 0 || !sourceInfo(csvFile, header.sourceSize, header.sourceModifiedNanos))
+        throw std::runtime_error("Could not open " + csvFile);
+    if (progress) progress->bytesTotal = header.sourceSize;
+
+    std::FILE *in = std::fopen(csvFile.c_str(), "rb");
+    if (!in)
+        throw std::runtime_error("Could not open " + csvFile);
+
+    // write to a temporary file first and move it into place once it is complete; the first block starts after
+    // room for the header
+    std::string tempFile = blockFile + ".tmp";
+    std::ofstream out{tempFile, std::ios::binary | std::ios::trunc};
+    if (!out) {
+        std::fclose(in);
+        throw std::runtime_error("Could not write " + tempFile);
+    }
+    std::uint64_t position = blockAlignment;
+    out.seekp(static_cast<std::streamoff>(position));
+
+    Dictionary products;
+    std::vector<std::int64_t> times;
+    std::vector<BlockZone> zones;
+    // the products of every block, as bits over the product ids known when it was written
+    std::vector<std::vector<std::uint64_t>> blockProducts;
+    PendingBlock pending;
+
+    // write the pending rows as one block and note its zone map
+    auto flush = [&]() {
+        std::size_t rows = pending.size();
+        if (rows == 0)
+            return;
+        BlockZone zone;
+        zone.offset = position;
+        zone.rows = static_cast<std::uint32_t>(rows);
+        zone.minMicros = *std::min_element(pending.micros.begin(), pending.micros.end());
+        zone.maxMicros = *std::max_element(pending.micros.begin(), pending.micros.end());
+        zone.minPrice = *std::min_element(pending.prices.begin(), pending.prices.end());
+        zone.maxPrice = *std::max_element(pending.prices.begin(), pending.prices.end());
+        std::vector<std::uint64_t> bits((products.size() + 63) / 64);
+        for (std::uint32_t id: pending.productIds) bits[id / 64] |= std::uint64_t(1) << (id % 64);
+
+        std::string block;
+        block.reserve(rows * rowBytes);
+        appendRaw(block, pending.micros.data(), rows);
+        appendRaw(block, pending.prices.data(), rows);
+        appendRaw(block, pending.amounts.data(), rows);
+        appendRaw(block, pending.productIds.data(), rows);
+        appendRaw(block, pending.sides.data(), rows);
+        out.write(block.data(), static_cast<std::streamsize>(block.size()));
+        position = aligned(position + block.size());
+        out.seekp(static_cast<std::streamoff>(position));
+
+        zones.push_back(zone);
+        blockProducts.push_back(std::move(bits));
+        header.rows += rows;
+        pending.clear();
+    };
+
+    std::string buffer;
+    RejectedRows rejected;
+    bool atEnd = false;
+    while (!atEnd) {
+        // top up the buffer and parse it up to its last complete line (all of it at the end of the file)
+        std::size_t kept = buffer.size();
+        buffer.resize(kept + readChunk);
+        std::size_t got = std::fread(&buffer[kept], 1, readChunk, in);
+        buffer.resize(kept + got);
+        atEnd = got < readChunk;
+        std::size_t cut = atEnd ? buffer.size() : buffer.rfind('\n') + 1;
+        if (cut == 0)
+            continue;
+
+        OrderStore scratch;
+        CSVReader::parseBlock(std::string_view{buffer.data(), cut}, scratch, progress ? &progress->bytesRead : nullptr,
+                              &rejected);
+        buffer.erase(0, cut);
+
+        // carry the chunk's rows over into blocks, with ids of the products of the whole file
+        std::vector<std::uint32_t> productIds;
+        for (const std::string &p: scratch.products.values()) productIds.push_back(products.intern(p));
+        times.insert(times.end(), scratch.timestampMicros.begin(), scratch.timestampMicros.end());
+        for (std::size_t i = 0; i < scratch.size(); ++i) {
+            pending.micros.push_back(scratch.timestampMicros[scratch.timestampIds[i]]);
+            pending.prices.push_back(scratch.prices[i]);
+            pending.amounts.push_back(scratch.amounts[i]);
+            pending.productIds.push_back(productIds[scratch.productIds[i]]);
+            pending.sides.push_back(static_cast<std::uint8_t>(scratch.orderTypes[i]));
+            if (pending.size() == rowsPerBlock) flush();
+        }
+    }
+    flush();
+    bool readFailed = std::ferror(in) != 0;
+    std::fclose(in);
+
+    // the directory: zone maps, product bits padded to the final number of products, time steps, product names
+    std::sort(times.begin(), times.end());
+    times.erase(std::unique(times.begin(), times.end()), times.end());
+    std::size_t words = (products.size() + 63) / 64;
+    std::string directory;
+    appendRaw(directory, zones.data(), zones.size());
+    for (std::vector<std::uint64_t> &bits: blockProducts) {
+        bits.resize(words);
+        appendRaw(directory, bits.data(), words);
+    }
+    appendRaw(directory, times.data(), times.size());
+    std::uint32_t count = static_cast<std::uint32_t>(products.size());
+    appendRaw(directory, &count, 1);
+    std::uint32_t offset = 0;
+    appendRaw(directory, &offset, 1);
+    for (const std::string &p: products.values()) {
+        offset += static_cast<std::uint32_t>(p.size());
+        appendRaw(directory, &offset, 1);
+    }
+    for (const std::string &p: products.values()) directory += p;
+    out.write(directory.data(), static_cast<std::streamsize>(directory.size()));
+
+    header.blocks = zones.size();
+    header.products = count;
+    header.timesteps = times.size();
+    header.directoryOffset = position;
+    header.directoryLength = directory.size();
+    header.directoryChecksum = Snapshot::checksum(directory.data(), directory.size());
+    header.headerChecksum = Snapshot::checksum(&header, offsetof(BlockFileHeader, headerChecksum));
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+
+    if (readFailed || !out || std::rename(tempFile.c_str(), blockFile.c_str()) != 0) {
+        std::remove(tempFile.c_str());
+        throw std::runtime_error("Could not write " + blockFile);
+    }
+    std::cout << "BlockStore::write wrote " << header.rows << " entries in " << header.blocks << " blocks to "
+              << blockFile << " (" << rejected.describe() << ")" << std::endl;
+    if (!CSVReader::writeQuarantine(csvFile, rejected))
+        std::cout << "BlockStore::write couldn't write the rejected rows to " << CSVReader::quarantinePathFor(csvFile)
+                  << std::endl;
+}
+
+// An existing block file is only rewritten when it can't be used
+std::shared_ptr<BlockStore> BlockStore::open(const std::string &csvFile, std::size_t pageBudget,
+                                             LoadProgress *progress) {
+    std::string blockFile = pathFor(csvFile);
+    struct stat info{};
+    if (stat(blockFile.c_str(), &info) == 0) {
+        try {
+            return std::make_shared<BlockStore>(blockFile, csvFile, pageBudget);
+        } catch (const std::runtime_error &e) {
+            std::cout << "BlockStore::open " << e.what() << ", writing it again" << std::endl;
+        }
+    }
+    write(csvFile, blockFile, defaultRowsPerBlock, progress);
+    return std::make_shared<BlockStore>(blockFile, csvFile, pageBudget);
+}
+
+// Validate the header against the CSV file and read the directory; the blocks stay on disk
+BlockStore::BlockStore(const std::string &blockFile, const std::string &csvFile, std::size_t _pageBudget)
+        : pageBudget(_pageBudget) {
+    fd = ::open(blockFile.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Could not open " + blockFile);
+
+    // everything that goes wrong from here on has to close the file again
+    try {
+        struct stat info{};
+        BlockFileHeader header{};
+        std::uint64_t sourceSize;
+        std::int64_t sourceModifiedNanos;
+        if (fstat(fd, &info) != 0 || !readAt(fd, &header, sizeof(header), 0) ||
+            std::memcmp(header.magic, blockMagic, sizeof(header.magic)) != 0 ||
+            header.headerChecksum != Snapshot::checksum(&header, offsetof(BlockFileHeader, headerChecksum)) ||
+            header.version != version || header.byteOrder != byteOrderMarker)
+            throw std::runtime_error(blockFile + " has an unsupported format");
+        if (!sourceInfo(csvFile, sourceSize, sourceModifiedNanos) ||
+            sourceSize != header.sourceSize || sourceModifiedNanos != header.sourceModifiedNanos)
+            throw std::runtime_error(blockFile + " is stale");
+        std::uint64_t fileSize = static_cast<std::uint64_t>(info.st_size);
+        if (header.directoryOffset > fileSize || header.directoryLength > fileSize - header.directoryOffset)
+            throw std::runtime_error(blockFile + " is truncated");
+
+        std::string directory(header.directoryLength, '\0');
+        if (!readAt(fd, &directory[0], directory.size(), header.directoryOffset) ||
+            Snapshot::checksum(directory.data(), directory.size()) != header.directoryChecksum)
+            throw std::runtime_error(blockFile + " failed its checksum");
+
+        rowsPerBlock = header.rowsPerBlock;
+        productWords = (header.products + 63) / 64;
+        zones.resize(header.blocks);
+        productBits.resize(header.blocks * productWords);
+        timesteps.resize(header.timesteps);
+        std::size_t position = 0;
+        std::uint32_t count = 0;
+        std::vector<std::uint32_t> offsets;
+        bool consistent = readRaw(directory, position, zones.data(), zones.size()) &&
+                          readRaw(directory, position, productBits.data(), productBits.size()) &&
+                          readRaw(directory, position, timesteps.data(), timesteps.size()) &&
+                          readRaw(directory, position, &count, 1) && count == header.products;
+        if (consistent) {
+            offsets.resize(count + std::size_t(1));
+            consistent = readRaw(directory, position, offsets.data(), offsets.size()) &&
+                         offsets.back() == directory.size() - position;
+        }
+        for (std::uint32_t p = 0; consistent && p < count; ++p) {
+            consistent = offsets[p] <= offsets[p + 1];
+            if (consistent) storedProducts.push_back(directory.substr(position + offsets[p], offsets[p + 1] - offsets[p]));
+        }
+        // every block has to lie within the file
+        for (const BlockZone &zone: zones)
+            consistent = consistent && zone.offset <= fileSize && zone.rows * rowBytes <= fileSize - zone.offset;
+        if (!consistent)
+            throw std::runtime_error(blockFile + " has an inconsistent directory");
+    } catch (const std::runtime_error &e) {
+        ::close(fd);
+        throw;
+    }
+
+    // the products are handed out in sorted order, like an OrderBook's
+    products = storedProducts;
+    std::sort(products.begin(), products.end());
+    for (const std::string &p: storedProducts)
+        productRanks.push_back(static_cast<std::uint32_t>(
+                std::lower_bound(products.begin(), products.end(), p) - products.begin()));
+}
+
+BlockStore::~BlockStore() {
+    // the mappings stay valid after the descriptor is closed, and go once their last holder lets go
+    if (fd >= 0) ::close(fd);
+}
+
+const std::vector<std::string> &BlockStore::getProducts() const {
+    return products;
+}
+
+const std::vector<std::int64_t> &BlockStore::getTimesteps() const {
+    return timesteps;
+}
+
+// Binary search over the sorted times
+std::pair<std::uint32_t, std::uint32_t> BlockStore::getTimestepsBetween(std::int64_t fromMicros,
+                                                                        std::int64_t toMicros) const {
+    auto first = std::lower_bound(timesteps.begin(), timesteps.end(), fromMicros);
+    auto end = std::upper_bound(first, timesteps.end(), toMicros);
+    return {static_cast<std::uint32_t>(first - timesteps.begin()), static_cast<std::uint32_t>(end - timesteps.begin())};
+}
+
+// Read the blocks whose zone maps allow a match, then group the matches like an OrderBook does
+std::vector<OrderBookEntry> BlockStore::getOrders(OrderBookType type, const std::string &product,
+                                                  std::int64_t fromMicros, std::int64_t toMicros) const {
+    std::vector<OrderBookEntry> orders;
+    std::uint32_t id = Dictionary::npos;
+    if (!product.empty()) {
+        id = storedProductId(product);
+        if (id == Dictionary::npos)
+            return orders;
+    }
+    std::uint8_t side = static_cast<std::uint8_t>(type);
+
+    for (std::size_t b = 0; b < zones.size(); ++b) {
+        if (!mayContain(b, id, fromMicros, toMicros)) {
+            ++blocksSkipped;
+            continue;
+        }
+        ++blocksRead;
+        std::shared_ptr<const MappedBlock> mapped = block(b);
+        // consecutive rows mostly share their time, so its time step is only looked up when it changes
+        std::int64_t lastMicros = 0;
+        std::uint32_t timestep = Dictionary::npos;
+        for (std::size_t i = 0; i < mapped->prices.size(); ++i) {
+            std::int64_t micros = mapped->micros[i];
+            if (micros < fromMicros || micros > toMicros || mapped->sides[i] != side ||
+                (id != Dictionary::npos && mapped->productIds[i] != id))
+                continue;
+            if (timestep == Dictionary::npos || micros != lastMicros) {
+                timestep = static_cast<std::uint32_t>(
+                        std::lower_bound(timesteps.begin(), timesteps.end(), micros) - timesteps.begin());
+                lastMicros = micros;
+            }
+            orders.push_back({mapped->prices[i], mapped->amounts[i], timestep, productRanks[mapped->productIds[i]],
+                              type});
+        }
+    }
+
+    std::stable_sort(orders.begin(), orders.end(), [](const OrderBookEntry &a, const OrderBookEntry &b) {
+        return a.timestampId != b.timestampId ? a.timestampId < b.timestampId : a.productId < b.productId;
+    });
+    return orders;
+}
+
+// Best zone first, stopping as soon as no zone left can beat the price found
+bool BlockStore::getExtreme(OrderBookType type, const std::string &product, std::int64_t fromMicros,
+                            std::int64_t toMicros, bool max, double &price) const {
+    std::uint32_t id = storedProductId(product);
+    if (id == Dictionary::npos)
+        return false;
+    std::uint8_t side = static_cast<std::uint8_t>(type);
+
+    std::vector<std::size_t> candidates;
+    for (std::size_t b = 0; b < zones.size(); ++b) {
+        if (mayContain(b, id, fromMicros, toMicros))
+            candidates.push_back(b);
+    }
+    blocksSkipped += zones.size() - candidates.size();
+    std::sort(candidates.begin(), candidates.end(), [this, max](std::size_t a, std::size_t b) {
+        return max ? zones[a].maxPrice > zones[b].maxPrice : zones[a].minPrice < zones[b].minPrice;
+    });
+
+    bool found = false;
+    for (std::size_t c = 0; c < candidates.size(); ++c) {
+        const BlockZone &zone = zones[candidates[c]];
+        if (found && (max ? zone.maxPrice <= price : zone.minPrice >= price)) {
+            blocksSkipped += candidates.size() - c;
+            break;
+        }
+        ++blocksRead;
+        std::shared_ptr<const MappedBlock> mapped = block(candidates[c]);
+        for (std::size_t i = 0; i < mapped->prices.size(); ++i) {
+            std::int64_t micros = mapped->micros[i];
+            if (micros < fromMicros || micros > toMicros || mapped->sides[i] != side || mapped->productIds[i] != id)
+                continue;
+            double p = mapped->prices[i];
+            if (!found || (max ? p > price : p < price)) {
+                price = p;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+std::size_t BlockStore::memoryUsage() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return mappedBytes;
+}
+
+BlockScanStatistics BlockStore::scanStatistics() const {
+    return {blocksRead.load(), blocksSkipped.load()};
+}
+
+std::string BlockStore::status() const {
+    BlockScanStatistics scans = scanStatistics();
+    std::size_t mapped;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        mapped = cache.size();
+    }
+    std::ostringstream text;
+    text << zones.size() << " blocks of " << rowsPerBlock << " rows, " << mapped << " mapped ("
+         << memoryUsage() / (1024 * 1024) << " MB of " << pageBudget / (1024 * 1024) << " MB)";
+    std::uint64_t scanned = scans.blocksRead + scans.blocksSkipped;
+    if (scanned > 0)
+        text << ", " << scans.blocksSkipped * 100 / scanned << "% skipped";
+    return text.str();
+}
+
+// Map the block's bytes and point the columns into them
+BlockStore::MappedBlock::MappedBlock(int fd, const BlockZone &zone) : length(zone.rows * rowBytes) {
+    address = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(zone.offset));
+    if (address == MAP_FAILED)
+        throw std::runtime_error("Could not map a block of the block file");
+    const char *bytes = static_cast<const char *>(address);
+    std::size_t rows = zone.rows;
+    micros = {reinterpret_cast<const std::int64_t *>(bytes), rows};
+    prices = {reinterpret_cast<const double *>(bytes + rows * sizeof(std::int64_t)), rows};
+    amounts = {reinterpret_cast<const double *>(bytes + rows * (sizeof(std::int64_t) + sizeof(double))), rows};
+    productIds = {reinterpret_cast<const std::uint32_t *>(bytes + rows * (sizeof(std::int64_t) + 2 * sizeof(double))),
+                  rows};
+    sides = {reinterpret_cast<const std::uint8_t *>(bytes + rows * (rowBytes - sizeof(std::uint8_t))), rows};
+}
+
+BlockStore::MappedBlock::~MappedBlock() {
+    if (address != MAP_FAILED && length > 0) ::munmap(address, length);
+}
+
+// Look the block up among the mapped ones; a miss makes room under the budget first
+std::shared_ptr<const BlockStore::MappedBlock> BlockStore::block(std::size_t b) const {
+    std::lock_guard<std::mutex> lock{mutex};
+    for (CacheEntry &entry: cache) {
+        if (entry.block == b) {
+            entry.lastUsed = ++uses;
+            return entry.mapped;
+        }
+    }
+
+    std::size_t length = zones[b].rows * rowBytes;
+    while (!cache.empty() && mappedBytes + length > pageBudget) {
+        auto oldest = std::min_element(cache.begin(), cache.end(), [](const CacheEntry &x, const CacheEntry &y) {
+            return x.lastUsed < y.lastUsed;
+        });
+        mappedBytes -= oldest->mapped->length;
+        cache.erase(oldest);
+    }
+    std::shared_ptr<const MappedBlock> mapped = std::make_shared<MappedBlock>(fd, zones[b]);
+    cache.push_back({b, mapped, ++uses});
+    mappedBytes += length;
+    Metrics::setMemory("blocks", mappedBytes);
+    return mapped;
+}
+
+// The times must overlap and the product (if there is one) must be among the block's
+bool BlockStore::mayContain(std::size_t b, std::uint32_t productId, std::int64_t fromMicros,
+                            std::int64_t toMicros) const {
+    const BlockZone &zone = zones[b];
+    if (zone.maxMicros < fromMicros || zone.minMicros > toMicros)
+        return false;
+    if (productId == Dictionary::npos)
+        return true;
+    return (productBits[b * productWords + productId / 64] >> (productId % 64) & 1) != 0;
+}
+
+// The stored ids are in the order the products first appear, so the names are searched
+std::uint32_t BlockStore::storedProductId(const std::string &product) const {
+    auto it = std::find(storedProducts.begin(), storedProducts.end(), product);
+    return it == storedProducts.end() ? Dictionary::npos : static_cast<std::uint32_t>(it - storedProducts.begin());
+}
@@ -0,0 +1,176 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_BLOCKSTORE_H
+#define ADVISORBOT_BLOCKSTORE_H
+
+// include necessary standard C++ libraries and header files
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "CSVReader.h"
+#include "ColumnSpan.h"
+#include "OrderBookEntry.h"
+
+/*
+Out-of-core storage for data files larger than memory: the orders live on disk in fixed-size column blocks that are
+mapped one at a time when a query needs them, and only a small directory with a zone map of every block stays in
+memory. A query first looks at the zone maps and skips every block that can't hold a matching order, so filters on
+time and product, and min/max, read a small part of the file.
+
+Layout of the block file (native byte order), written next to the CSV file the first time it is opened:
+    header     magic "CIBLOCKS", format version, byte order marker, size and modification time (in nanoseconds) of
+               the source CSV file, rows, blocks, rows per block, products, timesteps, where the directory is and how
+               long it is, a checksum of the directory and one of the header itself
+    blocks     each on a boundary of blockAlignment bytes, so it can be mapped on its own; a block of n rows holds
+               int64 micros[n], double prices[n], double amounts[n], uint32 productIds[n], uint8 sides[n]
+    directory  BlockZone zones[blocks], uint64 product bits[blocks][(products + 63) / 64], int64 timestep
+               micros[timesteps], then the product names: uint32 count, uint32 offsets[count + 1], characters
+
+The rows keep their order in the CSV file. Product ids are in the order the products first appear and are turned
+into positions in the sorted product list when they leave the store.
+*/
+
+// What the directory knows about one block without reading it: its place in the file and its zone map.
+struct BlockZone {
+    std::uint64_t offset = 0;
+    std::uint32_t rows = 0;
+    std::uint32_t reserved = 0;
+    std::int64_t minMicros = 0;
+    std::int64_t maxMicros = 0;
+    double minPrice = 0;
+    double maxPrice = 0;
+};
+
+// How many blocks queries have read and how many their zone maps let them skip.
+struct BlockScanStatistics {
+    std::uint64_t blocksRead = 0;
+    std::uint64_t blocksSkipped = 0;
+};
+
+// Column block file of one CSV data file, with the blocks mapped on demand under a page budget. The least recently
+// used blocks are unmapped once the mapped blocks take up more than the budget; a block that a query is still
+// reading stays mapped until it is done, so at least one block is always mapped. Safe to use from several threads.
+class BlockStore {
+    public:
+        // Rows per block when writing, about 2 MB of columns.
+        static const std::uint32_t defaultRowsPerBlock = 65536;
+
+        // Blocks start on multiples of this, which is a multiple of the page size of every common platform.
+        static const std::uint64_t blockAlignment = 65536;
+
+        // Current version of the block file format. Bump whenever the layout changes.
+        static const std::uint32_t version = 2;
+
+        // Return the path of the block file that belongs to the given CSV data file.
+        static std::string pathFor(const std::string &csvFile);
+
+        // Read a CSV data file a few megabytes at a time and write it as a block file, so that it never has to fit
+        // in memory. Reports the bytes read to 'progress', if given. Throws std::runtime_error if either file
+        // can't be read or written; a failed write never leaves a partial file behind.
+        static void write(const std::string &csvFile, const std::string &blockFile,
+                          std::uint32_t rowsPerBlock = defaultRowsPerBlock, LoadProgress *progress = nullptr);
+
+        // Open the block file of a CSV data file, writing it first if it is missing or older than the CSV file.
+        // Throws std::runtime_error if it can't be written or read.
+        static std::shared_ptr<BlockStore> open(const std::string &csvFile, std::size_t pageBudget,
+                                                LoadProgress *progress = nullptr);
+
+        // Read the header and directory of a block file written for the given CSV file. Throws std::runtime_error
+        // if the block file is missing, stale or corrupt.
+        BlockStore(const std::string &blockFile, const std::string &csvFile, std::size_t _pageBudget);
+
+        // Unmap the blocks and close the file.
+        ~BlockStore();
+
+        // A store owns its descriptor and mappings, so it can be neither copied nor assigned.
+        BlockStore(const BlockStore &) = delete;
+        BlockStore &operator=(const BlockStore &) = delete;
+
+        // Retrieve the products, sorted in ascending order.
+        const std::vector<std::string> &getProducts() const;
+
+        // Retrieve the time of every time step, in microseconds since the epoch, in time order.
+        const std::vector<std::int64_t> &getTimesteps() const;
+
+        // Return the time steps whose time lies within [fromMicros, toMicros] as the ids [first, end).
+        std::pair<std::uint32_t, std::uint32_t> getTimestepsBetween(std::int64_t fromMicros, std::int64_t toMicros) const;
+
+        // Return the Orders of one order type whose time lies within [fromMicros, toMicros], of one product or of
+        // every product if it is empty. The entries carry time step ids and positions in getProducts(), and are
+        // grouped by time step, then product, like an OrderBook's.
+        std::vector<OrderBookEntry> getOrders(OrderBookType type, const std::string &product,
+                                              std::int64_t fromMicros, std::int64_t toMicros) const;
+
+        // Find the lowest (max == false) or highest price of one product and order type within [fromMicros,
+        // toMicros]. The blocks are read best zone first, and the rest are skipped as soon as their zone can't
+        // beat the price found so far. Returns false if there is no such order.
+        bool getExtreme(OrderBookType type, const std::string &product, std::int64_t fromMicros,
+                        std::int64_t toMicros, bool max, double &price) const;
+
+        // Return how many bytes of blocks are mapped at the moment.
+        std::size_t memoryUsage() const;
+
+        // Return the counts of blocks read and skipped since the store was opened.
+        BlockScanStatistics scanStatistics() const;
+
+        // Describe the store, e.g. "1526 blocks of 65536 rows, 32 mapped (64 MB of 64 MB), 97% skipped".
+        std::string status() const;
+
+    private:
+        // One block mapped into memory, with views of its columns; unmapped when the last holder lets go.
+        struct MappedBlock {
+            MappedBlock(int fd, const BlockZone &zone);
+            ~MappedBlock();
+
+            void *address = nullptr;
+            std::size_t length = 0;
+            ColumnSpan<std::int64_t> micros;
+            ColumnSpan<double> prices;
+            ColumnSpan<double> amounts;
+            ColumnSpan<std::uint32_t> productIds;
+            ColumnSpan<std::uint8_t> sides;
+        };
+
+        struct CacheEntry {
+            std::size_t block;
+            std::shared_ptr<const MappedBlock> mapped;
+            std::uint64_t lastUsed;
+        };
+
+        // Return a block, mapping it (and unmapping the least recently used ones) if it isn't mapped.
+        std::shared_ptr<const MappedBlock> block(std::size_t b) const;
+
+        // Determine whether a block's zone map allows orders of the product (a stored id) within the times.
+        bool mayContain(std::size_t b, std::uint32_t productId, std::int64_t fromMicros, std::int64_t toMicros) const;
+
+        // Return the stored id of a product, or Dictionary::npos if the file has none of it.
+        std::uint32_t storedProductId(const std::string &product) const;
+
+        int fd = -1;
+        std::size_t pageBudget;
+        std::uint32_t rowsPerBlock = 0;
+
+        // the directory
+        std::vector<BlockZone> zones;
+        std::vector<std::uint64_t> productBits;
+        std::size_t productWords = 0;
+        std::vector<std::int64_t> timesteps;
+        // product names in stored id order, sorted, and the sorted position of every stored id
+        std::vector<std::string> storedProducts;
+        std::vector<std::string> products;
+        std::vector<std::uint32_t> productRanks;
+
+        // the mapped blocks, in no particular order
+        mutable std::mutex mutex;
+        mutable std::vector<CacheEntry> cache;
+        mutable std::size_t mappedBytes = 0;
+        mutable std::uint64_t uses = 0;
+        mutable std::atomic<std::uint64_t> blocksRead{0};
+        mutable std::atomic<std::uint64_t> blocksSkipped{0};
+};
+
+#endif //ADVISORBOT_BLOCKSTORE_H
@@ -1,16 +1,77 @@
 // include necessary C++ libraries and header files
+#include <chrono>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <charconv>
+#include <thread>
+#include <cstdio>
+#include <sstream>
 #include "CSVReader.h"
+#include "MappedFile.h"
 #include "OrderBookEntry.h"
+#include "Timestamp.h"
+#include "Metrics.h"
+
+namespace {
+    // Convert a price or amount token, the whole of which has to be a number
+    bool toNumber(std::string_view token, double &value) {
+        const char *last = token.data() + token.size();
+        auto result = std::from_chars(token.data(), last, value);
+        return result.ec == std::errc() && result.ptr == last;
+    }
+}
+
+void RejectedRows::add(RowError error, std::string_view line) {
+    ++counts[static_cast<std::size_t>(error)];
+    if (lines.size() + line.size() + 1 > maxLineBytes) {
+        ++dropped;
+        return;
+    }
+    lines.append(line);
+    lines += '\n';
+}
+
+// The other part's lines are kept whole or not at all
+void RejectedRows::merge(const RejectedRows &other) {
+    for (std::size_t e = 0; e < 5; ++e) counts[e] += other.counts[e];
+    dropped += other.dropped;
+    if (lines.size() + other.lines.size() > maxLineBytes)
+        dropped += static_cast<std::size_t>(std::count(other.lines.begin(), other.lines.end(), '\n'));
+    else
+        lines += other.lines;
+}
+
+std::size_t RejectedRows::total() const {
+    std::size_t sum = 0;
+    for (std::size_t count: counts) sum += count;
+    return sum;
+}
+
+// Only the reasons that occurred are listed
+std::string RejectedRows::describe() const {
+    static const char *reasons[5] = {"", "wrong token count", "bad float", "bad timestamp", "unknown side"};
+    std::ostringstream text;
+    text << total() << " bad rows";
+    const char *separator = ": ";
+    for (std::size_t e = 1; e < 5; ++e) {
+        if (counts[e] == 0) continue;
+        text << separator << counts[e] << " " << reasons[e];
+        separator = ", ";
+    }
+    return text.str();
+}
 
 // Default constructor
 CSVReader::CSVReader() = default;
 
 // Read a CSV data file and convert the records into a vector of OrderBookEntry objects.
-// Takes a string representing the file path as input.
+// Takes a string representing the file path and the dictionaries to intern timestamps and products into.
 // Returns a vector of OrderBookEntry objects.
-std::vector<OrderBookEntry> CSVReader::readCSV(const std::string &csvFilename) {
+std::vector<OrderBookEntry> CSVReader::readCSV(const std::string &csvFilename,
+                                               Dictionary &timestamps, Dictionary &products,
+                                               RejectedRows *rejected) {
     // vector to store OrderBookEntry objects
     std::vector<OrderBookEntry> entries;
 
@@ -26,25 +87,182 @@ std::vector<OrderBookEntry> CSVReader::readCSV(const std::string &csvFilename) {
     }
 
     // read file line by line
+    std::size_t badRows = 0, bytes = 0;
     while (fgets(line_buffer, 1024, fp) != nullptr) {
-        try {
-            // convert line to OrderBookEntry object
-            OrderBookEntry obe = stringsToOBE(tokenise(line_buffer, ','));
-            // add OrderBookEntry object to vector
-            entries.push_back(obe);
-        } 
-        // if there is an error in the data, catch it and print a message
-        catch (const std::exception &e) {
-            std::cout << "CSVReader::readCSV bad data - " << e.what() << std::endl;
+        std::size_t length = std::strlen(line_buffer);
+        bytes += length;
+        // the line break is not part of the record, and blank lines are not rows
+        while (length > 0 && (line_buffer[length - 1] == '\n' || line_buffer[length - 1] == '\r')) --length;
+        if (length == 0) continue;
+
+        // convert line to OrderBookEntry object and add it to the vector; a bad row is only counted, since
+        // printing every one of them would slow down the load far more than parsing does
+        std::string line{line_buffer, length};
+        RowError error = stringsToOBE(tokenise(line, ','), timestamps, products, entries);
+        if (error != RowError::none) {
+            ++badRows;
+            if (rejected) rejected->add(error, line);
         }
     }
+    Metrics::add(Counter::rowsParsed, entries.size());
+    Metrics::add(Counter::badRows, badRows);
+    Metrics::add(Counter::bytesRead, bytes);
 
     // close file
     fclose(fp);
-    std::cout << "CSVReader::readCSV read " << entries.size() << " entries" << std::endl;
+    std::cout << "CSVReader::readCSV read " << entries.size() << " entries (" << badRows << " bad rows)"
+              << std::endl;
     return entries;
 }
 
+// Map a CSV data file into memory and parse its records in place.
+// Rows are appended straight to the columns of 'store'; malformed rows are counted and skipped.
+std::size_t CSVReader::readCSVMapped(const std::string &csvFilename, OrderStore &store, LoadProgress *progress,
+                                     RejectedRows *rejected) {
+    // map the whole file, this throws if the file cannot be opened
+    MappedFile file{csvFilename};
+    std::string_view data = file.view();
+    if (progress) progress->bytesTotal = data.size();
+
+    // every row in the dataset is roughly 60 bytes long, reserve accordingly to avoid regrowing the columns
+    store.reserve(store.size() + data.size() / 60);
+
+    std::size_t before = store.size();
+    std::size_t badRows = parseBlock(data, store, progress ? &progress->bytesRead : nullptr, rejected);
+
+    std::cout << "CSVReader::readCSVMapped read " << store.size() - before << " entries ("
+              << badRows << " bad rows)" << std::endl;
+    return badRows;
+}
+
+// Map a CSV data file into memory and parse line-aligned chunks of it concurrently.
+std::size_t CSVReader::readCSVParallel(const std::string &csvFilename, OrderStore &store, unsigned threads,
+                                       LoadProgress *progress, RejectedRows *rejected) {
+    MappedFile file{csvFilename};
+    std::string_view data = file.view();
+    if (progress) progress->bytesTotal = data.size();
+
+    // pick the number of workers, but don't bother splitting chunks smaller than 1 MiB
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t minChunk = 1 << 20;
+    std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(threads, data.size() / minChunk));
+
+    // cut the file into byte ranges, moving every cut forward to just after the next line break
+    std::vector<std::size_t> bounds{0};
+    for (std::size_t i = 1; i < chunks; ++i) {
+        std::size_t cut = std::max(bounds.back(), data.size() * i / chunks);
+        std::size_t newline = data.find('\n', cut);
+        cut = newline == std::string_view::npos ? data.size() : newline + 1;
+        if (cut > bounds.back() && cut < data.size()) bounds.push_back(cut);
+    }
+    bounds.push_back(data.size());
+
+    // parse every range on its own thread into its own store, with its own dictionaries
+    std::size_t ranges = bounds.size() - 1;
+    std::vector<OrderStore> parts(ranges);
+    std::vector<std::size_t> badRowsPerPart(ranges, 0);
+    std::vector<RejectedRows> rejectedPerPart(rejected ? ranges : 0);
+    std::vector<std::thread> workers;
+    workers.reserve(ranges);
+    for (std::size_t i = 0; i < ranges; ++i) {
+        workers.emplace_back([&, i]() {
+            std::string_view block = data.substr(bounds[i], bounds[i + 1] - bounds[i]);
+            parts[i].reserve(block.size() / 60);
+            badRowsPerPart[i] = parseBlock(block, parts[i], progress ? &progress->bytesRead : nullptr,
+                                           rejected ? &rejectedPerPart[i] : nullptr);
+        });
+    }
+    for (std::thread &worker: workers) worker.join();
+
+    // merge the parts in range order so that rows keep their position in the file, and values get the same
+    // global ids they would have received from a serial load
+    std::size_t total = store.size();
+    std::size_t badRows = 0;
+    for (std::size_t i = 0; i < ranges; ++i) {
+        total += parts[i].size();
+        badRows += badRowsPerPart[i];
+        if (rejected) rejected->merge(rejectedPerPart[i]);
+    }
+    std::size_t before = store.size();
+    store.reserve(total);
+    for (OrderStore &part: parts) {
+        // translate the ids of this part into ids of the shared dictionaries
+        std::vector<std::uint32_t> timestampIds, productIds;
+        for (const std::string &t: part.timestamps.values()) timestampIds.push_back(store.internTimestamp(t));
+        for (const std::string &p: part.products.values()) productIds.push_back(store.products.intern(p));
+
+        // append column by column
+        store.prices.insert(store.prices.end(), part.prices.begin(), part.prices.end());
+        store.amounts.insert(store.amounts.end(), part.amounts.begin(), part.amounts.end());
+        store.orderTypes.insert(store.orderTypes.end(), part.orderTypes.begin(), part.orderTypes.end());
+        for (std::uint32_t id: part.timestampIds) store.timestampIds.push_back(timestampIds[id]);
+        for (std::uint32_t id: part.productIds) store.productIds.push_back(productIds[id]);
+
+        // release each part as soon as it has been merged
+        part = OrderStore{};
+    }
+
+    std::cout << "CSVReader::readCSVParallel read " << store.size() - before << " entries ("
+              << badRows << " bad rows) using " << ranges << " thread(s)" << std::endl;
+    return badRows;
+}
+
+// Read a CSV data file using the given options and report how many rows per second were ingested.
+void CSVReader::load(const std::string &csvFilename, const LoadOptions &options, OrderStore &store) {
+    std::size_t before = store.size();
+
+    auto start = std::chrono::steady_clock::now();
+    RejectedRows rejected;
+    if (options.mode == LoadMode::parallel) {
+        readCSVParallel(csvFilename, store, options.threads, options.progress, &rejected);
+    } else if (options.mode == LoadMode::mapped) {
+        readCSVMapped(csvFilename, store, options.progress, &rejected);
+    } else {
+        std::vector<OrderBookEntry> entries = readCSV(csvFilename, store.timestamps, store.products, &rejected);
+        store.reserve(store.size() + entries.size());
+        for (const OrderBookEntry &e: entries) store.append(e);
+        // the original reader interns timestamps as plain text, so parse the new ones now
+        store.parseTimestamps();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    // guard against a zero duration on tiny files
+    std::size_t rows = store.size() - before;
+    double seconds = std::max(elapsed.count(), 1e-9);
+    std::cout << "CSVReader::load " << rows << " rows in " << seconds * 1000.0 << " ms ("
+              << static_cast<long long>(rows / seconds) << " rows/s)" << std::endl;
+
+    // one line about the rejected rows, whose text goes to the quarantine file rather than the console
+    std::string quarantineFile = quarantinePathFor(csvFilename);
+    bool written = writeQuarantine(csvFilename, rejected);
+    if (rejected.total() > 0) {
+        std::cout << "CSVReader::load rejected " << rejected.describe();
+        if (written)
+            std::cout << ", written to " << quarantineFile;
+        else
+            std::cout << ", couldn't write them to " << quarantineFile;
+        std::cout << std::endl;
+    }
+}
+
+// The quarantine file lives next to its CSV file.
+std::string CSVReader::quarantinePathFor(const std::string &csvFile) {
+    return csvFile + ".rejected";
+}
+
+// All the kept lines go out in a single write
+bool CSVReader::writeQuarantine(const std::string &csvFile, const RejectedRows &rejected, bool append) {
+    std::string quarantineFile = quarantinePathFor(csvFile);
+    if (rejected.total() == 0) {
+        // a stale quarantine file would blame rows the data file no longer has
+        if (!append) std::remove(quarantineFile.c_str());
+        return true;
+    }
+    std::ofstream out{quarantineFile, append ? std::ios::app : std::ios::trunc};
+    out.write(rejected.lines.data(), static_cast<std::streamsize>(rejected.lines.size()));
+    return static_cast<bool>(out);
+}
+
 std::vector<std::string> CSVReader::tokenise(const std::string &csvLine, char separator) {
     // vector to store tokens
     std::vector<std::string> tokens;
@@ -72,25 +290,112 @@ std::vector<std::string> CSVReader::tokenise(const std::string &csvLine, char se
     return tokens;
 }
 
-OrderBookEntry CSVReader::stringsToOBE(std::vector<std::string> tokens) {
-    double price;
-    // if there are not 5 tokens, there is an error in the data
-    if (tokens.size() != 5) {
-        std::cout << "Bad line, expected 5 tokens, got: " << tokens.size() << std::endl;
-        throw std::exception{};
+// Split a CSV record into views of its fields. Unlike the std::string overload, empty fields are kept
+// so that a record with a missing value is reported with the wrong number of tokens.
+std::size_t CSVReader::tokenise(std::string_view csvLine, char separator,
+                                std::string_view *tokens, std::size_t maxTokens) {
+    std::size_t count = 0;
+    std::size_t start = 0;
+    while (true) {
+        std::size_t end = csvLine.find(separator, start);
+        if (end == std::string_view::npos) end = csvLine.size();
+
+        // only store as many tokens as the caller has room for, but keep counting
+        if (count < maxTokens) tokens[count] = csvLine.substr(start, end - start);
+        ++count;
+
+        if (end == csvLine.size()) break;
+        start = end + 1;
     }
-    // there are 5 tokens
-    try {
-        // convert token to double
-        price = std::stod(tokens[3]);
-    } 
-    // if there is an error converting the token to double, throw an exception
-    catch (std::exception &e) {
-        std::cout << "CSVReader::stringsToOBE Bad float! " << tokens[3] << std::endl;
-        std::cout << "CSVReader::stringsToOBE Bad float! " << tokens[4] << std::endl;
-        throw;
+    return count;
+}
+
+// Parse every line in a block of CSV text. Returns the number of malformed rows.
+std::size_t CSVReader::parseBlock(std::string_view block, OrderStore &store, std::atomic<std::size_t> *bytesRead,
+                                  RejectedRows *rejected) {
+    std::size_t before = store.size();
+    std::size_t badRows = 0;
+    std::size_t pos = 0;
+    // where the bytes reported so far end
+    std::size_t reported = 0;
+
+    // walk the block line by line
+    while (pos < block.size()) {
+        // report progress in steps of about a megabyte, so the counter isn't contended
+        if (bytesRead && pos - reported >= (1 << 20)) {
+            *bytesRead += pos - reported;
+            reported = pos;
+        }
+
+        std::size_t end = block.find('\n', pos);
+        if (end == std::string_view::npos) end = block.size();
+
+        std::string_view line = block.substr(pos, end - pos);
+        pos = end + 1;
+
+        // tolerate files with windows line endings
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        // blank lines are not rows
+        if (line.empty()) continue;
+
+        RowError error = parseLine(line, store);
+        if (error != RowError::none) {
+            ++badRows;
+            if (rejected) rejected->add(error, line);
+        }
     }
-    // create OrderBookEntry object with the converted price and the remaining tokens
-    OrderBookEntry obe{price, tokens[0], tokens[1], OrderBookEntry::stringToOrderBookType(tokens[2])};
-    return obe;
+    if (bytesRead) *bytesRead += block.size() - reported;
+    // one update of the counters per block, not per row
+    Metrics::add(Counter::rowsParsed, store.size() - before);
+    Metrics::add(Counter::badRows, badRows);
+    Metrics::add(Counter::bytesRead, block.size());
+    return badRows;
+}
+
+// Convert one raw CSV line to an order without throwing or printing.
+RowError CSVReader::parseLine(std::string_view line, OrderStore &store) {
+    std::string_view tokens[5];
+    // a valid record has exactly 5 tokens
+    if (tokenise(line, ',', tokens, 5) != 5)
+        return RowError::tokenCount;
+
+    // convert the price and amount tokens, the whole of each token has to be a number
+    double price, amount;
+    if (!toNumber(tokens[3], price) || !toNumber(tokens[4], amount))
+        return RowError::badFloat;
+
+    // checked before the timestamp, so that a rejected row never adds a time step
+    OrderBookType orderType = OrderBookEntry::stringToOrderBookType(tokens[2]);
+    if (orderType == OrderBookType::unknown)
+        return RowError::unknownSide;
+
+    // the timestamp is parsed the first time it is seen, and has to be a valid time
+    std::uint32_t timestampId = store.internTimestamp(tokens[0]);
+    if (timestampId == Dictionary::npos)
+        return RowError::badTimestamp;
+
+    store.append(price, amount, timestampId, store.products.intern(tokens[1]), orderType);
+    return RowError::none;
+}
+
+RowError CSVReader::stringsToOBE(const std::vector<std::string> &tokens, Dictionary &timestamps,
+                                 Dictionary &products, std::vector<OrderBookEntry> &entries) {
+    // if there are not 5 tokens, there is an error in the data
+    if (tokens.size() != 5)
+        return RowError::tokenCount;
+    // there are 5 tokens, convert the price and amount to doubles
+    double price, amount;
+    if (!toNumber(tokens[3], price) || !toNumber(tokens[4], amount))
+        return RowError::badFloat;
+    // the order type has to be bid or ask
+    OrderBookType orderType = OrderBookEntry::stringToOrderBookType(tokens[2]);
+    if (orderType == OrderBookType::unknown)
+        return RowError::unknownSide;
+    // the timestamp has to be a valid time
+    std::int64_t micros;
+    if (!Timestamp::parse(tokens[0], micros))
+        return RowError::badTimestamp;
+    // create OrderBookEntry object with the converted price and amount and the remaining tokens
+    entries.emplace_back(price, amount, timestamps.intern(tokens[0]), products.intern(tokens[1]), orderType);
+    return RowError::none;
 }
\ No newline at end of file
@@ -4,8 +4,14 @@
 #define ADVISORBOT_CSVREADER_H
 
 // include necessary standard C++ libraries and header files
+#include <atomic>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include "Dictionary.h"
+#include "OrderStore.h"
 #include "OrderBookEntry.h"
 
 /*
@@ -14,6 +20,74 @@ Some of the code in this module is based on the CSVReader module introduced in t
 modifications made by the author of this module. The original code is used with permission.
 */
 
+// Ingestion strategies supported by CSVReader::load.
+enum class LoadMode {
+    stream, // read line by line with fgets (the original reader)
+    mapped, // map the whole file into memory and parse it in place
+    parallel // map the whole file and parse line-aligned chunks of it on several threads
+};
+
+// How far a load has got, in order: reading the file, products and timestamps known (the dictionaries are sorted),
+// everything indexed and summarised, or given up.
+enum class LoadStage { reading, dictionaries, ready, failed };
+
+// Progress of a load, for another thread to watch. bytesTotal is 0 until the size of the file is known.
+struct LoadProgress {
+    std::atomic<std::size_t> bytesRead{0};
+    std::atomic<std::size_t> bytesTotal{0};
+    std::atomic<LoadStage> stage{LoadStage::reading};
+};
+
+// Options controlling how a CSV data file is ingested.
+struct LoadOptions {
+    LoadMode mode = LoadMode::parallel;
+    // number of parser threads for LoadMode::parallel, 0 means one per hardware thread
+    unsigned threads = 0;
+    // load from (and write) a binary snapshot next to the CSV file, see Snapshot.h
+    bool useSnapshot = true;
+    // keep the file open after loading it and pick up lines appended to it later, see OrderBook::follow
+    bool follow = false;
+    // if set, updated as the load goes on
+    LoadProgress *progress = nullptr;
+    // keep the orders in column blocks on disk instead of in memory, see BlockStore.h (used by Dataset)
+    bool blocks = false;
+};
+
+// Why a row of a CSV data file was rejected.
+enum class RowError : std::uint8_t {
+    none,
+    tokenCount, // not exactly 5 fields
+    badFloat, // the price or amount isn't a number
+    badTimestamp, // the timestamp isn't a valid time
+    unknownSide // the order type is neither bid nor ask
+};
+
+// The rows a load rejected: how many for each reason, and the lines themselves, which are written to the
+// quarantine file in one go once the load is done. Only the first maxLineBytes of lines are kept; the rest are
+// still counted.
+struct RejectedRows {
+    static const std::size_t maxLineBytes = 64 << 20;
+
+    // Count a rejected line and keep it if there is room.
+    void add(RowError error, std::string_view line);
+
+    // Add the rows rejected by the next part of the same load.
+    void merge(const RejectedRows &other);
+
+    // Return the number of rejected rows.
+    std::size_t total() const;
+
+    // Describe the counts, e.g. "3 bad rows: 1 wrong token count, 2 bad float".
+    std::string describe() const;
+
+    // indexed by RowError, RowError::none is never counted
+    std::size_t counts[5] = {};
+    // the kept lines, each followed by a line break, in file order
+    std::string lines;
+    // lines that were counted but not kept
+    std::size_t dropped = 0;
+};
+
 // Class for reading CSV data and converting records into OrderBookEntry objects
 class CSVReader {
     public:
@@ -21,20 +95,64 @@ class CSVReader {
         CSVReader();
 
         // Read a CSV data file and convert the records into a vector of OrderBookEntry objects.
-        // Takes a string representing the file path as input.
-        // Returns a vector of OrderBookEntry objects.
-        static std::vector<OrderBookEntry> readCSV(const std::string &csvFile);
+        // Takes a string representing the file path and the dictionaries to intern timestamps and products into.
+        // Returns a vector of OrderBookEntry objects. Malformed rows are skipped and added to 'rejected', if given.
+        static std::vector<OrderBookEntry> readCSV(const std::string &csvFile,
+                                                   Dictionary &timestamps, Dictionary &products,
+                                                   RejectedRows *rejected = nullptr);
+
+        // Map a CSV data file into memory and parse its records in place, appending them to the columns of 'store'.
+        // Lines are tokenised as string_views and prices are parsed with std::from_chars.
+        // Returns the number of malformed rows that were skipped, which are added to 'rejected', if given. Reports
+        // the bytes parsed to 'progress', if given.
+        static std::size_t readCSVMapped(const std::string &csvFile, OrderStore &store,
+                                         LoadProgress *progress = nullptr, RejectedRows *rejected = nullptr);
+
+        // Map a CSV data file into memory, split it into line-aligned byte ranges and parse each range on its
+        // own thread. The per-range results are appended to 'store' in file order, so the outcome is
+        // identical to readCSVMapped. Returns the number of malformed rows that were skipped, which are added to
+        // 'rejected' in file order, if given. Reports the bytes parsed to 'progress', if given.
+        static std::size_t readCSVParallel(const std::string &csvFile, OrderStore &store, unsigned threads,
+                                           LoadProgress *progress = nullptr, RejectedRows *rejected = nullptr);
+
+        // Read a CSV data file into 'store' using the given options and report the ingestion rate in rows per second.
+        // The rejected rows are written to the quarantine file and summed up in one line.
+        static void load(const std::string &csvFile, const LoadOptions &options, OrderStore &store);
+
+        // Return the path of the quarantine file that holds the rejected rows of the given CSV data file.
+        static std::string quarantinePathFor(const std::string &csvFile);
+
+        // Write the rejected rows of a CSV data file to its quarantine file in one go, replacing the file or
+        // appending to it. Replacing it with no rejected rows removes it. Returns false if it can't be written.
+        static bool writeQuarantine(const std::string &csvFile, const RejectedRows &rejected, bool append = false);
 
         // Split a CSV record (line) into a vector of individual values (tokens).
         // Takes a string representing a CSV record and a character separator as input.
         // Returns a vector of strings, where each string is a token in the record.
         static std::vector<std::string> tokenise(const std::string &csvLine, char separator);
 
+        // Split a CSV record into at most 'maxTokens' views without copying any characters.
+        // Returns the number of tokens in the record, which can be larger than 'maxTokens'.
+        static std::size_t tokenise(std::string_view csvLine, char separator,
+                                    std::string_view *tokens, std::size_t maxTokens);
+
+        // Parse every line in a block of CSV text that is already in memory, appending valid rows to 'store'.
+        // Returns the number of malformed rows in the block, which are added to 'rejected', if given. Adds the
+        // bytes parsed to 'bytesRead' every megabyte or so, if given.
+        static std::size_t parseBlock(std::string_view block, OrderStore &store,
+                                      std::atomic<std::size_t> *bytesRead = nullptr,
+                                      RejectedRows *rejected = nullptr);
+
     private:
         // A private utility function that helps convert raw CSV rows to OrderBookEntry objects.
-        // Takes a vector of strings as input, where each string represents a token in the CSV record.
-        // Returns an OrderBookEntry object.
-        static OrderBookEntry stringsToOBE(std::vector<std::string> tokens);
+        // Takes a vector of strings as input, where each string represents a token in the CSV record, and appends
+        // the entry to 'entries'. Returns why the row is malformed, or RowError::none; never throws or prints.
+        static RowError stringsToOBE(const std::vector<std::string> &tokens, Dictionary &timestamps,
+                                     Dictionary &products, std::vector<OrderBookEntry> &entries);
+
+        // Convert one raw CSV line to an order and append it to 'store'.
+        // Returns why the line is malformed, or RowError::none; never throws or prints.
+        static RowError parseLine(std::string_view line, OrderStore &store);
 };
 
 
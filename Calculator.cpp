@@ -1,87 +1,87 @@
 #include "CSVReader.h"
 #include "Calculator.h"
+#include "Timestamp.h"
 
 // Calculate the average price of orders in a given vector of OrderBookEntry objects.
 double Calculator::calculateAveragePriceOfOrders(const std::vector<OrderBookEntry> &orders) {
-    // Return 0 if the vector is empty.
-    if (orders.empty())
-        return 0;
-
-    double acc = 0;
-    // Iterate through each OrderBookEntry in the vector and add the price to the accumulator.
-    for (const OrderBookEntry &e: orders) {
-        acc += e.price;
-    }
-
-    // Return the average by dividing the total price by the number of orders.
-    return acc / (double) orders.size();
+    // Average the price of every entry, 0 if the vector is empty.
+    return reduce<Mean>(orders, EntryPrice{});
 }
 
 // Calculate the average price of orders in a given vector of double values.
 double Calculator::calculateAveragePriceOfOrders(const std::vector<double> &orders) {
-    // Return 0 if the vector is empty.
-    if (orders.empty())
-        return 0;
-
-    double acc = 0;
-    // Iterate through each double value in the vector and add it to the accumulator.
-    for (const double e: orders) {
-        acc += e;
-    }
-
-    // Return the average by dividing the total price by the number of orders.
-    return acc / (double) orders.size();
+    // The doubles are contiguous, so this runs the pairwise summation kernel; 0 if the vector is empty.
+    return reduce<Mean>(orders);
 }
 
 // Find the minimum price in a vector of OrderBookEntry objects.
 double Calculator::getLowPrice(std::vector<OrderBookEntry> &orders) {
-    // Set the minimum value to the first price in the vector.
-    double min = orders[0].price;
-    // Iterate through each OrderBookEntry in the vector.
-    for (const OrderBookEntry &e: orders) {
-        // If the current OrderBookEntry's price is less than the current minimum value, update the minimum value.
-        if (e.price < min) min = e.price;
-    }
-    return min;
+    return reduce<Min>(orders, EntryPrice{});
 }
 
 // Retrieve the maximum price from a vector of OrderBookEntry objects.
 double Calculator::getHighPrice(std::vector<OrderBookEntry> &orders) {
-    // Set the maximum value to the first price in the vector.
-    double max = orders[0].price;
-    // Iterate through each OrderBookEntry in the vector.
-    for (const OrderBookEntry &e: orders) {
-        // If the current OrderBookEntry's price is greater than the current maximum value, update the maximum value.
-        if (e.price > max) max = e.price;
-    }
-    return max;
+    return reduce<Max>(orders, EntryPrice{});
+}
+
+// Find the minimum price in a contiguous column of prices.
+double Calculator::getLowPrice(ColumnSpan<double> prices) {
+    // The vectorised kernel for this CPU, 0 if there are no prices.
+    return reduce<Min>(prices);
+}
+
+// Retrieve the maximum price from a contiguous column of prices.
+double Calculator::getHighPrice(ColumnSpan<double> prices) {
+    // The vectorised kernel for this CPU, 0 if there are no prices.
+    return reduce<Max>(prices);
 }
 
 // Calculate the average minimum or maximum price over all time steps, based on a given vector of orders
 // and a string indicating whether to calculate the minimum or maximum.
 double Calculator::calculateAverageMinMaxOverTimesteps(const std::vector<std::vector<OrderBookEntry>> &ordersPerTime,
                                                        const std::string &minOrMax) {
-    std::vector<double> minOrMaxPrices;
+    // Decide between minimum and maximum once, not for every time step.
+    if (minOrMax == "min")
+        return calculateAverageOverTimesteps<Min>(ordersPerTime);
+    if (minOrMax == "max")
+        return calculateAverageOverTimesteps<Max>(ordersPerTime);
+    return 0;
+}
 
-    // Iterate through each vector of OrderBookEntry objects in the given vector.
-    for (std::vector<OrderBookEntry> orders: ordersPerTime) {
-        // If the minOrMax parameter is "min", calculate the minimum price for the current vector of orders.
-        // If the minOrMax parameter is "max", calculate the maximum price for the current vector of orders.
-        // Add the calculated price to the minOrMaxPrices vector.
-        if (minOrMax == "min")
-            minOrMaxPrices.push_back(getLowPrice(orders));
-        else if (minOrMax == "max")
-            minOrMaxPrices.push_back(getHighPrice(orders));
-    }
+// Retrieve the maximum price of a bucket summary.
+double Calculator::getHighPrice(const PriceAggregate &aggregate) {
+    return reduce<Max>(aggregate);
+}
 
-    // Return the average of the prices in the minOrMaxPrices vector.
-    return calculateAveragePriceOfOrders(minOrMaxPrices);
+// Find the minimum price of a bucket summary.
+double Calculator::getLowPrice(const PriceAggregate &aggregate) {
+    return reduce<Min>(aggregate);
 }
 
-// Compare two timestamp strings. Returns true if t1 is less than t2.
-// Intended to be used for sorting and similar purposes.
-bool Calculator::compareTimestamps(const std::string &t1, const std::string &t2) {
-    return t1 < t2;
+// Calculate the average price over a range of time steps from the prefix sums of the table, in constant time.
+double Calculator::calculateAveragePriceOverTimesteps(const AggregateTable &table, std::uint32_t productId,
+                                                      OrderBookType type, std::uint32_t firstTimestep,
+                                                      std::uint32_t lastTimestep) {
+    return calculateAverageOverTimesteps<Mean>(table, productId, type, firstTimestep, lastTimestep);
 }
 
+// Calculate the average of the per time step minimum or maximum over a range of time steps, in constant time.
+double Calculator::calculateAverageMinMaxOverTimesteps(const AggregateTable &table, std::uint32_t productId,
+                                                       OrderBookType type, std::uint32_t firstTimestep,
+                                                       std::uint32_t lastTimestep, const std::string &minOrMax) {
+    // Decide between minimum and maximum once.
+    if (minOrMax == "min")
+        return calculateAverageOverTimesteps<Min>(table, productId, type, firstTimestep, lastTimestep);
+    if (minOrMax == "max")
+        return calculateAverageOverTimesteps<Max>(table, productId, type, firstTimestep, lastTimestep);
+    return 0;
+}
 
+// Compare two timestamp strings by the time they stand for. Returns true if t1 is earlier than t2.
+// Intended to be used for sorting and similar purposes; text that isn't a valid timestamp is compared as text.
+bool Calculator::compareTimestamps(const std::string &t1, const std::string &t2) {
+    std::int64_t micros1, micros2;
+    if (Timestamp::parse(t1, micros1) && Timestamp::parse(t2, micros2))
+        return micros1 < micros2;
+    return t1 < t2;
+}
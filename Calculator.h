@@ -9,8 +9,13 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <stdexcept>
+#include <type_traits>
 #include "OrderBookEntry.h"
 #include "CSVReader.h"
+#include "ColumnSpan.h"
+#include "AggregateTable.h"
+#include "ReducePolicies.h"
 
 class Calculator {
 
@@ -28,6 +33,30 @@ public:
     // Find minimum price in a vector of OrderBookEntry objects
     static double getLowPrice(std::vector<OrderBookEntry> &orders);
 
+    // Retrieve maximum price from a contiguous column of prices (0 if there are none)
+    static double getHighPrice(ColumnSpan<double> prices);
+
+    // Find minimum price in a contiguous column of prices (0 if there are none)
+    static double getLowPrice(ColumnSpan<double> prices);
+
+    // Retrieve maximum price of a bucket summary (0 if the bucket is empty)
+    static double getHighPrice(const PriceAggregate &aggregate);
+
+    // Find minimum price of a bucket summary (0 if the bucket is empty)
+    static double getLowPrice(const PriceAggregate &aggregate);
+
+    // Calculate the average price of all orders of one product and order type over the time steps
+    // [firstTimestep, lastTimestep], using the per time step summaries of an AggregateTable.
+    static double calculateAveragePriceOverTimesteps(const AggregateTable &table, std::uint32_t productId,
+                                                     OrderBookType type, std::uint32_t firstTimestep,
+                                                     std::uint32_t lastTimestep);
+
+    // Calculate the average of the per time step minimum or maximum price of one product and order type over the
+    // time steps [firstTimestep, lastTimestep], using an AggregateTable. Time steps without orders are skipped.
+    static double calculateAverageMinMaxOverTimesteps(const AggregateTable &table, std::uint32_t productId,
+                                                      OrderBookType type, std::uint32_t firstTimestep,
+                                                      std::uint32_t lastTimestep, const std::string &minOrMax);
+
     // Calculate average minimum or maximum price over all time steps, based on a given vector of orders
     // and a string indicating whether to calculate the minimum or maximum.
     static double calculateAverageMinMaxOverTimesteps(const std::vector<std::vector<OrderBookEntry>> &ordersPerTime, 
@@ -35,6 +64,77 @@ public:
 
     // Compare two timestamp strings. Intended to be used for sorting and similar purposes.
     static bool compareTimestamps(const std::string &t1, const std::string &t2);
+
+    // Reduce a range of values with the given policy (Min, Max, Sum or Mean) after mapping every element
+    // through the projection (0 if the range is empty). Ranges of contiguous doubles with no projection,
+    // such as a vector<double> or a ColumnSpan<double>, go straight to the vectorised kernels.
+    template<typename Policy, typename Range, typename Projection = Identity>
+    static double reduce(const Range &values, Projection projection = Projection{}) {
+        if constexpr (std::is_same_v<Projection, Identity> && std::is_convertible_v<const Range &, ColumnSpan<double>>) {
+            ColumnSpan<double> prices = values;
+            return prices.empty() ? 0 : Policy::column(prices);
+        } else {
+            double acc = Policy::initial();
+            std::size_t count = 0;
+            for (const auto &value: values) {
+                acc = Policy::combine(acc, projection(value));
+                ++count;
+            }
+            return count == 0 ? 0 : Policy::finish(acc, count);
+        }
+    }
+
+    // Reduce the summary of one bucket with the given policy (0 if the bucket is empty).
+    template<typename Policy>
+    static double reduce(const PriceAggregate &aggregate) {
+        return aggregate.empty() ? 0 : Policy::bucket(aggregate);
+    }
+
+    // Average of the per time step minimum, maximum or total of one product and order type over the time steps
+    // [firstTimestep, lastTimestep], or with Mean the average price over all of their orders, in constant time.
+    // Time steps without orders are skipped.
+    template<typename Policy>
+    static double calculateAverageOverTimesteps(const AggregateTable &table, std::uint32_t productId,
+                                                OrderBookType type, std::uint32_t firstTimestep,
+                                                std::uint32_t lastTimestep) {
+        return Policy::window(table.window(productId, type, firstTimestep, lastTimestep));
+    }
+
+    // Average of the per time step reduction of a list of orders per time step. Time steps without orders
+    // are skipped.
+    template<typename Policy>
+    static double calculateAverageOverTimesteps(const std::vector<std::vector<OrderBookEntry>> &ordersPerTime) {
+        std::vector<double> perStep;
+        perStep.reserve(ordersPerTime.size());
+        for (const std::vector<OrderBookEntry> &orders: ordersPerTime) {
+            if (!orders.empty())
+                perStep.push_back(reduce<Policy>(orders, EntryPrice{}));
+        }
+        return reduce<Mean>(perStep);
+    }
+
+    // Turn a "min" or "max" argument into its policy once, and call the function with it, so that the work
+    // behind the function is specialised for that policy. Throws std::invalid_argument for anything else.
+    template<typename Function>
+    static auto withMinMaxPolicy(const std::string &minOrMax, Function function) {
+        if (minOrMax == "min")
+            return function(Min{});
+        if (minOrMax == "max")
+            return function(Max{});
+        throw std::invalid_argument("Invalid argument for <min/max>");
+    }
+
+    // Turn a "vwap", "volume" or "notional" argument into its policy once, in the same way.
+    template<typename Function>
+    static auto withVolumePolicy(const std::string &measure, Function function) {
+        if (measure == "vwap")
+            return function(Vwap{});
+        if (measure == "volume")
+            return function(Volume{});
+        if (measure == "notional")
+            return function(Notional{});
+        throw std::invalid_argument("Invalid argument for <vwap/volume/notional>");
+    }
 };
 
 
@@ -0,0 +1,36 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_COLUMNSPAN_H
+#define ADVISORBOT_COLUMNSPAN_H
+
+// include necessary standard C++ libraries
+#include <vector>
+#include <cstddef>
+
+// A non-owning view of a contiguous run of values, e.g. a slice of one OrderStore column.
+// It stays valid as long as the underlying storage is alive and not modified.
+template<typename T>
+class ColumnSpan {
+    public:
+        ColumnSpan() = default;
+
+        ColumnSpan(const T *_first, std::size_t _count) : first(_first), count(_count) {
+        }
+
+        // View the whole contents of a vector.
+        ColumnSpan(const std::vector<T> &values) : first(values.data()), count(values.size()) {
+        }
+
+        const T *begin() const { return first; }
+        const T *end() const { return first + count; }
+        const T *data() const { return first; }
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        const T &operator[](std::size_t i) const { return first[i]; }
+
+    private:
+        const T *first = nullptr;
+        std::size_t count = 0;
+};
+
+#endif //ADVISORBOT_COLUMNSPAN_H
@@ -0,0 +1,191 @@
+// include necessary C++ libraries and header files
+#include <chrono>
+#include <sstream>
+#include <iostream>
+#include "Dataset.h"
+
+Dataset::Dataset(const LoadOptions &_options, std::size_t _memoryBudget)
+        : options(_options), memoryBudget(_memoryBudget) {
+}
+
+Dataset::~Dataset() {
+    if (current) join(*current);
+    if (pending) join(*pending);
+}
+
+// The first file is loaded straight into place; later ones load next to the current book
+bool Dataset::load(const std::string &filename) {
+    promote();
+    if (current && current->progress.stage != LoadStage::ready && current->progress.stage != LoadStage::failed) {
+        std::cout << "Dataset: still loading " << current->filename << ", try again once it is loaded" << std::endl;
+        return false;
+    }
+    if (pending) {
+        std::cout << "Dataset: still loading " << pending->filename << ", try again once it is loaded" << std::endl;
+        return false;
+    }
+
+    // a file that couldn't be loaded has nothing to keep answering from
+    if (!current || current->progress.stage == LoadStage::failed) {
+        if (current) join(*current);
+        current = start(filename);
+        ++generations;
+    } else {
+        pending = start(filename);
+    }
+    return true;
+}
+
+// Wait for the first load if needed, printing its progress while waiting
+QuerySource Dataset::get(LoadStage stage) {
+    promote();
+    if (!current)
+        return {};
+
+    auto reached = [&] {
+        LoadStage now = current->progress.stage;
+        return now == LoadStage::failed || now >= stage;
+    };
+    auto lastReport = std::chrono::steady_clock::now();
+    while (!reached()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (std::chrono::steady_clock::now() - lastReport >= std::chrono::seconds(1)) {
+            std::cout << "Dataset: loading " << current->filename << ", " << describe(*current) << std::endl;
+            lastReport = std::chrono::steady_clock::now();
+        }
+    }
+
+    if (current->progress.stage == LoadStage::failed) {
+        std::cout << "Dataset: couldn't load " << current->filename << ": " << current->error << std::endl;
+        return {};
+    }
+    return {current->book, current->catalog, current->blocks};
+}
+
+std::size_t Dataset::follow() {
+    promote();
+    if (!current || !current->book || current->progress.stage != LoadStage::ready)
+        return 0;
+    return current->book->follow();
+}
+
+std::size_t Dataset::generation() const {
+    return generations;
+}
+
+const std::string &Dataset::filename() const {
+    static const std::string none;
+    return current ? current->filename : none;
+}
+
+std::string Dataset::status() const {
+    std::string text = current ? current->filename + ": " + describe(*current) : "no data file";
+    if (pending)
+        text += ", " + pending->filename + ": " + describe(*pending);
+    return text;
+}
+
+// Read the file into a new book on a thread of its own
+std::unique_ptr<Dataset::Load> Dataset::start(const std::string &filename) const {
+    auto load = std::make_unique<Load>();
+    load->filename = filename;
+
+    // a catalog only lists its files here, so there is nothing to wait for
+    if (DayCatalog::isDirectory(filename)) {
+        try {
+            load->catalog = std::make_shared<DayCatalog>(filename, options, memoryBudget);
+            load->progress.stage = LoadStage::ready;
+        } catch (const std::exception &e) {
+            load->error = e.what();
+            load->progress.stage = LoadStage::failed;
+        }
+        return load;
+    }
+
+    LoadOptions loadOptions = options;
+    loadOptions.progress = &load->progress;
+    // the Load is on the heap, so it stays where the thread expects it when the unique_ptr is moved
+    Load *target = load.get();
+
+    // the block file is written (or found) and opened on the thread; there are no dictionaries to wait for
+    if (options.blocks) {
+        std::size_t pageBudget = memoryBudget;
+        load->thread = std::thread([target, loadOptions, pageBudget] {
+            try {
+                target->blocks = BlockStore::open(target->filename, pageBudget, loadOptions.progress);
+                target->progress.stage = LoadStage::ready;
+            } catch (const std::exception &e) {
+                target->error = e.what();
+                target->progress.stage = LoadStage::failed;
+            }
+        });
+        return load;
+    }
+
+    load->book = std::make_shared<OrderBook>();
+    load->thread = std::thread([target, loadOptions] {
+        try {
+            target->book->load(target->filename, loadOptions);
+        } catch (const std::exception &e) {
+            target->error = e.what();
+            target->progress.stage = LoadStage::failed;
+        }
+    });
+    return load;
+}
+
+void Dataset::promote() {
+    if (!pending)
+        return;
+    LoadStage stage = pending->progress.stage;
+    if (stage == LoadStage::ready) {
+        join(*current);
+        join(*pending);
+        current = std::move(pending);
+        ++generations;
+        std::cout << "Dataset: now answering from " << current->filename << std::endl;
+    } else if (stage == LoadStage::failed) {
+        join(*pending);
+        std::cout << "Dataset: couldn't load " << pending->filename << ": " << pending->error
+                  << ", still answering from " << current->filename << std::endl;
+        pending.reset();
+    }
+}
+
+std::string Dataset::describe(const Load &load) {
+    // an open catalog describes its days instead
+    if (load.catalog)
+        return load.catalog->status();
+
+    // so does an open block store
+    LoadStage stage = load.progress.stage;
+    if (stage == LoadStage::ready && load.blocks)
+        return load.blocks->status();
+
+    std::ostringstream text;
+    switch (stage) {
+        case LoadStage::reading: {
+            // the size is known once the file is open
+            std::size_t total = load.progress.bytesTotal;
+            text << "reading";
+            if (total > 0)
+                text << " " << load.progress.bytesRead * 100 / total << "%";
+            break;
+        }
+        case LoadStage::dictionaries:
+            text << "indexing";
+            break;
+        case LoadStage::ready:
+            text << "ready";
+            break;
+        case LoadStage::failed:
+            text << "failed";
+            break;
+    }
+    return text.str();
+}
+
+void Dataset::join(Load &load) {
+    if (load.thread.joinable())
+        load.thread.join();
+}
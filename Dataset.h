@@ -0,0 +1,93 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_DATASET_H
+#define ADVISORBOT_DATASET_H
+
+// include necessary standard C++ libraries and header files
+#include <string>
+#include <memory>
+#include <thread>
+#include <cstddef>
+#include "OrderBook.h"
+#include "DayCatalog.h"
+#include "BlockStore.h"
+#include "QueryEngine.h"
+
+// The order book the bot answers from, loaded on a background thread so that the bot can take commands while a
+// data file is still being read. A second file can be loaded while the first one stays queryable; the new book
+// takes its place as soon as it is ready. A directory is opened as a DayCatalog of daily files instead, which loads
+// its days when they are first needed. With LoadOptions::blocks a file is opened as a BlockStore instead, written
+// on the loading thread the first time, with the memory budget as its page budget. Only one thread may use a
+// Dataset; the loads run on their own threads.
+class Dataset {
+    public:
+        // The memory budget (in bytes) applies to the days of a catalog that are loaded at the same time, or to the
+        // blocks of a block store that are mapped at the same time.
+        Dataset(const LoadOptions &_options, std::size_t _memoryBudget);
+
+        // Wait for the loads still running; they can't be interrupted.
+        ~Dataset();
+
+        // A dataset owns its loading threads, so it can be neither copied nor assigned.
+        Dataset(const Dataset &) = delete;
+        Dataset &operator=(const Dataset &) = delete;
+
+        // Start loading a data file in the background, or open a directory of daily files. Returns false (and
+        // prints why) if another file is still loading.
+        bool load(const std::string &filename);
+
+        // Return the book or catalog to answer from once it has reached the stage, waiting for the first load if
+        // it hasn't and printing its progress about once a second while waiting. Returns an empty source if no
+        // file could be loaded.
+        QuerySource get(LoadStage stage);
+
+        // In follow mode, ingest the lines appended to the data file of the book being answered from, if it is
+        // ready. Returns the number of new rows.
+        std::size_t follow();
+
+        // Return the number of times the book being answered from was replaced by another one, so that callers
+        // can tell when their time steps refer to a different book.
+        std::size_t generation() const;
+
+        // Return the data file of the book being answered from, or of the first load while it is still running.
+        const std::string &filename() const;
+
+        // Describe the loads, e.g. "20200601.csv: ready, 20200602.csv: reading 45%".
+        std::string status() const;
+
+    private:
+        // One data file being loaded, or loaded, into its own book or block store, or one directory opened as a
+        // catalog.
+        struct Load {
+            std::string filename;
+            std::shared_ptr<OrderBook> book;
+            std::shared_ptr<DayCatalog> catalog;
+            // set by the loading thread before the stage becomes ready
+            std::shared_ptr<BlockStore> blocks;
+            LoadProgress progress;
+            // why the load failed, written before the stage becomes failed
+            std::string error;
+            std::thread thread;
+        };
+
+        // Start a load of the file on its own thread.
+        std::unique_ptr<Load> start(const std::string &filename) const;
+
+        // Replace the current book with the pending one once it is ready, or drop the pending one if it failed.
+        void promote();
+
+        // Describe how far a load has got.
+        static std::string describe(const Load &load);
+
+        // Wait for a load's thread to finish.
+        static void join(Load &load);
+
+        LoadOptions options;
+        std::size_t memoryBudget;
+        // the book being answered from, and the one being loaded to take its place
+        std::unique_ptr<Load> current;
+        std::unique_ptr<Load> pending;
+        std::size_t generations = 0;
+};
+
+#endif //ADVISORBOT_DATASET_H
@@ -0,0 +1,186 @@
+// include necessary C++ libraries and header files
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include "DayCatalog.h"
+#include "Timestamp.h"
+#include "Metrics.h"
+
+// Find the files named after a date, in date order
+DayCatalog::DayCatalog(const std::string &_directory, const LoadOptions &_options, std::size_t _memoryBudget)
+        : directory(_directory), options(_options), memoryBudget(_memoryBudget) {
+    // a day file can't be followed as it grows; every day is read once, from its snapshot if there is one
+    options.follow = false;
+    options.progress = nullptr;
+
+    std::error_code error;
+    for (const auto &entry: std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        // YYYYMMDD.csv
+        if (name.size() != 12 || name.compare(8, 4, ".csv") != 0 ||
+            !std::all_of(name.begin(), name.begin() + 8, [](char c) { return c >= '0' && c <= '9'; }))
+            continue;
+        std::string date = name.substr(0, 4) + "/" + name.substr(4, 2) + "/" + name.substr(6, 2) + " 00:00:00";
+        Day day;
+        if (!Timestamp::parse(date, day.start))
+            continue;
+        day.filename = entry.path().string();
+        days.push_back(std::move(day));
+    }
+    if (days.empty()) {
+        std::cout << "DayCatalog: no daily data files (YYYYMMDD.csv) in " << directory << std::endl;
+        throw std::runtime_error("No daily data files!");
+    }
+    std::sort(days.begin(), days.end(), [](const Day &a, const Day &b) { return a.start < b.start; });
+    std::cout << "DayCatalog found " << days.size() << " days in " << directory << std::endl;
+}
+
+bool DayCatalog::isDirectory(const std::string &path) {
+    std::error_code error;
+    return std::filesystem::is_directory(path, error);
+}
+
+std::size_t DayCatalog::size() const {
+    return days.size();
+}
+
+const std::string &DayCatalog::filename(std::size_t day) const {
+    return days.at(day).filename;
+}
+
+// The days are sorted by their start, so the day is found by binary search
+std::size_t DayCatalog::dayOf(std::int64_t micros) const {
+    auto after = std::upper_bound(days.begin(), days.end(), micros,
+                                  [](std::int64_t t, const Day &day) { return t < day.start; });
+    return after == days.begin() ? 0 : static_cast<std::size_t>(after - days.begin() - 1);
+}
+
+std::int64_t DayCatalog::dayStart(std::size_t day) const {
+    return days.at(day).start;
+}
+
+// A loaded day is handed out at once; otherwise the first thread to ask loads it without holding the lock, and the
+// others wait for its load
+std::shared_ptr<const OrderBook> DayCatalog::day(std::size_t day) {
+    std::unique_lock<std::mutex> lock(mutex);
+    Day &d = days.at(day);
+    if (d.book) {
+        // move it to the front of the list
+        recent.splice(recent.begin(), recent, d.recentPosition);
+        std::shared_ptr<const OrderBook> book = d.book;
+        evict(day);
+        Metrics::setMemory("catalog", memoryUsed);
+        return book;
+    }
+    if (d.loading.valid()) {
+        std::shared_future<std::shared_ptr<const OrderBook>> loading = d.loading;
+        lock.unlock();
+        return loading.get();
+    }
+    std::promise<std::shared_ptr<const OrderBook>> promise;
+    d.loading = promise.get_future().share();
+    lock.unlock();
+
+    std::shared_ptr<const OrderBook> book;
+    DaySummary daySummary;
+    try {
+        book = load(d, daySummary);
+    } catch (...) {
+        lock.lock();
+        d.loading = {};
+        lock.unlock();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    lock.lock();
+    if (!d.summarised) {
+        for (const auto &product: daySummary.totals) {
+            auto first = firstDays.emplace(product.first, day).first;
+            first->second = std::min(first->second, day);
+        }
+        d.summary = std::move(daySummary);
+        d.summarised = true;
+    }
+    d.book = book;
+    d.loading = {};
+    recent.push_front(day);
+    d.recentPosition = recent.begin();
+    evict(day);
+    Metrics::setMemory("catalog", memoryUsed);
+    lock.unlock();
+    promise.set_value(book);
+    return book;
+}
+
+std::size_t DayCatalog::timesteps(std::size_t day) {
+    return summary(day).timesteps;
+}
+
+bool DayCatalog::hadProductBefore(std::size_t day, const std::string &product) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = firstDays.find(product);
+    return it != firstDays.end() && it->second < day;
+}
+
+WindowAggregate DayCatalog::totals(std::size_t day, const std::string &product, OrderBookType type) {
+    const DaySummary &daySummary = summary(day);
+    auto it = daySummary.totals.find(product);
+    return it == daySummary.totals.end() ? WindowAggregate{} : it->second[static_cast<std::size_t>(type)];
+}
+
+std::string DayCatalog::status() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ostringstream text;
+    text << days.size() << " days in " << directory << ", " << recent.size() << " loaded ("
+         << memoryUsed / (1024 * 1024) << " MB of " << memoryBudget / (1024 * 1024) << " MB)";
+    return text.str();
+}
+
+// Read the day and remember how many time steps it has and its totals, which is all a prediction needs from a
+// whole day
+std::shared_ptr<const OrderBook> DayCatalog::load(const Day &d, DaySummary &daySummary) const {
+    std::shared_ptr<OrderBook> book = std::make_shared<OrderBook>(d.filename, options);
+    const std::vector<std::string> &products = book->getProducts();
+    daySummary.timesteps = book->getTimestamps().size();
+    for (std::uint32_t p = 0; p < products.size() && daySummary.timesteps > 0; ++p) {
+        auto &totals = daySummary.totals[products[p]];
+        for (std::size_t t = 0; t < AggregateTable::orderTypeCount; ++t) {
+            totals[t] = book->getAggregates().window(p, static_cast<OrderBookType>(t), 0,
+                                                     static_cast<std::uint32_t>(daySummary.timesteps - 1));
+        }
+    }
+    return book;
+}
+
+// A day that has never been loaded is loaded for its summary; the summary is written once, under the lock, before
+// day() returns, so it can be read without the lock afterwards
+const DayCatalog::DaySummary &DayCatalog::summary(std::size_t day) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (days.at(day).summarised)
+            return days[day].summary;
+    }
+    this->day(day);
+    return days[day].summary;
+}
+
+// Drop days from the back of the list, which are the ones used longest ago
+void DayCatalog::evict(std::size_t keep) {
+    memoryUsed = 0;
+    for (std::size_t loaded: recent) memoryUsed += days[loaded].book->memoryUsage();
+    while (memoryUsed > memoryBudget && recent.size() > 1) {
+        std::size_t oldest = recent.back();
+        if (oldest == keep)
+            break;
+        recent.pop_back();
+        Day &d = days[oldest];
+        // measured again, so it may have changed since the sum above
+        std::size_t bytes = d.book->memoryUsage();
+        memoryUsed -= bytes < memoryUsed ? bytes : memoryUsed;
+        d.book.reset();
+        std::cout << "DayCatalog: dropped " << d.filename << " to stay within the memory budget" << std::endl;
+    }
+}
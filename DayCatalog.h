@@ -0,0 +1,111 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_DAYCATALOG_H
+#define ADVISORBOT_DAYCATALOG_H
+
+// include necessary standard C++ libraries and header files
+#include <list>
+#include <array>
+#include <mutex>
+#include <future>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include "OrderBook.h"
+
+// The daily data files of one directory (named YYYYMMDD.csv, one per UTC day), each loaded into an order book of
+// its own the first time it is needed. Loaded days are kept in least recently used order, and the oldest ones are
+// dropped once the books take up more than the memory budget; a day still held by a caller stays in memory until
+// it is released. A few totals of every day are remembered after it has been loaded once, so that going back over
+// whole days doesn't load them again. Safe to use from several threads; a day is loaded by the thread that first
+// asks for it, without holding up the threads that want other days, and the threads that want the same day wait
+// for that load.
+class DayCatalog {
+    public:
+        // Find the daily files in a directory. Prints a message and throws std::runtime_error if there are none.
+        DayCatalog(const std::string &directory, const LoadOptions &_options, std::size_t _memoryBudget);
+
+        // Determine whether a path names a directory, i.e. a catalog rather than a single data file.
+        static bool isDirectory(const std::string &path);
+
+        // Return the number of days.
+        std::size_t size() const;
+
+        // Return the data file of a day.
+        const std::string &filename(std::size_t day) const;
+
+        // Return the day a time falls on: the last day starting at or before it, or the first day.
+        std::size_t dayOf(std::int64_t micros) const;
+
+        // Return the start (midnight UTC) of a day, in microseconds since the epoch.
+        std::int64_t dayStart(std::size_t day) const;
+
+        // Return the order book of a day, loading it if it isn't loaded. Throws std::runtime_error if the file
+        // can't be read.
+        std::shared_ptr<const OrderBook> day(std::size_t day);
+
+        // Return the number of time steps of a day. This and the next load the day only if it has never been
+        // loaded before.
+        std::size_t timesteps(std::size_t day);
+
+        // Determine whether any day before the given one that has been loaded had orders of a product. Never loads
+        // a day: the products of every day are collected as it is loaded, and a cursor passes through every day
+        // before its own.
+        bool hadProductBefore(std::size_t day, const std::string &product) const;
+
+        // Return the totals of a product and order type over all time steps of a day.
+        WindowAggregate totals(std::size_t day, const std::string &product, OrderBookType type);
+
+        // Describe the catalog, e.g. "30 days in data/, 3 loaded (512 MB of 1024 MB)".
+        std::string status() const;
+
+    private:
+        // What is remembered of a day after it has been loaded once, even when its order book has been dropped.
+        struct DaySummary {
+            std::size_t timesteps = 0;
+            // by product name, then by order type
+            std::unordered_map<std::string, std::array<WindowAggregate, AggregateTable::orderTypeCount>> totals;
+        };
+
+        struct Day {
+            std::string filename;
+            std::int64_t start = 0;
+            // null while not loaded
+            std::shared_ptr<const OrderBook> book;
+            // valid while a thread is loading the day
+            std::shared_future<std::shared_ptr<const OrderBook>> loading;
+            // set once the day has been loaded
+            bool summarised = false;
+            DaySummary summary;
+            // where the day is in 'recent' while loaded
+            std::list<std::size_t>::iterator recentPosition;
+        };
+
+        // Read a day's file into an order book and summarise it. Called without the mutex held.
+        std::shared_ptr<const OrderBook> load(const Day &d, DaySummary &daySummary) const;
+
+        // Return the summary of a day, loading the day if it has never been loaded. Called without the mutex
+        // held; a summary doesn't change once it has been made.
+        const DaySummary &summary(std::size_t day);
+
+        // Drop the least recently used days, except the given one, until the loaded books fit the budget. The
+        // books are measured again each time, as their cached ladders grow with use. The mutex must be held.
+        void evict(std::size_t keep);
+
+        std::string directory;
+        LoadOptions options;
+        std::size_t memoryBudget;
+
+        mutable std::mutex mutex;
+        std::vector<Day> days;
+        // loaded days, most recently used first
+        std::list<std::size_t> recent;
+        std::size_t memoryUsed = 0;
+        // the earliest loaded day with orders of each product
+        std::unordered_map<std::string, std::size_t> firstDays;
+};
+
+#endif //ADVISORBOT_DAYCATALOG_H
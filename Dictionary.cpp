@@ -0,0 +1,131 @@
+// include necessary C++ libraries and header files
+#include <numeric>
+#include <algorithm>
+#include "Dictionary.h"
+
+Dictionary::Dictionary(const Dictionary &other) : strings(other.strings) {
+    reindex();
+}
+
+Dictionary &Dictionary::operator=(const Dictionary &other) {
+    if (this != &other) {
+        strings = other.strings;
+        reindex();
+    }
+    return *this;
+}
+
+// Return the id of a value, adding it to the dictionary if it hasn't been seen before
+std::uint32_t Dictionary::intern(std::string_view value) {
+    // fast path: the same value as the previous call
+    if (lastId != npos && strings[lastId] == value)
+        return lastId;
+
+    // look the value up without allocating a new string for the key
+    auto it = ids.find(value);
+    if (it != ids.end()) {
+        lastId = it->second;
+        return lastId;
+    }
+
+    // a new value gets the next free id; if the strings had to move, every view is out of date
+    std::uint32_t id = static_cast<std::uint32_t>(strings.size());
+    const std::string *before = strings.data();
+    strings.emplace_back(value);
+    if (strings.data() != before)
+        reindex();
+    else
+        ids.emplace(strings.back(), id);
+    lastId = id;
+    return lastId;
+}
+
+// Return the id of a value, or npos if the value is unknown
+std::uint32_t Dictionary::find(std::string_view value) const {
+    auto it = ids.find(value);
+    return it == ids.end() ? npos : it->second;
+}
+
+// Return the text of the value with the given id
+const std::string &Dictionary::at(std::uint32_t id) const {
+    return strings[id];
+}
+
+// Return all values, indexed by id
+const std::vector<std::string> &Dictionary::values() const {
+    return strings;
+}
+
+// Return the number of distinct values
+std::size_t Dictionary::size() const {
+    return strings.size();
+}
+
+// Sort the values and report where every old id moved to
+std::vector<std::uint32_t> Dictionary::sort() {
+    // order the old ids by their text
+    std::vector<std::uint32_t> order(strings.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](std::uint32_t a, std::uint32_t b) {
+        return strings[a] < strings[b];
+    });
+    return reorder(order);
+}
+
+// Sort the values by their keys and report where every old id moved to
+std::vector<std::uint32_t> Dictionary::sortBy(const std::vector<std::int64_t> &keys) {
+    std::vector<std::uint32_t> order(strings.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this, &keys](std::uint32_t a, std::uint32_t b) {
+        return keys[a] != keys[b] ? keys[a] < keys[b] : strings[a] < strings[b];
+    });
+    return reorder(order);
+}
+
+// Move the strings into their new positions and record the old -> new mapping
+std::vector<std::uint32_t> Dictionary::reorder(const std::vector<std::uint32_t> &order) {
+    std::vector<std::uint32_t> remap(strings.size());
+    std::vector<std::string> sorted;
+    sorted.reserve(strings.size());
+    for (std::uint32_t newId = 0; newId < order.size(); ++newId) {
+        remap[order[newId]] = newId;
+        sorted.push_back(std::move(strings[order[newId]]));
+    }
+    strings = std::move(sorted);
+    reindex();
+    return remap;
+}
+
+// Forget the newest value
+void Dictionary::removeLast() {
+    if (strings.empty())
+        return;
+    ids.erase(std::string_view{strings.back()});
+    strings.pop_back();
+    lastId = npos;
+}
+
+// Replace the contents of the dictionary
+void Dictionary::assign(std::vector<std::string> newValues) {
+    strings = std::move(newValues);
+    reindex();
+}
+
+// Rebuild the lookup table from 'strings'
+void Dictionary::reindex() {
+    ids.clear();
+    ids.reserve(strings.size());
+    for (std::uint32_t id = 0; id < strings.size(); ++id) {
+        ids.emplace(strings[id], id);
+    }
+    lastId = npos;
+}
+
+// Every value is stored once in 'strings' and viewed by a key of 'ids', plus the hash table's nodes and buckets
+std::size_t Dictionary::memoryUsage() const {
+    std::size_t bytes = strings.capacity() * sizeof(std::string) + ids.bucket_count() * sizeof(void *);
+    for (const std::string &s: strings) {
+        bytes += s.capacity() + sizeof(std::string_view) + sizeof(std::uint32_t) + 2 * sizeof(void *);
+    }
+    return bytes;
+}
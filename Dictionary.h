@@ -0,0 +1,77 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_DICTIONARY_H
+#define ADVISORBOT_DICTIONARY_H
+
+// include necessary standard C++ libraries
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+// Interns strings so that every distinct value is stored once and referred to by a compact integer id.
+// The OrderBook keeps one dictionary for products and one for timestamps.
+class Dictionary {
+    public:
+        // Id returned by find() when a value is not in the dictionary.
+        static const std::uint32_t npos = UINT32_MAX;
+
+        Dictionary() = default;
+
+        // A copy looks its values up in its own strings, not in those of the original; a move takes the strings
+        // along without moving their characters.
+        Dictionary(const Dictionary &other);
+        Dictionary &operator=(const Dictionary &other);
+        Dictionary(Dictionary &&) = default;
+        Dictionary &operator=(Dictionary &&) = default;
+
+        // Return the id of a value, adding it to the dictionary first if it is new.
+        std::uint32_t intern(std::string_view value);
+
+        // Return the id of a value, or npos if it is not in the dictionary.
+        std::uint32_t find(std::string_view value) const;
+
+        // Return the text of the value with the given id.
+        const std::string &at(std::uint32_t id) const;
+
+        // Return all values, indexed by id.
+        const std::vector<std::string> &values() const;
+
+        // Return the number of distinct values.
+        std::size_t size() const;
+
+        // Sort the values in ascending order so that comparing ids is the same as comparing the text.
+        // Returns a table that maps every old id to its new id.
+        std::vector<std::uint32_t> sort();
+
+        // Sort the values by a numeric key given for every id (e.g. the parsed time of a timestamp), breaking
+        // ties by text. Returns a table that maps every old id to its new id.
+        std::vector<std::uint32_t> sortBy(const std::vector<std::int64_t> &keys);
+
+        // Remove the value that was added last, e.g. because it turned out to be malformed.
+        void removeLast();
+
+        // Replace the contents of the dictionary with the given values, whose ids are their positions.
+        void assign(std::vector<std::string> newValues);
+
+        // Return roughly how many bytes the values and the lookup table take up.
+        std::size_t memoryUsage() const;
+
+    private:
+        // Rebuild the lookup table from 'strings', e.g. after they moved.
+        void reindex();
+
+        // Move the values into the given order of old ids and return the old -> new mapping.
+        std::vector<std::uint32_t> reorder(const std::vector<std::uint32_t> &order);
+
+        std::vector<std::string> strings;
+        // Keyed by views of 'strings', so that looking a value up never allocates. A short string keeps its
+        // characters inside itself, so the views are rebuilt whenever 'strings' grows into new memory.
+        std::unordered_map<std::string_view, std::uint32_t> ids;
+
+        // Consecutive rows in a data file usually share their values, so remember the last hit.
+        std::uint32_t lastId = npos;
+};
+
+#endif //ADVISORBOT_DICTIONARY_H
@@ -0,0 +1,88 @@
+// include necessary C++ libraries and POSIX headers
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "FileTail.h"
+
+// Open the file and start following it from the beginning
+FileTail::FileTail(const std::string &_filename) : filename(_filename) {
+    if (!reopen()) {
+        std::cout << "Couldn't open file: " << filename << std::endl;
+        throw std::runtime_error("Couldn't open file!");
+    }
+}
+
+// Close the file descriptor
+FileTail::~FileTail() {
+    if (fd >= 0)
+        close(fd);
+}
+
+// Open the file under its name again and forget everything read from the previous one
+bool FileTail::reopen() {
+    int newFd = open(filename.c_str(), O_RDONLY);
+    if (newFd < 0)
+        return false;
+
+    struct stat info{};
+    fstat(newFd, &info);
+    if (fd >= 0)
+        close(fd);
+    fd = newFd;
+    device = static_cast<std::uint64_t>(info.st_dev);
+    inode = static_cast<std::uint64_t>(info.st_ino);
+    offset = 0;
+    partial.clear();
+    return true;
+}
+
+const std::string &FileTail::getFilename() const {
+    return filename;
+}
+
+// Read whatever was appended since the last call and hand out the complete lines
+std::string FileTail::readLines(bool &restarted) {
+    restarted = false;
+
+    // a file that shrank was truncated, and a different file under the same name was rotated in:
+    // in both cases the data read so far is gone, so start over
+    struct stat opened{}, named{};
+    bool replaced = stat(filename.c_str(), &named) == 0 &&
+                    (static_cast<std::uint64_t>(named.st_dev) != device ||
+                     static_cast<std::uint64_t>(named.st_ino) != inode);
+    bool truncated = fstat(fd, &opened) == 0 && static_cast<std::uint64_t>(opened.st_size) < offset;
+    if (replaced || truncated) {
+        if (replaced && !reopen())
+            return {};
+        if (truncated && !replaced) {
+            offset = 0;
+            partial.clear();
+        }
+        std::cout << "FileTail: " << filename << " was " << (replaced ? "replaced" : "truncated")
+                  << ", following it from the start" << std::endl;
+        restarted = true;
+    }
+
+    // append the new bytes to the unfinished line left over from the last call
+    std::string data;
+    data.swap(partial);
+    char buffer[1 << 16];
+    for (;;) {
+        ssize_t n = pread(fd, buffer, sizeof(buffer), static_cast<off_t>(offset));
+        if (n <= 0) break;
+        data.append(buffer, static_cast<std::size_t>(n));
+        offset += static_cast<std::uint64_t>(n);
+    }
+
+    // everything after the last line break is a line still being written: keep it for the next call
+    std::size_t end = data.rfind('\n');
+    if (end == std::string::npos) {
+        partial.swap(data);
+        return {};
+    }
+    partial.assign(data, end + 1, std::string::npos);
+    data.resize(end + 1);
+    return data;
+}
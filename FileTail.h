@@ -0,0 +1,47 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_FILETAIL_H
+#define ADVISORBOT_FILETAIL_H
+
+// include necessary standard C++ libraries
+#include <string>
+#include <cstdint>
+
+// Follows a file that another process keeps appending to, like `tail -f`. The file stays open and every call to
+// readLines() returns only the complete lines written since the previous call; an unfinished last line is held
+// back until its line break arrives.
+class FileTail {
+    public:
+        // Open the given file for following from its beginning. Throws std::runtime_error if it cannot be opened.
+        explicit FileTail(const std::string &filename);
+
+        // Close the file.
+        ~FileTail();
+
+        // A tail owns its descriptor, so it can be neither copied nor assigned.
+        FileTail(const FileTail &) = delete;
+        FileTail &operator=(const FileTail &) = delete;
+
+        // Return the complete lines appended since the last call (empty if there are none).
+        // If the file was truncated or replaced, it is reopened, 'restarted' is set to true and the returned
+        // lines start again from the beginning of the file.
+        std::string readLines(bool &restarted);
+
+        // Return the path of the file being followed.
+        const std::string &getFilename() const;
+
+    private:
+        // (Re)open the file and start reading it from the beginning.
+        bool reopen();
+
+        std::string filename;
+        int fd = -1;
+        // identity of the open file, to notice when the path is pointed at a new file
+        std::uint64_t device = 0;
+        std::uint64_t inode = 0;
+        // number of bytes read so far, and the unfinished last line among them
+        std::uint64_t offset = 0;
+        std::string partial;
+};
+
+#endif //ADVISORBOT_FILETAIL_H
@@ -0,0 +1,197 @@
+// Deterministic generator of synthetic order book data in the format of 20200601.csv
+// (timestamp,product,bid/ask,price,amount), for benchmarks and scaling curves from a few rows to hundreds of millions.
+// Build and run with:
+//   make generate-orders
+//   ./generate-orders [--rows N] [--products N] [--timestamps N] [--skew S] [--seed N] <output.csv|->
+// The same options always give the same file, on any platform: the random numbers come from std::mt19937_64, whose
+// sequence the standard fixes, and are turned into uniform and normal values here rather than by the library's
+// distributions, which may differ between implementations.
+
+// include necessary C++ libraries and header files
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <random>
+#include <charconv>
+#include <iostream>
+#include "Timestamp.h"
+
+namespace {
+    // What to generate.
+    struct GeneratorOptions {
+        std::uint64_t rows = 1000000;
+        std::size_t products = 5;
+        // 0 means one time step per 100 rows
+        std::uint64_t timestamps = 0;
+        // exponent of the Zipf distribution of orders over products; 0 gives every product the same share
+        double skew = 0;
+        std::uint64_t seed = 20200601;
+        std::string output;
+    };
+
+    // The products of the sample data and their price levels; further products are made up.
+    struct ProductTemplate {
+        const char *name;
+        double price;
+    };
+    const ProductTemplate sampleProducts[] = {
+            {"BTC/USDT",  9500.0},
+            {"DOGE/BTC",  3.1e-7},
+            {"DOGE/USDT", 0.00258},
+            {"ETH/BTC",   0.0249},
+            {"ETH/USDT",  239.0}
+    };
+
+    // Uniform and normal random numbers from the raw 64-bit output of the engine.
+    class Random {
+        public:
+            explicit Random(std::uint64_t seed) : engine(seed) {
+            }
+
+            // uniform in [0, 1), from the top 53 bits
+            double uniform() { return (double) (engine() >> 11) * (1.0 / 9007199254740992.0); }
+
+            // standard normal, by the Box-Muller transform
+            double normal() {
+                double u = 1.0 - uniform();
+                return std::sqrt(-2.0 * std::log(u)) * std::cos(6.283185307179586 * uniform());
+            }
+
+        private:
+            std::mt19937_64 engine;
+    };
+
+    int usage() {
+        std::cerr << "usage: generate-orders [--rows N] [--products N] [--timestamps N] [--skew S] [--seed N] "
+                     "<output.csv|->" << std::endl;
+        return 2;
+    }
+
+    // Append a number to the line: prices with 8 significant digits like the sample data, amounts with 8 decimals.
+    void appendNumber(std::string &line, double value, bool price) {
+        char buffer[32];
+        std::to_chars_result result = price
+                                      ? std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 8)
+                                      : std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 8);
+        line.append(buffer, result.ptr);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    GeneratorOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            if (!options.output.empty()) return usage();
+            options.output = arg;
+            continue;
+        }
+        // every option takes a value
+        if (i + 1 >= argc) return usage();
+        std::string value = argv[++i];
+        try {
+            if (arg == "--rows") options.rows = std::stoull(value);
+            else if (arg == "--products") options.products = std::stoul(value);
+            else if (arg == "--timestamps") options.timestamps = std::stoull(value);
+            else if (arg == "--skew") options.skew = std::stod(value);
+            else if (arg == "--seed") options.seed = std::stoull(value);
+            else return usage();
+        } catch (const std::exception &e) {
+            return usage();
+        }
+    }
+    if (options.output.empty() || options.rows == 0 || options.products == 0 || options.skew < 0)
+        return usage();
+    if (options.timestamps == 0)
+        options.timestamps = options.rows / 100 > 0 ? options.rows / 100 : 1;
+    if (options.timestamps > options.rows)
+        options.timestamps = options.rows;
+
+    std::FILE *out = options.output == "-" ? stdout : std::fopen(options.output.c_str(), "wb");
+    if (!out) {
+        std::cerr << "generate-orders: could not open " << options.output << std::endl;
+        return 1;
+    }
+
+    // the products in name order, as the order book sorts them, with their starting prices
+    std::vector<std::string> names;
+    std::vector<double> mids;
+    for (std::size_t p = 0; p < options.products; ++p) {
+        if (p < sizeof(sampleProducts) / sizeof(sampleProducts[0])) {
+            names.emplace_back(sampleProducts[p].name);
+            mids.push_back(sampleProducts[p].price);
+        } else {
+            names.push_back("SYN" + std::to_string(p) + "/USDT");
+            mids.push_back(std::pow(10.0, (double) (p % 7) - 2.0));
+        }
+    }
+
+    // cumulative Zipf weights, so a product is drawn with one uniform number and a binary search
+    std::vector<double> cumulative(options.products);
+    double total = 0;
+    for (std::size_t p = 0; p < options.products; ++p) {
+        total += 1.0 / std::pow((double) (p + 1), options.skew);
+        cumulative[p] = total;
+    }
+    for (double &c: cumulative) c /= total;
+
+    Random random{options.seed};
+    std::int64_t start;
+    Timestamp::parse("2020/06/01 11:57:30.328127", start);
+
+    // every time step gets the same number of rows, the first ones one more until the rows are used up
+    std::uint64_t perStep = options.rows / options.timestamps;
+    std::uint64_t extra = options.rows % options.timestamps;
+    std::vector<std::uint64_t> counts(options.products * 2);
+    std::string buffer;
+    buffer.reserve(1 << 21);
+    for (std::uint64_t t = 0; t < options.timestamps; ++t) {
+        std::string timestamp = Timestamp::format(start + (std::int64_t) t * 5 * Timestamp::second);
+
+        // draw which product and side each order is for, then write them grouped like the sample data
+        std::fill(counts.begin(), counts.end(), 0);
+        std::uint64_t rows = perStep + (t < extra ? 1 : 0);
+        for (std::uint64_t r = 0; r < rows; ++r) {
+            double u = random.uniform();
+            std::size_t p = std::lower_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin();
+            if (p >= options.products) p = options.products - 1;
+            ++counts[p * 2 + (random.uniform() < 0.5 ? 0 : 1)];
+        }
+
+        for (std::size_t p = 0; p < options.products; ++p) {
+            // the price level wanders a little from one time step to the next
+            mids[p] *= std::exp(0.001 * random.normal());
+            for (std::size_t side = 0; side < 2; ++side) {
+                for (std::uint64_t n = 0; n < counts[p * 2 + side]; ++n) {
+                    // asks above the level and bids below it, most of them close to it; amounts from dust to large
+                    double offset = std::fabs(random.normal()) * 0.005;
+                    double price = mids[p] * (side == 0 ? 1.0 + offset : 1.0 - offset);
+                    double amount = std::exp(1.2 * random.normal());
+                    buffer += timestamp;
+                    buffer += ',';
+                    buffer += names[p];
+                    buffer += side == 0 ? ",ask," : ",bid,";
+                    appendNumber(buffer, price, true);
+                    buffer += ',';
+                    appendNumber(buffer, amount, false);
+                    buffer += '\n';
+                }
+            }
+        }
+        if (buffer.size() >= (1 << 20)) {
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
+            buffer.clear();
+        }
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), out);
+    bool failed = std::ferror(out) != 0;
+    if (out != stdout) failed = std::fclose(out) != 0 || failed;
+    if (failed) {
+        std::cerr << "generate-orders: could not write " << options.output << std::endl;
+        return 1;
+    }
+    return 0;
+}
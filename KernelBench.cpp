@@ -0,0 +1,148 @@
+// Microbenchmark of the price reduction kernels against the original scalar loops.
+// Build and run with:
+//   g++ --std=c++17 -O2 KernelBench.cpp AggregateTable.cpp Calculator.cpp Dictionary.cpp OrderBookEntry.cpp OrderStore.cpp PriceKernels.cpp Timestamp.cpp -o kernelbench
+//   ./kernelbench [number of prices]
+
+// include necessary C++ libraries and header files
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "Calculator.h"
+#include "PriceKernels.h"
+
+// Time a reduction over a number of repetitions; return the best time per call in milliseconds and the last result.
+template<typename Function>
+static double timeIt(Function function, int repetitions, double &result) {
+    double best = 1e300;
+    for (int r = 0; r < repetitions; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        result = function();
+        auto end = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        best = ms < best ? ms : best;
+    }
+    return best;
+}
+
+// Print one line of the report.
+static void report(const std::string &name, double ms, double result, std::size_t count) {
+    std::cout << std::left << std::setw(34) << name << std::right << std::setw(10) << std::fixed
+              << std::setprecision(3) << ms << " ms" << std::setw(10) << std::setprecision(0)
+              << (double) count / (ms * 1e3) << " M/s   result " << std::setprecision(10) << result << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    if (count == 0) {
+        std::cout << "KernelBench: the number of prices must be positive" << std::endl;
+        return 1;
+    }
+    const int repetitions = 10;
+
+    // Deterministic prices that look like an order book: a level around 5000 with small fractional parts.
+    std::mt19937_64 generator{20200601};
+    std::normal_distribution<double> distribution{5000.0, 250.0};
+    // Amounts are spread over several orders of magnitude, from dust orders to large ones.
+    std::lognormal_distribution<double> amountDistribution{0.0, 2.0};
+    std::vector<double> prices(count);
+    std::vector<double> amounts(count);
+    std::vector<OrderBookEntry> entries;
+    entries.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        prices[i] = distribution(generator);
+        amounts[i] = amountDistribution(generator);
+        entries.push_back({prices[i], amounts[i], 0, 0, OrderBookType::bid});
+    }
+
+    std::cout << "KernelBench: " << count << " prices, dispatched kernels use " << PriceKernels::instructionSet()
+              << std::endl;
+
+    double result = 0;
+    double ms;
+
+    // ---- minimum and maximum
+    ms = timeIt([&] { return Calculator::getLowPrice(entries); }, repetitions, result);
+    report("min   loop over OrderBookEntry", ms, result, count);
+    ms = timeIt([&] {
+        double min = prices[0];
+        for (const double p: prices)
+            if (p < min) min = p;
+        return min;
+    }, repetitions, result);
+    report("min   loop over doubles", ms, result, count);
+    ms = timeIt([&] { return PriceKernels::minPortable(prices); }, repetitions, result);
+    report("min   portable kernel", ms, result, count);
+    ms = timeIt([&] { return PriceKernels::min(prices); }, repetitions, result);
+    report("min   dispatched kernel", ms, result, count);
+
+    ms = timeIt([&] { return Calculator::getHighPrice(entries); }, repetitions, result);
+    report("max   loop over OrderBookEntry", ms, result, count);
+    ms = timeIt([&] { return PriceKernels::maxPortable(prices); }, repetitions, result);
+    report("max   portable kernel", ms, result, count);
+    ms = timeIt([&] { return PriceKernels::max(prices); }, repetitions, result);
+    report("max   dispatched kernel", ms, result, count);
+
+    // ---- sums; the reference is accumulated in long double to measure the error of each variant
+    long double exact = 0;
+    for (const double p: prices)
+        exact += p;
+
+    ms = timeIt([&] { return Calculator::calculateAveragePriceOfOrders(entries) * (double) count; },
+                repetitions, result);
+    report("sum   loop over OrderBookEntry", ms, result, count);
+    double plainError = std::fabs((double) (result - exact));
+    ms = timeIt([&] { return PriceKernels::sumPortable(prices); }, repetitions, result);
+    report("sum   portable kernel", ms, result, count);
+    ms = timeIt([&] { return PriceKernels::sum(prices); }, repetitions, result);
+    report("sum   dispatched kernel", ms, result, count);
+    double laneError = std::fabs((double) (result - exact));
+    ms = timeIt([&] { return PriceKernels::sumPairwise(prices); }, repetitions, result);
+    report("sum   pairwise", ms, result, count);
+    double pairwiseError = std::fabs((double) (result - exact));
+    ms = timeIt([&] { return PriceKernels::sumKahan(prices); }, repetitions, result);
+    report("sum   Kahan-Babuska", ms, result, count);
+    double kahanError = std::fabs((double) (result - exact));
+
+    // ---- fused minimum, maximum and sum against three separate passes
+    ms = timeIt([&] {
+        return Calculator::getLowPrice(entries) + Calculator::getHighPrice(entries) +
+               Calculator::calculateAveragePriceOfOrders(entries);
+    }, repetitions, result);
+    report("min+max+avg  three entry loops", ms, result, count);
+    ms = timeIt([&] {
+        MinMaxSum r = PriceKernels::minMaxSum(prices);
+        return r.min + r.max + r.sum / (double) count;
+    }, repetitions, result);
+    report("min+max+avg  fused kernel", ms, result, count);
+
+    // ---- volume-weighted average price: a loop over the entries against one fused pass over both columns
+    ms = timeIt([&] {
+        double volume = 0, notional = 0;
+        for (const OrderBookEntry &e: entries) {
+            volume += e.amount;
+            notional += e.price * e.amount;
+        }
+        return notional / volume;
+    }, repetitions, result);
+    report("vwap  loop over OrderBookEntry", ms, result, count);
+    ms = timeIt([&] {
+        VolumeNotional r = PriceKernels::volumeNotionalPortable(prices, amounts);
+        return r.notional / r.volume;
+    }, repetitions, result);
+    report("vwap  portable kernel", ms, result, count);
+    ms = timeIt([&] {
+        VolumeNotional r = PriceKernels::volumeNotional(prices, amounts);
+        return r.notional / r.volume;
+    }, repetitions, result);
+    report("vwap  dispatched kernel", ms, result, count);
+
+    std::cout << std::scientific << std::setprecision(3)
+              << "absolute error of the sum: loop " << plainError << ", lanes " << laneError
+              << ", pairwise " << pairwiseError << ", Kahan-Babuska " << kahanError << std::endl;
+    return 0;
+}
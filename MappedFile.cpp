@@ -0,0 +1,64 @@
+// include necessary C++ libraries and POSIX headers
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "MappedFile.h"
+
+// Open the file, query its size and map it read-only into memory
+MappedFile::MappedFile(const std::string &filename) {
+    // open file in read mode
+    fd = open(filename.c_str(), O_RDONLY);
+
+    // if file could not be opened, throw an error
+    if (fd < 0) {
+        std::cout << "Couldn't open file: " << filename << std::endl;
+        throw std::runtime_error("Couldn't open file!");
+    }
+
+    // find out how many bytes have to be mapped
+    struct stat info{};
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        std::cout << "Couldn't stat file: " << filename << std::endl;
+        throw std::runtime_error("Couldn't stat file!");
+    }
+    length = static_cast<std::size_t>(info.st_size);
+
+    // an empty file cannot be mapped, it is simply represented by an empty view
+    if (length == 0)
+        return;
+
+    address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+        address = nullptr;
+        close(fd);
+        std::cout << "Couldn't map file: " << filename << std::endl;
+        throw std::runtime_error("Couldn't map file!");
+    }
+
+    // the file is scanned front to back, so let the kernel read ahead aggressively
+    madvise(address, length, MADV_SEQUENTIAL);
+}
+
+// Release the mapping and the file descriptor
+MappedFile::~MappedFile() {
+    if (address != nullptr)
+        munmap(address, length);
+    if (fd >= 0)
+        close(fd);
+}
+
+// Return the mapped bytes as a read-only view
+std::string_view MappedFile::view() const {
+    if (address == nullptr)
+        return {};
+    return {static_cast<const char *>(address), length};
+}
+
+// Return the number of mapped bytes
+std::size_t MappedFile::size() const {
+    return length;
+}
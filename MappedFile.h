@@ -0,0 +1,36 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_MAPPEDFILE_H
+#define ADVISORBOT_MAPPEDFILE_H
+
+// include necessary standard C++ libraries
+#include <string>
+#include <cstddef>
+#include <string_view>
+
+// Read-only memory mapping of a whole file. The mapping is released when the object goes out of scope.
+class MappedFile {
+    public:
+        // Map the given file into memory. Throws std::runtime_error if the file cannot be opened or mapped.
+        explicit MappedFile(const std::string &filename);
+
+        // Unmap the file and close its descriptor.
+        ~MappedFile();
+
+        // A mapping owns its descriptor, so it can be neither copied nor assigned.
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        // Return the mapped bytes as a read-only view (empty for an empty file).
+        std::string_view view() const;
+
+        // Return the number of mapped bytes.
+        std::size_t size() const;
+
+    private:
+        int fd = -1;
+        void *address = nullptr;
+        std::size_t length = 0;
+};
+
+#endif //ADVISORBOT_MAPPEDFILE_H
@@ -0,0 +1,283 @@
+// include necessary C++ libraries and header files
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include "Metrics.h"
+
+namespace {
+    const std::size_t counterCount = static_cast<std::size_t>(Counter::failedCommands) + 1;
+    const std::size_t phaseCount = static_cast<std::size_t>(LoadPhase::snapshot) + 1;
+
+    // Everything recorded so far. The counters and phase times are atomics; the maps only change under the mutex,
+    // and a histogram, once created, stays where it is.
+    struct Registry {
+        std::atomic<std::uint64_t> counters[counterCount] = {};
+        std::atomic<std::int64_t> phaseNanos[phaseCount] = {};
+        std::mutex mutex;
+        std::map<std::string, std::unique_ptr<LatencyHistogram>> commands;
+        std::map<std::string, std::size_t> memory;
+    };
+
+    // Never destroyed, so that the metrics can still be dumped while the program exits
+    Registry &registry() {
+        static Registry *instance = new Registry;
+        return *instance;
+    }
+
+    std::int64_t nanoseconds(std::chrono::steady_clock::duration elapsed) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+
+    // Copy the command histograms' figures and the memory gauges out under the lock.
+    struct CommandFigures {
+        std::string command;
+        std::uint64_t count, sum, max, p50, p90, p99;
+    };
+
+    std::vector<CommandFigures> commandFigures() {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock{r.mutex};
+        std::vector<CommandFigures> figures;
+        for (const auto &entry: r.commands) {
+            const LatencyHistogram &h = *entry.second;
+            figures.push_back({entry.first, h.count(), h.sum(), h.max(), h.percentile(0.5), h.percentile(0.9),
+                               h.percentile(0.99)});
+        }
+        return figures;
+    }
+
+    std::map<std::string, std::size_t> memoryFigures() {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock{r.mutex};
+        return r.memory;
+    }
+}
+
+// Below subBuckets nanoseconds every value has a bucket of its own; above, the top bits after the leading one
+// pick the part of the power of two
+std::size_t LatencyHistogram::bucket(std::uint64_t nanos) {
+    if (nanos < subBuckets)
+        return static_cast<std::size_t>(nanos);
+    std::size_t exponent = 63;
+    while ((nanos >> exponent) == 0) --exponent;
+    std::size_t part = static_cast<std::size_t>(nanos >> (exponent - 3)) & (subBuckets - 1);
+    return (exponent - 2) * subBuckets + part;
+}
+
+std::uint64_t LatencyHistogram::upperBound(std::size_t bucket) {
+    if (bucket < subBuckets)
+        return bucket;
+    std::size_t exponent = bucket / subBuckets + 2;
+    std::uint64_t lower = static_cast<std::uint64_t>(subBuckets + bucket % subBuckets) << (exponent - 3);
+    return lower + (std::uint64_t(1) << (exponent - 3)) - 1;
+}
+
+void LatencyHistogram::record(std::uint64_t nanos) {
+    buckets[bucket(nanos)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    nanosSum.fetch_add(nanos, std::memory_order_relaxed);
+    std::uint64_t seen = nanosMax.load(std::memory_order_relaxed);
+    while (nanos > seen && !nanosMax.compare_exchange_weak(seen, nanos, std::memory_order_relaxed)) {
+    }
+}
+
+std::uint64_t LatencyHistogram::count() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::sum() const {
+    return nanosSum.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::max() const {
+    return nanosMax.load(std::memory_order_relaxed);
+}
+
+// Walk the buckets until they hold the wanted share of the latencies
+std::uint64_t LatencyHistogram::percentile(double q) const {
+    std::uint64_t recorded = count();
+    if (recorded == 0)
+        return 0;
+    std::uint64_t wanted = static_cast<std::uint64_t>(std::ceil(q * (double) recorded));
+    if (wanted == 0) wanted = 1;
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < bucketCount; ++b) {
+        seen += buckets[b].load(std::memory_order_relaxed);
+        if (seen >= wanted)
+            return std::min(upperBound(b), max());
+    }
+    return max();
+}
+
+void Metrics::add(Counter counter, std::uint64_t amount) {
+    registry().counters[static_cast<std::size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+std::uint64_t Metrics::get(Counter counter) {
+    return registry().counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+void Metrics::addPhase(LoadPhase phase, std::chrono::steady_clock::duration elapsed) {
+    registry().phaseNanos[static_cast<std::size_t>(phase)].fetch_add(nanoseconds(elapsed), std::memory_order_relaxed);
+}
+
+// The histogram of a command is created the first time it is seen and recorded into outside the lock
+void Metrics::recordCommand(const std::string &command, std::chrono::steady_clock::duration elapsed, bool failed) {
+    Registry &r = registry();
+    LatencyHistogram *histogram;
+    {
+        std::lock_guard<std::mutex> lock{r.mutex};
+        std::unique_ptr<LatencyHistogram> &entry = r.commands[command];
+        if (!entry) entry = std::make_unique<LatencyHistogram>();
+        histogram = entry.get();
+    }
+    std::int64_t nanos = nanoseconds(elapsed);
+    histogram->record(nanos < 0 ? 0 : static_cast<std::uint64_t>(nanos));
+    add(Counter::commands);
+    if (failed) add(Counter::failedCommands);
+}
+
+void Metrics::setMemory(const std::string &structure, std::size_t bytes) {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock{r.mutex};
+    r.memory[structure] = bytes;
+}
+
+// A few lines with everything, latencies in microseconds and sizes in MB
+std::vector<std::string> Metrics::report() {
+    Registry &r = registry();
+    std::vector<std::string> lines;
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1);
+
+    text << "rows parsed " << get(Counter::rowsParsed) << ", bad rows " << get(Counter::badRows) << ", read "
+         << (double) get(Counter::bytesRead) / (1024 * 1024) << " MB; commands " << get(Counter::commands) << " ("
+         << get(Counter::failedCommands) << " failed)";
+    lines.push_back(text.str());
+
+    text.str("");
+    text << "load phases:";
+    for (std::size_t p = 0; p < phaseCount; ++p) {
+        text << (p == 0 ? " " : ", ") << name(static_cast<LoadPhase>(p)) << " "
+             << (double) r.phaseNanos[p].load(std::memory_order_relaxed) / 1e6 << " ms";
+    }
+    lines.push_back(text.str());
+
+    std::vector<CommandFigures> figures = commandFigures();
+    if (!figures.empty()) {
+        lines.push_back("command latency in us (count: p50 / p90 / p99 / max):");
+        for (const CommandFigures &f: figures) {
+            text.str("");
+            text << "  " << f.command << " (" << f.count << "): " << (double) f.p50 / 1e3 << " / "
+                 << (double) f.p90 / 1e3 << " / " << (double) f.p99 / 1e3 << " / " << (double) f.max / 1e3;
+            lines.push_back(text.str());
+        }
+    }
+
+    std::map<std::string, std::size_t> memory = memoryFigures();
+    if (!memory.empty()) {
+        text.str("");
+        text << "memory:";
+        bool first = true;
+        for (const auto &entry: memory) {
+            text << (first ? " " : ", ") << entry.first << " " << (double) entry.second / (1024 * 1024) << " MB";
+            first = false;
+        }
+        lines.push_back(text.str());
+    }
+    return lines;
+}
+
+// Counters, summaries with quantiles and gauges, all prefixed with advisorbot_
+void Metrics::write(std::ostream &output) {
+    Registry &r = registry();
+    for (std::size_t c = 0; c < counterCount; ++c) {
+        std::string metric = std::string("advisorbot_") + name(static_cast<Counter>(c)) + "_total";
+        output << "# TYPE " << metric << " counter\n" << metric << " " << get(static_cast<Counter>(c)) << "\n";
+    }
+
+    output << "# TYPE advisorbot_load_phase_seconds_total counter\n";
+    for (std::size_t p = 0; p < phaseCount; ++p) {
+        output << "advisorbot_load_phase_seconds_total{phase=\"" << name(static_cast<LoadPhase>(p)) << "\"} "
+               << (double) r.phaseNanos[p].load(std::memory_order_relaxed) / 1e9 << "\n";
+    }
+
+    output << "# TYPE advisorbot_command_latency_seconds summary\n";
+    for (const CommandFigures &f: commandFigures()) {
+        std::string labels = "command=\"" + f.command + "\"";
+        output << "advisorbot_command_latency_seconds{" << labels << ",quantile=\"0.5\"} " << (double) f.p50 / 1e9
+               << "\nadvisorbot_command_latency_seconds{" << labels << ",quantile=\"0.9\"} " << (double) f.p90 / 1e9
+               << "\nadvisorbot_command_latency_seconds{" << labels << ",quantile=\"0.99\"} " << (double) f.p99 / 1e9
+               << "\nadvisorbot_command_latency_seconds_sum{" << labels << "} " << (double) f.sum / 1e9
+               << "\nadvisorbot_command_latency_seconds_count{" << labels << "} " << f.count << "\n";
+    }
+
+    output << "# TYPE advisorbot_memory_bytes gauge\n";
+    for (const auto &entry: memoryFigures())
+        output << "advisorbot_memory_bytes{structure=\"" << entry.first << "\"} " << entry.second << "\n";
+}
+
+// Written next to the file and renamed over it
+bool Metrics::dump(const std::string &file) {
+    std::string tempFile = file + ".tmp";
+    std::ofstream out{tempFile, std::ios::trunc};
+    if (!out)
+        return false;
+    write(out);
+    out.close();
+    if (!out || std::rename(tempFile.c_str(), file.c_str()) != 0) {
+        std::remove(tempFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+const char *Metrics::name(Counter counter) {
+    switch (counter) {
+        case Counter::rowsParsed: return "rows_parsed";
+        case Counter::badRows: return "bad_rows";
+        case Counter::bytesRead: return "bytes_read";
+        case Counter::commands: return "commands";
+        case Counter::failedCommands: return "failed_commands";
+    }
+    return "unknown";
+}
+
+const char *Metrics::name(LoadPhase phase) {
+    switch (phase) {
+        case LoadPhase::parse: return "parse";
+        case LoadPhase::products: return "products";
+        case LoadPhase::timestamps: return "timestamps";
+        case LoadPhase::index: return "index";
+        case LoadPhase::summaries: return "summaries";
+        case LoadPhase::predictions: return "predictions";
+        case LoadPhase::snapshot: return "snapshot";
+    }
+    return "unknown";
+}
+
+// Sleep until the next dump is due or the dumper is stopped
+MetricsDumper::MetricsDumper(std::string _file, std::chrono::seconds _interval)
+        : file(std::move(_file)), interval(_interval) {
+    thread = std::thread([this] {
+        std::unique_lock<std::mutex> lock{mutex};
+        while (!wake.wait_for(lock, interval, [this] { return stopping; }))
+            Metrics::dump(file);
+    });
+}
+
+MetricsDumper::~MetricsDumper() {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+    Metrics::dump(file);
+}
@@ -0,0 +1,133 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_METRICS_H
+#define ADVISORBOT_METRICS_H
+
+// include necessary standard C++ libraries and header files
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <condition_variable>
+
+// Totals counted over the whole run.
+enum class Counter {
+    rowsParsed,
+    badRows,
+    bytesRead,
+    commands,
+    failedCommands
+};
+
+// The steps of loading a data file whose time is added up.
+enum class LoadPhase {
+    parse, // reading and parsing the CSV file, or reading the snapshot
+    products, // sorting the product dictionary
+    timestamps, // sorting the timestamp dictionary
+    index, // grouping the rows by (timestamp, product, order type)
+    summaries, // the per bucket aggregates
+    predictions, // running the prediction models
+    snapshot // writing the snapshot
+};
+
+// Distribution of latencies in log-linear buckets: every power of two of nanoseconds is split into subBuckets
+// equal parts, so a percentile is off by at most 1/subBuckets of its value. Recording is a few relaxed atomic
+// additions, so many threads can record at once.
+class LatencyHistogram {
+    public:
+        static const std::size_t subBuckets = 8;
+        static const std::size_t bucketCount = 64 * subBuckets;
+
+        // Add one latency.
+        void record(std::uint64_t nanos);
+
+        // Return the number of latencies recorded, their sum and the largest one, in nanoseconds.
+        std::uint64_t count() const;
+        std::uint64_t sum() const;
+        std::uint64_t max() const;
+
+        // Return the latency (in nanoseconds) below which the fraction q of the recorded ones lie, as the upper
+        // end of its bucket. Returns 0 if nothing was recorded.
+        std::uint64_t percentile(double q) const;
+
+    private:
+        // Bucket of a latency, and the largest latency in a bucket.
+        static std::size_t bucket(std::uint64_t nanos);
+        static std::uint64_t upperBound(std::size_t bucket);
+
+        std::atomic<std::uint64_t> buckets[bucketCount] = {};
+        std::atomic<std::uint64_t> total{0};
+        std::atomic<std::uint64_t> nanosSum{0};
+        std::atomic<std::uint64_t> nanosMax{0};
+};
+
+// The instrumentation of the whole program: counters, load phase times, a latency histogram per command and the
+// memory taken by the main structures. Everything is static and safe to update from any thread; the loaders and
+// the query engine record into it as they go, and it is read by the stats command and the dump file.
+class Metrics {
+    public:
+        // Add to a counter.
+        static void add(Counter counter, std::uint64_t amount = 1);
+
+        // Return the value of a counter.
+        static std::uint64_t get(Counter counter);
+
+        // Add to the time spent in a load phase.
+        static void addPhase(LoadPhase phase, std::chrono::steady_clock::duration elapsed);
+
+        // Call a function and add the time it takes to a load phase.
+        template<typename Function>
+        static void time(LoadPhase phase, Function function) {
+            auto start = std::chrono::steady_clock::now();
+            function();
+            addPhase(phase, std::chrono::steady_clock::now() - start);
+        }
+
+        // Record how long a command took and whether it failed.
+        static void recordCommand(const std::string &command, std::chrono::steady_clock::duration elapsed, bool failed);
+
+        // Set how many bytes a structure takes up now, e.g. "index" of the order book loaded last.
+        static void setMemory(const std::string &structure, std::size_t bytes);
+
+        // Describe everything in lines of text for the stats command.
+        static std::vector<std::string> report();
+
+        // Write everything in the Prometheus text format, for monitoring to scrape.
+        static void write(std::ostream &output);
+
+        // Write everything to a file, replacing it in one step so that a reader never sees half of it. Returns
+        // false if the file can't be written.
+        static bool dump(const std::string &file);
+
+        // Return the name of a counter or load phase as it appears in the output.
+        static const char *name(Counter counter);
+        static const char *name(LoadPhase phase);
+};
+
+// Dumps the metrics to a file at a fixed interval on a thread of its own, and once more when it is destroyed.
+class MetricsDumper {
+    public:
+        MetricsDumper(std::string _file, std::chrono::seconds _interval);
+
+        // Stop the thread and write the final dump.
+        ~MetricsDumper();
+
+        // A dumper owns its thread, so it can be neither copied nor assigned.
+        MetricsDumper(const MetricsDumper &) = delete;
+        MetricsDumper &operator=(const MetricsDumper &) = delete;
+
+    private:
+        std::string file;
+        std::chrono::seconds interval;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+        std::thread thread;
+};
+
+#endif //ADVISORBOT_METRICS_H
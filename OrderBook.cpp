@@ -1,147 +1,348 @@
 // including all the necessary C++ libraries and header files
-#include <map>
 #include <utility>
+#include <iostream>
 #include <algorithm>
 #include "OrderBook.h"
 #include "CSVReader.h"
+#include "Snapshot.h"
 #include "Calculator.h"
+#include "Timestamp.h"
+#include "Metrics.h"
 
-OrderBook::OrderBook(const std::string &filename) {
+OrderBook::OrderBook(const std::string &filename, const LoadOptions &options) {
+    load(filename, options);
+}
+
+// This function fills an empty order book from a data file, reporting the stages it reaches
+void OrderBook::load(const std::string &filename, const LoadOptions &options) {
+    // Nothing to report to if no progress is wanted
+    LoadProgress unused;
+    LoadProgress &progress = options.progress ? *options.progress : unused;
+
+    // A file that is still growing is read through a tail that stays open; no snapshot can be up to date for it
+    if (options.follow) {
+        tail = std::make_unique<FileTail>(filename);
+        follow();
+        progress.stage = LoadStage::ready;
+        return;
+    }
+
+    // Start from the binary snapshot if there is an up to date one; its dictionaries are already sorted
+    // Every step is timed as a load phase, see Metrics.h
+    std::string snapshotFile = Snapshot::pathFor(filename);
+    bool fromSnapshot = false;
+    Metrics::time(LoadPhase::parse, [&] {
+        fromSnapshot = options.useSnapshot && Snapshot::read(snapshotFile, filename, store);
+    });
+    if (fromSnapshot) {
+        progress.stage = LoadStage::dictionaries;
+        // The snapshot was written in index order, so this only records where every bucket starts
+        Metrics::time(LoadPhase::index, [&] { index.build(store); });
+        Metrics::time(LoadPhase::summaries, [&] { aggregates.build(store); });
+        Metrics::time(LoadPhase::predictions, [&] { predictions.build(aggregates, store.products.size()); });
+        publishMemory();
+        progress.stage = LoadStage::ready;
+        return;
+    }
+
+    // The snapshot records the file as it was before parsing, so that rows appended in the meantime make it stale
+    Snapshot::SourceInfo source;
+    bool haveSource = Snapshot::sourceInfo(filename, source);
+
+    // Read and parse a CSV file straight into the columns of 'store', interning the products and
+    // timestamps into its dictionaries on the way
+    Metrics::time(LoadPhase::parse, [&] { CSVReader::load(filename, options, store); });
 
-    // Read and parse a CSV file to extract OrderBookEntry objects and store them in the 'orders' field
-    orders = CSVReader::readCSV(filename);
+    // Put both dictionaries in ascending order so that ids sort the same way as the text they stand for
+    sortDictionaries();
+    // From here on the dictionaries don't change, so other threads may read them
+    progress.stage = LoadStage::dictionaries;
 
-    // Populate the 'products' field with the distinct products present in the 'orders' field
-    products = populateProducts();
+    // Group the rows by (timestamp, product, order type) so that every query reads one contiguous range
+    Metrics::time(LoadPhase::index, [&] { index.build(store); });
 
-    // Populate the 'timestamps' field with the distinct timestamps present in the 'orders' field
-    timestamps = populateTimestamps();
+    // Summarise every bucket in one pass, so that min/max/avg/predict never have to look at the rows
+    Metrics::time(LoadPhase::summaries, [&] { aggregates.build(store); });
+    // Run every time step through the prediction models once, so that predict reads their state
+    Metrics::time(LoadPhase::predictions, [&] { predictions.build(aggregates, store.products.size()); });
+    publishMemory();
+
+    // The book can be queried while the snapshot is written, which only reads it
+    progress.stage = LoadStage::ready;
+
+    // Save a snapshot so that the next run can skip parsing the CSV file
+    bool written = true;
+    if (options.useSnapshot)
+        Metrics::time(LoadPhase::snapshot, [&] {
+            written = haveSource && Snapshot::write(snapshotFile, source, store);
+        });
+    if (!written)
+        std::cout << "OrderBook: couldn't write snapshot " << snapshotFile << std::endl;
 }
 
-// This function returns a vector of distinct products present in the 'orders' field
-std::vector<std::string> OrderBook::populateProducts() {
+// This function ingests the lines appended to the followed data file since the last call
+std::size_t OrderBook::follow() {
+    if (!tail)
+        return 0;
 
-    // Create a map to store the products as keys and a boolean value indicating their presence in the map
-    std::map<std::string, bool> prodMap;
+    // Only complete lines are handed out; a line still being written waits for the next call
+    bool restarted = false;
+    std::string lines = tail->readLines(restarted);
+    // A truncated or replaced file is read again from its first line
+    if (restarted)
+        store = OrderStore{};
+    if (lines.empty() && !restarted)
+        return 0;
 
-    // Iterate over the 'orders' field
-    for (const OrderBookEntry &e: orders) {
-        // Add the product to the map
-        prodMap[e.product] = true;
-    }
+    std::size_t firstRow = store.size();
+    std::size_t oldTimestamps = store.timestamps.size();
+    std::size_t oldProducts = store.products.size();
+    RejectedRows rejected;
+    Metrics::time(LoadPhase::parse, [&] { CSVReader::parseBlock(lines, store, nullptr, &rejected); });
+    // The first batch starts the quarantine file afresh, later ones add to it
+    if (!CSVReader::writeQuarantine(tail->getFilename(), rejected, firstRow > 0))
+        std::cout << "OrderBook::follow couldn't write the rejected rows to "
+                  << CSVReader::quarantinePathFor(tail->getFilename()) << std::endl;
 
-    // Reserve space for the 'products' vector to prevent frequent reallocations
-    products.reserve(prodMap.size());
+    // The usual case: the new lines carry on where the file left off, i.e. at the latest time step or later,
+    // with later timestamps and the products already known
+    std::uint32_t lastTimestep = oldTimestamps == 0 ? 0 : static_cast<std::uint32_t>(oldTimestamps - 1);
+    bool appended = oldTimestamps > 0 && store.products.size() == oldProducts;
+    for (std::size_t t = oldTimestamps; appended && t < store.timestamps.size(); ++t)
+        appended = store.timestampMicros[t] > store.timestampMicros[t - 1];
+    for (std::size_t i = firstRow; appended && i < store.size(); ++i)
+        appended = store.timestampIds[i] >= lastTimestep;
 
-    // Iterate over the map
-    for (auto const &e: prodMap) {
-        // Add the product to the 'products' vector
-        products.push_back(e.first);
+    if (appended) {
+        // Fold the new rows into their summaries before the index moves them, then sort only the tail
+        Metrics::time(LoadPhase::summaries, [&] { aggregates.addRows(store, firstRow); });
+        Metrics::time(LoadPhase::index, [&] { index.extend(store, lastTimestep); });
+        Metrics::time(LoadPhase::predictions, [&] {
+            predictions.update(aggregates, store.products.size(), lastTimestep);
+        });
+        ladders.clear(lastTimestep);
+    } else {
+        // The first batch, or one that doesn't fit at the end: put the whole book in order again
+        sortDictionaries();
+        Metrics::time(LoadPhase::index, [&] { index.build(store); });
+        Metrics::time(LoadPhase::summaries, [&] { aggregates.build(store); });
+        Metrics::time(LoadPhase::predictions, [&] { predictions.build(aggregates, store.products.size()); });
+        ladders.clear();
     }
-    // Return the 'products' vector
-    return products;
+    publishMemory();
+
+    std::size_t rows = store.size() - firstRow;
+    if (rows > 0 || rejected.total() > 0)
+        std::cout << "OrderBook::follow read " << rows << " new entries (" << rejected.describe() << ")" << std::endl;
+    return rows;
 }
 
-// This function returns a vector of distinct timestamps present in the 'orders' field
-std::vector<std::string> OrderBook::populateTimestamps() {
+// This function returns true if the data file is kept open to pick up appended lines
+bool OrderBook::isFollowing() const {
+    return tail != nullptr;
+}
+
+// This function sorts the 'products' and 'timestamps' dictionaries and updates the id columns
+void OrderBook::sortDictionaries() {
+    // Sort the products by name, remembering where each old id ended up, and point every row at the new ids
+    Metrics::time(LoadPhase::products, [&] {
+        std::vector<std::uint32_t> productIds = store.products.sort();
+        for (std::uint32_t &id: store.productIds) id = productIds[id];
+    });
 
-    // Create a map to store the timestamps as keys and a boolean value indicating their presence in the map
-    std::map<std::string, bool> timeMap;
+    // Sort the timestamps by their parsed time; the store renumbers the rows itself
+    Metrics::time(LoadPhase::timestamps, [&] { store.sortTimestamps(); });
+}
 
-    // Iterate over the 'orders' field
-    for (const OrderBookEntry &e: orders) {
-        // Add the timestamp to the map
-        timeMap[e.timestamp] = true;
+// This function records how much memory each part of the book takes up, for the stats command and the dump file
+void OrderBook::publishMemory() const {
+    Metrics::setMemory("orders", store.memoryUsage());
+    Metrics::setMemory("index", index.memoryUsage());
+    Metrics::setMemory("summaries", aggregates.memoryUsage());
+    Metrics::setMemory("predictions", predictions.memoryUsage());
+    Metrics::setMemory("ladders", ladders.memoryUsage());
+}
+
+// This function returns the index ranges holding the rows that match the specified criteria
+std::vector<OrderRange>
+OrderBook::matchRanges(OrderBookType type, const std::string &product, const std::string &timestamp) const {
+    std::vector<OrderRange> ranges;
+
+    // Resolve the filters to dictionary ids; an empty filter covers every id
+    std::uint32_t productId = product.empty() ? Dictionary::npos : store.products.find(product);
+    std::uint32_t timestampId = timestamp.empty() ? Dictionary::npos : store.timestamps.find(timestamp);
+
+    // A filter on a value that isn't in the dataset can't match anything
+    if ((!product.empty() && productId == Dictionary::npos) || (!timestamp.empty() && timestampId == Dictionary::npos))
+        return ranges;
+
+    std::uint32_t firstTime = timestamp.empty() ? 0 : timestampId;
+    std::uint32_t lastTime = timestamp.empty() ? static_cast<std::uint32_t>(store.timestamps.size()) : timestampId + 1;
+    std::uint32_t firstProduct = product.empty() ? 0 : productId;
+    std::uint32_t lastProduct = product.empty() ? static_cast<std::uint32_t>(store.products.size()) : productId + 1;
+
+    // Collect the matching buckets, no row is looked at
+    for (std::uint32_t t = firstTime; t < lastTime; ++t) {
+        for (std::uint32_t p = firstProduct; p < lastProduct; ++p) {
+            OrderRange range = getOrderRange(type, p, t);
+            if (!range.empty()) ranges.push_back(range);
+        }
     }
+    return ranges;
+}
 
-    // Reserve space for the 'timestamps' vector to prevent frequent reallocations
-    timestamps.reserve(timeMap.size());
+// This function returns views of the rows that match the specified criteria
+std::vector<OrderRow>
+OrderBook::getOrders(OrderBookType type, const std::string &product, const std::string &timestamp) const {
+    std::vector<OrderRow> orders_sub;
+    for (const OrderRange &range: matchRanges(type, product, timestamp)) {
+        for (std::size_t i = 0; i < range.size(); ++i) {
+            orders_sub.push_back(range[i]);
+        }
+    }
+    return orders_sub;
+}
 
-    // Iterate over the map
-    for (auto const &e: timeMap) {
-        // Add the timestamp to the 'timestamps' vector
-        timestamps.push_back(e.first);
+// This function returns the prices of the rows that match the specified criteria
+std::vector<double>
+OrderBook::getPrices(OrderBookType type, const std::string &product, const std::string &timestamp) const {
+    std::vector<double> prices;
+    for (const OrderRange &range: matchRanges(type, product, timestamp)) {
+        ColumnSpan<double> span = range.prices();
+        prices.insert(prices.end(), span.begin(), span.end());
     }
+    return prices;
+}
 
-    // Sort the 'timestamps' vector in ascending order using the compareTimestamps function from the Calculator class
-    std::sort(timestamps.begin(), timestamps.end(), Calculator::compareTimestamps);
+// This function returns a view of the rows of one (timestamp, product, order type) bucket
+OrderRange OrderBook::getOrderRange(OrderBookType type, std::uint32_t productId, std::uint32_t timestampId) const {
+    std::pair<std::size_t, std::size_t> rows = index.bucket(timestampId, productId, type);
+    return {store, rows.first, rows.second};
+}
 
-    // Return the 'timestamps' vector
-    return timestamps;
+// This function returns the prices of one (timestamp, product, order type) bucket
+ColumnSpan<double> OrderBook::getPriceSpan(OrderBookType type, std::uint32_t productId, std::uint32_t timestampId) const {
+    return getOrderRange(type, productId, timestampId).prices();
 }
 
-// This function returns a vector of OrderBookEntry objects that match the specified criteria
-std::vector<OrderBookEntry>
-OrderBook::getOrders(OrderBookType type, const std::string &product, const std::string &timestamp) {
-    // Create a vector to store the matching OrderBookEntry objects
-    std::vector<OrderBookEntry> orders_sub;
+// This function returns the summary of one (timestamp, product, order type) bucket
+const PriceAggregate &OrderBook::getAggregate(OrderBookType type, std::uint32_t productId, std::uint32_t timestampId) const {
+    return aggregates.at(timestampId, productId, type);
+}
 
-    // Iterate over the 'orders' field
-    for (const OrderBookEntry &e: orders) {
-        if (
-                e.orderType == type && // Check if the OrderBookType of the current OrderBookEntry object matches the input OrderBookType
-                (product.empty() || e.product == product) &&  // Check if the product of the current OrderBookEntry object matches the input product string, if the input product string is no
-                (timestamp.empty() || e.timestamp == timestamp) // Check if the timestamp of the current OrderBookEntry object matches the input timestamp string, if the input timestamp string is not empty
-                )
-            // If the current OrderBookEntry object matches the specified criteria, add it to the 'orders_sub' vector
-            orders_sub.push_back(e);
-    }
+// This function returns the table of bucket summaries
+const AggregateTable &OrderBook::getAggregates() const {
+    return aggregates;
+}
 
-    // Return the 'orders_sub' vector
-    return orders_sub;
+// This function returns the states of the prediction models
+const PredictionTable &OrderBook::getPredictions() const {
+    return predictions;
+}
+
+// This function returns the price ladders of one time step, from the cache if they were built before
+std::shared_ptr<const TimestepLadders> OrderBook::getLadders(std::uint32_t timestampId) const {
+    return ladders.get(store, index, timestampId);
+}
+
+// This function resolves a time range to the time steps inside it
+std::pair<std::uint32_t, std::uint32_t> OrderBook::getTimestepsBetween(std::int64_t fromMicros, std::int64_t toMicros) const {
+    const std::vector<std::int64_t> &times = store.timestampMicros;
+    auto first = std::lower_bound(times.begin(), times.end(), fromMicros);
+    auto end = std::upper_bound(first, times.end(), toMicros);
+    return {static_cast<std::uint32_t>(first - times.begin()), static_cast<std::uint32_t>(end - times.begin())};
+}
+
+// This function returns the summary of a run of time steps of one product and order type
+PriceAggregate OrderBook::getRangeAggregate(OrderBookType type, std::uint32_t productId,
+                                            std::uint32_t firstTimestep, std::uint32_t lastTimestep) const {
+    return aggregates.range(productId, type, firstTimestep, lastTimestep);
+}
+
+// This function returns the id of a product in the 'products' dictionary
+std::uint32_t OrderBook::getProductId(const std::string &product) const {
+    return store.products.find(product);
+}
+
+// This function returns the id of a timestamp in the 'timestamps' dictionary
+std::uint32_t OrderBook::getTimestampId(const std::string &timestamp) const {
+    return store.timestamps.find(timestamp);
 }
 
 // This function returns the earliest timestamp present in the 'timestamps' field
-std::string OrderBook::getEarliestTime() {
+std::string OrderBook::getEarliestTime() const {
+    // A followed file can still be empty
+    if (store.timestamps.size() == 0)
+        return "";
     // Return the first timestamp in the 'timestamps' field
-    return timestamps[0];
+    return store.timestamps.at(0);
 }
 
 // This function returns the next timestamp after the input timestamp, if it exists, or the earliest timestamp if it does not
 std::pair<std::string, int> OrderBook::getNextTime(const std::string &timestamp) {
-    // A string to store the next timestamp
-    std::string nextTimestamp;
-    // An integer to store the index of the next timestamp in the 'timestamps' field
-    unsigned int timestampIndex;
-
-    // Iterate over the 'timestamps' field
-    for (int i = 0; i < timestamps.size(); ++i) {
-        // Check if the current timestamp is after the input timestamp
-        if (timestamps[i] > timestamp) {
-            // If it is, store it in 'nextTimestamp'
-            nextTimestamp = timestamps[i];
-            // Store its index in 'timestampIndex'
-            timestampIndex = i;
-            // Break out of the loop
-            break;
-        }
-    }
-    // If no next timestamp was found
-    if (nextTimestamp.empty()) {
-        // Set 'nextTimestamp' to the earliest timestamp
-        nextTimestamp = timestamps[0];
-        // Set 'timestampIndex' to 0
-        timestampIndex = 0;
-    }
-    // Return a pair containing the 'nextTimestamp' and 'timestampIndex'
-    return {nextTimestamp, timestampIndex};
+    // A timestamp of the dataset is found by hashing, its successor is simply the next id
+    std::uint32_t timestampId = store.timestamps.find(timestamp);
+    if (timestampId != Dictionary::npos)
+        return getNextTime(timestampId);
+
+    // Otherwise the first time after it is the next one
+    return findTime(timestamp);
+}
+
+// This function returns the timestamp that follows the given timestamp id, wrapping around to the earliest one
+std::pair<std::string, int> OrderBook::getNextTime(std::uint32_t timestampId) const {
+    if (store.timestamps.size() == 0)
+        return {"", 0};
+    std::uint32_t nextId = timestampId + 1 < store.timestamps.size() ? timestampId + 1 : 0;
+    return {store.timestamps.at(nextId), static_cast<int>(nextId)};
+}
+
+// This function returns the timestamp itself if the book has it, or else the first one after it, wrapping around
+std::pair<std::string, int> OrderBook::findTime(const std::string &timestamp) const {
+    if (store.timestamps.size() == 0)
+        return {"", 0};
+    std::uint32_t timestampId = store.timestamps.find(timestamp);
+    if (timestampId != Dictionary::npos)
+        return {store.timestamps.at(timestampId), static_cast<int>(timestampId)};
+
+    // Look for the first time after it with a binary search over the sorted times
+    std::int64_t micros;
+    if (!Timestamp::parse(timestamp, micros))
+        return {store.timestamps.at(0), 0};
+    auto next = std::upper_bound(store.timestampMicros.begin(), store.timestampMicros.end(), micros);
+    if (next == store.timestampMicros.end())
+        return {store.timestamps.at(0), 0};
+    std::uint32_t nextId = static_cast<std::uint32_t>(next - store.timestampMicros.begin());
+    return {store.timestamps.at(nextId), static_cast<int>(nextId)};
+}
+
+// This function returns the time of a timestamp id in microseconds since the epoch
+std::int64_t OrderBook::getTimestampMicros(std::uint32_t timestampId) const {
+    return store.timestampMicros[timestampId];
 }
 
-// This function returns a reference to the 'products' field
+// This function returns the sorted values of the 'products' dictionary
 const std::vector<std::string> &OrderBook::getProducts() const {
-    return products;
+    return store.products.values();
 }
 
-// This function returns a reference to the 'timestamps' field
+// This function returns the sorted values of the 'timestamps' dictionary
 const std::vector<std::string> &OrderBook::getTimestamps() const {
-    return timestamps;
+    return store.timestamps.values();
 }
 
-// This function returns true if the input product string is present in the 'products' field, false otherwise
-bool OrderBook::checkProductExists(std::string product) {
-    return std::any_of(products.begin(), products.end(), [&product](const std::string &p) { return p == product; });
+// This function adds up the memory taken by the store, the index and the summaries
+std::size_t OrderBook::memoryUsage() const {
+    return store.memoryUsage() + index.memoryUsage() + aggregates.memoryUsage() + predictions.memoryUsage() +
+           ladders.memoryUsage();
 }
 
+// This function returns true if the input product string is present in the 'products' dictionary, false otherwise
+bool OrderBook::checkProductExists(const std::string &product) const {
+    return store.products.find(product) != Dictionary::npos;
+}
+
+
 // This function returns true if the input orderType string is a valid OrderBookType, false otherwise
 bool OrderBook::isValidOrderType(const std::string &orderType) const {
     return orderBookTypes.count(orderType) > 0;
@@ -7,38 +7,119 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <memory>
 #include "CSVReader.h"
+#include "FileTail.h"
+#include "OrderStore.h"
+#include "OrderIndex.h"
+#include "AggregateTable.h"
+#include "PriceLadder.h"
+#include "PredictionTable.h"
+#include "ColumnSpan.h"
 #include "OrderBookEntry.h"
 
 // Order Book Class
 class OrderBook {
     public:
-        // Construct an object by reading a CSV data file.
-        explicit OrderBook(const std::string &filename);
+        // Construct an object by reading a CSV data file with the given ingestion options.
+        explicit OrderBook(const std::string &filename, const LoadOptions &options = LoadOptions{});
 
-        // Return a vector of Orders that match the specified filters, or all Orders if no filters are supplied.
-        std::vector<OrderBookEntry>
-        getOrders(OrderBookType type, const std::string &product = "", const std::string &timestamp = "");
+        // Construct an empty order book, to be filled by load().
+        OrderBook() = default;
 
-        // Return the earliest time in the orderbook.
-        std::string getEarliestTime();
+        // Read a CSV data file (or its snapshot) into an empty order book. If options.progress is set, its stage
+        // becomes LoadStage::dictionaries as soon as getProducts(), getTimestamps() and the time step lookups can
+        // be used, while the index and summaries are still being built on this thread, and LoadStage::ready at the
+        // end. Throws std::runtime_error if the file can't be read.
+        void load(const std::string &filename, const LoadOptions &options = LoadOptions{});
+
+        // In follow mode (LoadOptions::follow), ingest the complete lines appended to the data file since the
+        // last call and extend the dictionaries, index and summaries with them. Lines for the latest known time
+        // step or later are added incrementally; anything else (new products, late rows for earlier time steps)
+        // re-sorts the whole book. Returns the number of new rows; does nothing when not following.
+        std::size_t follow();
+
+        // Determine whether the data file is being followed.
+        bool isFollowing() const;
+
+        // Return views of the Orders that match the specified filters, or all Orders if no filters are supplied.
+        std::vector<OrderRow>
+        getOrders(OrderBookType type, const std::string &product = "", const std::string &timestamp = "") const;
+
+        // Return the prices of the Orders that match the specified filters, in dataset order.
+        std::vector<double>
+        getPrices(OrderBookType type, const std::string &product = "", const std::string &timestamp = "") const;
+
+        // Return a view of the Orders of one product and order type at one timestamp, straight from the index.
+        // Nothing is copied; the view is empty if there are no such Orders.
+        OrderRange getOrderRange(OrderBookType type, std::uint32_t productId, std::uint32_t timestampId) const;
+
+        // Return the prices of the Orders of one product and order type at one timestamp, without copying them.
+        ColumnSpan<double> getPriceSpan(OrderBookType type, std::uint32_t productId, std::uint32_t timestampId) const;
+
+        // Return the precomputed min/max/sum/count of the Orders of one product and order type at one timestamp.
+        const PriceAggregate &getAggregate(OrderBookType type, std::uint32_t productId, std::uint32_t timestampId) const;
+
+        // Return the table of per (timestamp, product, order type) summaries.
+        const AggregateTable &getAggregates() const;
+
+        // Return the per time step states of the prediction models.
+        const PredictionTable &getPredictions() const;
+
+        // Return the sorted price levels of every product and order type at one timestamp, built on first use and
+        // cached for the most recently used timestamps.
+        std::shared_ptr<const TimestepLadders> getLadders(std::uint32_t timestampId) const;
+
+        // Return the time steps whose time lies within [fromMicros, toMicros] (microseconds since the epoch) as the
+        // ids [first, end), found by binary search over the sorted times; first == end if there are none.
+        std::pair<std::uint32_t, std::uint32_t> getTimestepsBetween(std::int64_t fromMicros, std::int64_t toMicros) const;
+
+        // Return the min/max/sum/count of all Orders of one product and order type in the time steps
+        // [firstTimestep, lastTimestep], without looking at the Orders themselves.
+        PriceAggregate getRangeAggregate(OrderBookType type, std::uint32_t productId,
+                                         std::uint32_t firstTimestep, std::uint32_t lastTimestep) const;
+
+        // Return the id of a product, or Dictionary::npos if it isn't in the dataset.
+        std::uint32_t getProductId(const std::string &product) const;
+
+        // Return the id of a timestamp (its position in getTimestamps()), or Dictionary::npos if it isn't in the dataset.
+        std::uint32_t getTimestampId(const std::string &timestamp) const;
+
+        // Return the earliest time in the orderbook, or an empty string if it has no time steps (yet).
+        std::string getEarliestTime() const;
 
         // Return the next time after the specified time in the orderbook. If there is no next time, 
-        // return the earliest time in the orderbook.
+        // return the earliest time in the orderbook. An empty orderbook gives {"", 0}.
         std::pair<std::string, int> getNextTime(const std::string &timestamp);
 
+        // Return the time step after the one with the given id, wrapping around to the earliest one, in constant time.
+        // An empty orderbook gives {"", 0}.
+        std::pair<std::string, int> getNextTime(std::uint32_t timestampId) const;
+
+        // Return the time step of a time with its id: the time itself if the orderbook has it, otherwise the first
+        // time after it, or the earliest time if there is none. Used to find a cursor again after the time steps
+        // were renumbered or the file was replaced. An empty orderbook gives {"", 0}.
+        std::pair<std::string, int> findTime(const std::string &timestamp) const;
+
+        // Return the time of the time step with the given id, in microseconds since the epoch.
+        std::int64_t getTimestampMicros(std::uint32_t timestampId) const;
+
         // Determine whether a product with the given name exists in the dataset.
-        bool checkProductExists(std::string product);
+        bool checkProductExists(const std::string &product) const;
 
         // Determine whether a given string represents a valid order type based on the corresponding Enum.
         bool isValidOrderType(const std::string &orderType) const;
 
-        // Retrieve the products vector.
+        // Retrieve the products, sorted in ascending order.
         const std::vector<std::string> &getProducts() const;
 
-        // Retrieve the timestamps vector.
+        // Retrieve the timestamps, sorted in time order.
         const std::vector<std::string> &getTimestamps() const;
 
+        // Return roughly how many bytes the orders, the index, the summaries, the prediction states and the cached
+        // ladders take up.
+        std::size_t memoryUsage() const;
+
         // A map of valid order book types and their corresponding Enum values, with the string values 
         // as the keys and the Enum values as the corresponding values.
         std::map<std::string, OrderBookType> orderBookTypes = {
@@ -47,16 +128,35 @@ class OrderBook {
         };
 
     private:
-        // Populate a vector with all known products in the dataset.
-        std::vector<std::string> populateProducts();
+        // Sort the product and timestamp dictionaries and renumber the id columns to match.
+        void sortDictionaries();
+
+        // Record the memory taken by the orders, the index, the summaries, the prediction states and the cached
+        // ladders as the memory of the order book loaded last, see Metrics.h.
+        void publishMemory() const;
+
+        // Return the index ranges that hold the rows matching the specified filters, in dataset order.
+        std::vector<OrderRange>
+        matchRanges(OrderBookType type, const std::string &product, const std::string &timestamp) const;
+
+        // The orders in columnar form, together with the product and timestamp dictionaries.
+        // The rows are kept grouped by (timestamp, product, order type).
+        OrderStore store;
+
+        // Where each (timestamp, product, order type) group of rows starts in 'store'.
+        OrderIndex index;
+
+        // Price summary of each (timestamp, product, order type) group of rows.
+        AggregateTable aggregates;
+
+        // State of every prediction model after each time step, computed from the summaries.
+        PredictionTable predictions;
 
-        // Populate a vector with all timestamps in the dataset.
-        std::vector<std::string> populateTimestamps();
+        // Price ladders of the recently queried time steps; filling the cache doesn't change the book.
+        mutable LadderCache ladders;
 
-        // Vectors for storing specific parts of CSV data in memory for efficient access.
-        std::vector<OrderBookEntry> orders;
-        std::vector<std::string> products;
-        std::vector<std::string> timestamps;
+        // The data file kept open in follow mode, null otherwise.
+        std::unique_ptr<FileTail> tail;
 };
 
 #endif //ADVISORBOT_ORDERBOOK_H
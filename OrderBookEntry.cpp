@@ -1,7 +1,7 @@
 #include "OrderBookEntry.h"
 
 // This function converts a string to the corresponding OrderBookType enum value
-OrderBookType OrderBookEntry::stringToOrderBookType(const std::string &s) {
+OrderBookType OrderBookEntry::stringToOrderBookType(std::string_view s) {
     // If the input string is "bid", return the bid enum value
     if (s == "bid"){
         return OrderBookType::bid;
@@ -18,8 +18,8 @@ OrderBookType OrderBookEntry::stringToOrderBookType(const std::string &s) {
 
 // This function compares two OrderBookEntry objects based on their timestamps
 // It returns true if the timestamp of the first object is less than the timestamp of the second object, false otherwise
-bool OrderBookEntry::compareByTimestampAsc(OrderBookEntry &e1, OrderBookEntry &e2) {
-    return e1.timestamp < e2.timestamp;
+bool OrderBookEntry::compareByTimestampAsc(const OrderBookEntry &e1, const OrderBookEntry &e2) {
+    return e1.timestampId < e2.timestampId;
 }
 
 // This function converts an OrderBookType enum value to a string
@@ -37,8 +37,9 @@ std::string OrderBookEntry::orderBookTypeToString(OrderBookType t) {
 }
 
 // This function returns a string representation of the OrderBookEntry object
-std::string OrderBookEntry::toString() const {
+std::string OrderBookEntry::toString(const Dictionary &timestamps, const Dictionary &products) const {
     std::string s;
-    s += timestamp + " | " + product + " | " + orderBookTypeToString(orderType) + " | " + std::to_string(price);
+    s += timestamps.at(timestampId) + " | " + products.at(productId) + " | " + orderBookTypeToString(orderType) +
+         " | " + std::to_string(price);
     return s;
 }
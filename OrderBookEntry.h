@@ -5,7 +5,10 @@
 
 // include necessary standard C++ libraries
 #include <string>
+#include <cstdint>
 #include <utility>
+#include <string_view>
+#include "Dictionary.h"
 
 /*
 Note:
@@ -13,41 +16,48 @@ I utilized the code from the OrderBookEntry module, specifically the merklerex p
 Some of the code remains unchanged, while other parts were modified or rewritten by me.
 */
 
-enum class OrderBookType {
+enum class OrderBookType : std::uint8_t {
     bid,
     ask,
     unknown
 };
 
+// A single order. The timestamp and product are ids into the dictionaries owned by the OrderBook,
+// which keeps every entry small and free of heap allocations.
 class OrderBookEntry {
     public:
 
         OrderBookEntry(
                 double _price,
-                std::string _timestamp,
-                std::string _product,
+                double _amount,
+                std::uint32_t _timestampId,
+                std::uint32_t _productId,
                 OrderBookType _orderType
         ) : price(_price),
-            timestamp(std::move(_timestamp)),
-            product(std::move(_product)),
+            amount(_amount),
+            timestampId(_timestampId),
+            productId(_productId),
             orderType(_orderType) {
         }
 
         // Convert string values to their corresponding Enum type using a map.
-        static OrderBookType stringToOrderBookType(const std::string &s);
+        static OrderBookType stringToOrderBookType(std::string_view s);
 
         // Convert an Enum type to its string representation.
         static std::string orderBookTypeToString(OrderBookType t);
 
         // A helper method for comparing two entries based on their Timestamp values.
-        static bool compareByTimestampAsc(OrderBookEntry &e1, OrderBookEntry &e2);
+        // Timestamp ids are assigned in time order, so comparing ids compares the parsed times without touching text.
+        static bool compareByTimestampAsc(const OrderBookEntry &e1, const OrderBookEntry &e2);
 
-        // Generate a string representation of an OrderBookEntry. 
-        std::string toString() const;
+        // Generate a string representation of an OrderBookEntry, looking up its text in the given dictionaries.
+        std::string toString(const Dictionary &timestamps, const Dictionary &products) const;
 
         double price;
-        std::string timestamp;
-        std::string product;
+        // the quantity ordered, in units of the product's base currency
+        double amount;
+        std::uint32_t timestampId;
+        std::uint32_t productId;
         OrderBookType orderType;
 };
 
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <type_traits>
+#include "OrderIndex.h"
+
+// Buckets are laid out timestamp first, then product, then order type
+std::size_t OrderIndex::key(std::uint32_t timestampId, std::uint32_t productId, OrderBookType type) const {
+    return (timestampId * productCount + productId) * orderTypeCount + static_cast<std::size_t>(type);
+}
+
+// Index the whole store from scratch
+void OrderIndex::build(OrderStore &store) {
+    productCount = store.products.size();
+    timestampCount = 0;
+    starts.assign(1, 0);
+    extend(store, 0);
+}
+
+// Sort the rows of the trailing time steps into buckets with a counting sort, which keeps rows of the same
+// bucket in file order
+void OrderIndex::extend(OrderStore &store, std::uint32_t fromTimestep) {
+    // the bucket layout depends on the number of products, so a new product means starting over
+    if (store.products.size() != productCount) {
+        build(store);
+        return;
+    }
+
+    // everything before the first bucket of 'fromTimestep' is already in place
+    std::size_t firstKey = std::min<std::size_t>(fromTimestep, timestampCount) * productCount * orderTypeCount;
+    std::size_t firstRow = starts[firstKey];
+    timestampCount = store.timestamps.size();
+    std::size_t rows = store.size();
+
+    // count the rows of every remaining bucket, noting whether they are already in bucket order
+    std::vector<std::size_t> bucketOfRow(rows - firstRow);
+    starts.resize(firstKey + 1);
+    starts.resize(timestampCount * productCount * orderTypeCount + 1, 0);
+    bool sorted = true;
+    for (std::size_t i = firstRow; i < rows; ++i) {
+        std::size_t b = key(store.timestampIds[i], store.productIds[i], store.orderTypes[i]);
+        bucketOfRow[i - firstRow] = b;
+        if (i > firstRow && b < bucketOfRow[i - firstRow - 1]) sorted = false;
+        ++starts[b + 1];
+    }
+
+    // turn the counts into start positions
+    for (std::size_t b = firstKey + 1; b < starts.size(); ++b) {
+        starts[b] += starts[b - 1];
+    }
+    if (sorted) return;
+
+    // work out the new position of every row, then move each column into that order
+    std::vector<std::size_t> next(starts.begin() + firstKey, starts.end() - 1);
+    std::vector<std::size_t> target(rows - firstRow);
+    for (std::size_t i = 0; i < target.size(); ++i) {
+        target[i] = next[bucketOfRow[i] - firstKey]++ - firstRow;
+    }
+    auto scatter = [&target, firstRow](auto &column) {
+        typename std::remove_reference<decltype(column)>::type reordered(target.size());
+        for (std::size_t i = 0; i < target.size(); ++i) reordered[target[i]] = column[firstRow + i];
+        std::copy(reordered.begin(), reordered.end(), column.begin() + firstRow);
+    };
+    scatter(store.prices);
+    scatter(store.amounts);
+    scatter(store.timestampIds);
+    scatter(store.productIds);
+    scatter(store.orderTypes);
+}
+
+// Look up the rows of one bucket
+std::pair<std::size_t, std::size_t>
+OrderIndex::bucket(std::uint32_t timestampId, std::uint32_t productId, OrderBookType type) const {
+    if (timestampId >= timestampCount || productId >= productCount)
+        return {0, 0};
+    std::size_t k = key(timestampId, productId, type);
+    return {starts[k], starts[k + 1]};
+}
+
+// The bucket starts are all there is
+std::size_t OrderIndex::memoryUsage() const {
+    return starts.capacity() * sizeof(std::size_t);
+}
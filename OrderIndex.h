@@ -0,0 +1,49 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_ORDERINDEX_H
+#define ADVISORBOT_ORDERINDEX_H
+
+// include necessary standard C++ libraries and header files
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include "OrderStore.h"
+#include "OrderBookEntry.h"
+
+// Groups the rows of an OrderStore by (timestamp, product, order type). After build() the rows of every such
+// bucket sit next to each other in the store, in their original order, and the index knows where each bucket
+// starts, so looking up the orders of one bucket is a constant-time array access.
+class OrderIndex {
+    public:
+        // Number of order types a bucket is split into (bid, ask, unknown).
+        static const std::size_t orderTypeCount = 3;
+
+        // Reorder the rows of 'store' by bucket and record where every bucket starts.
+        // The store's dictionaries must already be sorted. A store that is already in bucket order is left as is.
+        void build(OrderStore &store);
+
+        // Bring the index up to date after rows were appended to 'store', re-sorting only the rows from time step
+        // 'fromTimestep' on. Every appended row must belong to 'fromTimestep' or a later time step, and the
+        // timestamps added to the dictionary must sort after the existing ones. If the number of products
+        // changed, the whole store is re-indexed.
+        void extend(OrderStore &store, std::uint32_t fromTimestep);
+
+        // Return the rows [first, last) of one bucket; ids outside the dataset give an empty range.
+        std::pair<std::size_t, std::size_t>
+        bucket(std::uint32_t timestampId, std::uint32_t productId, OrderBookType type) const;
+
+        // Return how many bytes the index takes up.
+        std::size_t memoryUsage() const;
+
+    private:
+        // Position of a bucket in 'starts'.
+        std::size_t key(std::uint32_t timestampId, std::uint32_t productId, OrderBookType type) const;
+
+        // First row of every bucket, followed by the number of rows.
+        std::vector<std::size_t> starts;
+        std::size_t productCount = 0;
+        std::size_t timestampCount = 0;
+};
+
+#endif //ADVISORBOT_ORDERINDEX_H
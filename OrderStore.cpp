@@ -0,0 +1,85 @@
+#include "OrderStore.h"
+#include "Timestamp.h"
+
+// Append one order to the end of every column
+void OrderStore::append(double price, double amount, std::uint32_t timestampId, std::uint32_t productId,
+                        OrderBookType orderType) {
+    prices.push_back(price);
+    amounts.push_back(amount);
+    timestampIds.push_back(timestampId);
+    productIds.push_back(productId);
+    orderTypes.push_back(orderType);
+}
+
+// Append one order given as an entry
+void OrderStore::append(const OrderBookEntry &entry) {
+    append(entry.price, entry.amount, entry.timestampId, entry.productId, entry.orderType);
+}
+
+// Reserve room in every column
+void OrderStore::reserve(std::size_t rows) {
+    prices.reserve(rows);
+    amounts.reserve(rows);
+    timestampIds.reserve(rows);
+    productIds.reserve(rows);
+    orderTypes.reserve(rows);
+}
+
+// All columns have the same length, so any of them gives the number of rows
+std::size_t OrderStore::size() const {
+    return prices.size();
+}
+
+// Gather the given row from every column
+OrderBookEntry OrderStore::entry(std::size_t row) const {
+    return {prices[row], amounts[row], timestampIds[row], productIds[row], orderTypes[row]};
+}
+
+// Intern the timestamp and parse it the first time it is seen
+std::uint32_t OrderStore::internTimestamp(std::string_view text) {
+    std::uint32_t id = timestamps.intern(text);
+    if (id < timestampMicros.size())
+        return id;
+
+    std::int64_t micros;
+    if (!Timestamp::parse(text, micros)) {
+        timestamps.removeLast();
+        return Dictionary::npos;
+    }
+    timestampMicros.push_back(micros);
+    return id;
+}
+
+// Parse the dictionary entries that don't have a time yet
+bool OrderStore::parseTimestamps() {
+    for (std::size_t id = timestampMicros.size(); id < timestamps.size(); ++id) {
+        std::int64_t micros;
+        if (!Timestamp::parse(timestamps.at(static_cast<std::uint32_t>(id)), micros))
+            return false;
+        timestampMicros.push_back(micros);
+    }
+    return true;
+}
+
+// Order the timestamps by time rather than by text
+void OrderStore::sortTimestamps() {
+    std::vector<std::uint32_t> remap = timestamps.sortBy(timestampMicros);
+
+    std::vector<std::int64_t> sorted(timestampMicros.size());
+    for (std::size_t id = 0; id < remap.size(); ++id) sorted[remap[id]] = timestampMicros[id];
+    timestampMicros.swap(sorted);
+
+    for (std::uint32_t &id: timestampIds) id = remap[id];
+}
+
+// Render the row with the text of its timestamp and product
+std::string OrderRow::toString() const {
+    return store->entry(row).toString(store->timestamps, store->products);
+}
+
+// The columns by their capacity, plus the dictionaries
+std::size_t OrderStore::memoryUsage() const {
+    return (prices.capacity() + amounts.capacity()) * sizeof(double) + timestampIds.capacity() * sizeof(std::uint32_t) +
+           productIds.capacity() * sizeof(std::uint32_t) + orderTypes.capacity() * sizeof(OrderBookType) +
+           timestampMicros.capacity() * sizeof(std::int64_t) + timestamps.memoryUsage() + products.memoryUsage();
+}
@@ -0,0 +1,123 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_ORDERSTORE_H
+#define ADVISORBOT_ORDERSTORE_H
+
+// include necessary standard C++ libraries and header files
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include "Dictionary.h"
+#include "ColumnSpan.h"
+#include "OrderBookEntry.h"
+
+// Column-oriented storage for orders: every field lives in its own contiguous vector, so a scan only
+// touches the columns it needs. Row i of the store is made of element i of every column.
+class OrderStore {
+    public:
+        // Append one order to the end of every column.
+        void append(double price, double amount, std::uint32_t timestampId, std::uint32_t productId, OrderBookType orderType);
+
+        // Append one order given as an entry.
+        void append(const OrderBookEntry &entry);
+
+        // Reserve room for the given number of rows in every column.
+        void reserve(std::size_t rows);
+
+        // Return the number of rows.
+        std::size_t size() const;
+
+        // Return a copy of the given row as an entry.
+        OrderBookEntry entry(std::size_t row) const;
+
+        // Return the id of a timestamp, adding it to the dictionary together with its parsed time if it is new.
+        // Returns Dictionary::npos, and adds nothing, if the text is not a valid timestamp.
+        std::uint32_t internTimestamp(std::string_view text);
+
+        // Parse the timestamps that were added to the dictionary without going through internTimestamp().
+        // Returns false if one of them is not a valid timestamp.
+        bool parseTimestamps();
+
+        // Sort the timestamp dictionary by time and renumber the timestamp id column to match.
+        void sortTimestamps();
+
+        // Return roughly how many bytes the columns and dictionaries take up.
+        std::size_t memoryUsage() const;
+
+        // The columns.
+        std::vector<double> prices;
+        std::vector<double> amounts;
+        std::vector<std::uint32_t> timestampIds;
+        std::vector<std::uint32_t> productIds;
+        std::vector<OrderBookType> orderTypes;
+
+        // The dictionaries the id columns refer to.
+        Dictionary timestamps;
+        Dictionary products;
+
+        // The time of every timestamp in the dictionary, in microseconds since the epoch, indexed by timestamp id.
+        std::vector<std::int64_t> timestampMicros;
+};
+
+// A lightweight, non-owning view of one row of an OrderStore.
+// It stays valid as long as the store is alive and not modified.
+class OrderRow {
+    public:
+        OrderRow(const OrderStore &_store, std::size_t _row) : store(&_store), row(_row) {
+        }
+
+        // Position of the row in its store.
+        std::size_t index() const { return row; }
+
+        double price() const { return store->prices[row]; }
+        double amount() const { return store->amounts[row]; }
+        std::uint32_t timestampId() const { return store->timestampIds[row]; }
+        std::uint32_t productId() const { return store->productIds[row]; }
+        OrderBookType orderType() const { return store->orderTypes[row]; }
+
+        // Text of the row's timestamp and product.
+        const std::string &timestamp() const { return store->timestamps.at(timestampId()); }
+        const std::string &product() const { return store->products.at(productId()); }
+
+        // Generate a string representation of the row, in the same format as OrderBookEntry::toString.
+        std::string toString() const;
+
+    private:
+        const OrderStore *store;
+        std::size_t row;
+};
+
+// A lightweight, non-owning view of the contiguous rows [first, last) of an OrderStore.
+class OrderRange {
+    public:
+        OrderRange() = default;
+
+        OrderRange(const OrderStore &_store, std::size_t _first, std::size_t _last)
+                : store(&_store), first(_first), last(_last) {
+        }
+
+        std::size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+
+        // The i-th row of the range.
+        OrderRow operator[](std::size_t i) const { return {*store, first + i}; }
+
+        // The prices of the rows in the range, straight out of the price column.
+        ColumnSpan<double> prices() const {
+            return empty() ? ColumnSpan<double>{} : ColumnSpan<double>{store->prices.data() + first, size()};
+        }
+
+        // The amounts of the rows in the range, in the same order as their prices.
+        ColumnSpan<double> amounts() const {
+            return empty() ? ColumnSpan<double>{} : ColumnSpan<double>{store->amounts.data() + first, size()};
+        }
+
+    private:
+        const OrderStore *store = nullptr;
+        std::size_t first = 0;
+        std::size_t last = 0;
+};
+
+#endif //ADVISORBOT_ORDERSTORE_H
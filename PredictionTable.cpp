@@ -0,0 +1,91 @@
+// include necessary C++ libraries and header files
+#include "PredictionTable.h"
+
+// The names predict accepts
+bool PredictionTable::parseModel(const std::string &name, PredictionModel &model) {
+    if (name == "mean") model = PredictionModel::mean;
+    else if (name == "ewma") model = PredictionModel::ewma;
+    else if (name == "linear") model = PredictionModel::linear;
+    else if (name == "holt") model = PredictionModel::holt;
+    else return false;
+    return true;
+}
+
+std::string PredictionTable::modelNames() {
+    return "mean/ewma/linear/holt";
+}
+
+// Two states (minimum, maximum) per (time step, product, order type), laid out like the AggregateTable
+std::size_t PredictionTable::key(std::size_t timestep, std::size_t productId, OrderBookType type) const {
+    return ((timestep * productCount + productId) * AggregateTable::orderTypeCount + static_cast<std::size_t>(type)) * 2;
+}
+
+// Start from empty states and run every time step through the models
+void PredictionTable::build(const AggregateTable &aggregates, std::size_t products) {
+    states.clear();
+    productCount = products;
+    timestampCount = 0;
+    update(aggregates, products, 0);
+}
+
+// Every time step starts from the states of the one before it and adds its own minimum and maximum
+void PredictionTable::update(const AggregateTable &aggregates, std::size_t products, std::size_t fromTimestep) {
+    if (products != productCount) {
+        build(aggregates, products);
+        return;
+    }
+    timestampCount = aggregates.timestamps();
+    std::size_t series = productCount * AggregateTable::orderTypeCount * 2;
+    states.resize(timestampCount * series);
+
+    for (std::size_t t = fromTimestep; t < timestampCount; ++t) {
+        for (std::uint32_t p = 0; p < productCount; ++p) {
+            for (std::size_t o = 0; o < AggregateTable::orderTypeCount; ++o) {
+                OrderBookType type = static_cast<OrderBookType>(o);
+                std::size_t k = key(t, p, type);
+                for (std::size_t extreme = 0; extreme < 2; ++extreme) {
+                    SeriesState state = t == 0 ? SeriesState{} : states[k - series + extreme];
+                    const PriceAggregate &bucket = aggregates.at(static_cast<std::uint32_t>(t), p, type);
+                    if (!bucket.empty()) {
+                        double value = extreme == 0 ? bucket.min : bucket.max;
+                        std::uint32_t timestep = static_cast<std::uint32_t>(t);
+                        Ewma::update(state.ewma, value, timestep);
+                        Holt::update(state.holt, value, timestep);
+                        LinearTrend::update(state.linear, value, timestep);
+                    }
+                    states[k + extreme] = state;
+                }
+            }
+        }
+    }
+}
+
+// Read the states of the time step and hand them to the model
+double PredictionTable::forecast(PredictionModel model, std::uint32_t productId, OrderBookType type, bool max,
+                                 std::uint32_t timestepId) const {
+    if (productId >= productCount || timestepId >= timestampCount)
+        return 0;
+    const SeriesState &state = states[key(timestepId, productId, type) + (max ? 1 : 0)];
+    std::uint32_t next = timestepId + 1;
+    switch (model) {
+        case PredictionModel::ewma:
+            return state.ewma.observations == 0 ? 0 : Ewma::forecast(state.ewma, next);
+        case PredictionModel::holt:
+            return state.holt.observations == 0 ? 0 : Holt::forecast(state.holt, next);
+        case PredictionModel::linear: {
+            // the window ends at this time step; the state just before it is subtracted
+            LinearTrend::State before;
+            if (timestepId >= LinearTrend::window)
+                before = states[key(timestepId - LinearTrend::window, productId, type) + (max ? 1 : 0)].linear;
+            return LinearTrend::forecast(state.linear, before, next);
+        }
+        case PredictionModel::mean:
+            break;
+    }
+    return 0;
+}
+
+// The states by their capacity
+std::size_t PredictionTable::memoryUsage() const {
+    return states.capacity() * sizeof(SeriesState);
+}
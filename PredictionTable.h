@@ -0,0 +1,161 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_PREDICTIONTABLE_H
+#define ADVISORBOT_PREDICTIONTABLE_H
+
+// include necessary standard C++ libraries and header files
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "AggregateTable.h"
+#include "OrderBookEntry.h"
+
+// Prediction models for the per time step minimum or maximum of one product and order type. Each model keeps a
+// small State that update() moves forward by one time step in constant time, and forecast() turns into the
+// predicted value for a later time step. Time steps without orders are skipped, as in the averages.
+// The models are plain structs with the same shape, like the ReducePolicies, so adding one means adding a
+// struct here and a case in PredictionTable.
+
+// Exponentially weighted moving average: every new value moves the level a fixed fraction of the way towards it.
+struct Ewma {
+    static constexpr double alpha = 0.3;
+
+    struct State {
+        double level = 0;
+        std::uint64_t observations = 0;
+    };
+
+    static void update(State &state, double value, std::uint32_t) {
+        state.level = state.observations == 0 ? value : state.level + alpha * (value - state.level);
+        ++state.observations;
+    }
+
+    // The level is the forecast for every later time step.
+    static double forecast(const State &state, std::uint32_t) { return state.level; }
+};
+
+// Holt's linear smoothing: an exponentially smoothed level and an exponentially smoothed trend per time step.
+struct Holt {
+    static constexpr double alpha = 0.5;
+    static constexpr double beta = 0.3;
+
+    struct State {
+        double level = 0;
+        double trend = 0;
+        // time step of the last value, so that the trend is per time step even across steps without orders
+        std::uint32_t lastTimestep = 0;
+        std::uint64_t observations = 0;
+    };
+
+    static void update(State &state, double value, std::uint32_t timestep) {
+        if (state.observations == 0) {
+            state.level = value;
+            state.trend = 0;
+        } else {
+            double steps = timestep > state.lastTimestep ? (double) (timestep - state.lastTimestep) : 1.0;
+            double previous = state.level;
+            state.level = alpha * value + (1 - alpha) * (state.level + state.trend * steps);
+            state.trend = beta * (state.level - previous) / steps + (1 - beta) * state.trend;
+        }
+        state.lastTimestep = timestep;
+        ++state.observations;
+    }
+
+    // The level carried forward along the trend.
+    static double forecast(const State &state, std::uint32_t timestep) {
+        double steps = timestep > state.lastTimestep ? (double) (timestep - state.lastTimestep) : 1.0;
+        return state.level + state.trend * steps;
+    }
+};
+
+// Least-squares line through the values of the last 'window' time steps, continued to the next one. The state
+// holds running sums since the first time step, so the sums of any window are the difference of two states,
+// and the line is fitted in constant time however long the window is.
+struct LinearTrend {
+    static const std::uint32_t window = 20;
+
+    struct State {
+        double n = 0;
+        double x = 0;
+        double xx = 0;
+        double y = 0;
+        double xy = 0;
+    };
+
+    static void update(State &state, double value, std::uint32_t timestep) {
+        double x = (double) timestep;
+        state.n += 1;
+        state.x += x;
+        state.xx += x * x;
+        state.y += value;
+        state.xy += x * value;
+    }
+
+    // Fit the values between the state at the start of the window ('before', excluded) and the latest one.
+    static double forecast(const State &latest, const State &before, std::uint32_t timestep) {
+        double n = latest.n - before.n;
+        if (n < 1)
+            return 0;
+        double meanX = (latest.x - before.x) / n;
+        double meanY = (latest.y - before.y) / n;
+        double sxx = (latest.xx - before.xx) - n * meanX * meanX;
+        double sxy = (latest.xy - before.xy) - n * meanX * meanY;
+        // one value, or all at the same time step, give a flat line
+        double slope = sxx > 0 ? sxy / sxx : 0;
+        return meanY + slope * ((double) timestep - meanX);
+    }
+};
+
+// The models predict can use; mean is the average of every time step so far, answered from the AggregateTable.
+enum class PredictionModel {
+    mean,
+    ewma,
+    linear,
+    holt
+};
+
+// Per time step model states of the minimum and maximum of every (product, order type), laid out like the
+// AggregateTable they are computed from. The state of a time step already includes its own value, so a forecast
+// from it is for the time step after it; as rows are appended only the states from the first changed time step
+// on are redone.
+class PredictionTable {
+    public:
+        // Turn a model name ("mean", "ewma", "linear", "holt") into its model. Returns false for anything else.
+        static bool parseModel(const std::string &name, PredictionModel &model);
+
+        // Return the names of the models, separated by '/'.
+        static std::string modelNames();
+
+        // Discard everything and compute the states of every time step of a table of the given number of products.
+        void build(const AggregateTable &aggregates, std::size_t productCount);
+
+        // Bring the states up to date after the table was extended, redoing them from 'fromTimestep' on. If the
+        // number of products changed, everything is computed again.
+        void update(const AggregateTable &aggregates, std::size_t productCount, std::size_t fromTimestep);
+
+        // Predict the minimum (max == false) or maximum of one product and order type for the time step after
+        // 'timestepId' with an incremental model (not mean). Returns 0 if there was nothing to learn from.
+        double forecast(PredictionModel model, std::uint32_t productId, OrderBookType type, bool max,
+                        std::uint32_t timestepId) const;
+
+        // Return how many bytes the states take up.
+        std::size_t memoryUsage() const;
+
+    private:
+        // The states of every model for one series of values.
+        struct SeriesState {
+            Ewma::State ewma;
+            Holt::State holt;
+            LinearTrend::State linear;
+        };
+
+        // Position of the states of a (time step, product, order type) in 'states'; the minimum comes first.
+        std::size_t key(std::size_t timestep, std::size_t productId, OrderBookType type) const;
+
+        std::vector<SeriesState> states;
+        std::size_t productCount = 0;
+        std::size_t timestampCount = 0;
+};
+
+#endif //ADVISORBOT_PREDICTIONTABLE_H
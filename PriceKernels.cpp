@@ -0,0 +1,407 @@
+// include necessary C++ libraries and header files
+#include <cmath>
+#include <cstddef>
+#include "PriceKernels.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ADVISORBOT_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    // Kernels work on raw pointers so that every instruction set shares one signature.
+    using ReduceKernel = double (*)(const double *, std::size_t);
+    using MinMaxSumKernel = MinMaxSum (*)(const double *, std::size_t);
+    using VolumeNotionalKernel = VolumeNotional (*)(const double *, const double *, std::size_t);
+
+    // ---- portable kernels: four independent accumulators give the compiler room to pipeline or vectorise
+
+    double minPortableRaw(const double *p, std::size_t n) {
+        double m0 = p[0], m1 = p[0], m2 = p[0], m3 = p[0];
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            m0 = p[i] < m0 ? p[i] : m0;
+            m1 = p[i + 1] < m1 ? p[i + 1] : m1;
+            m2 = p[i + 2] < m2 ? p[i + 2] : m2;
+            m3 = p[i + 3] < m3 ? p[i + 3] : m3;
+        }
+        for (; i < n; ++i) m0 = p[i] < m0 ? p[i] : m0;
+        m0 = m1 < m0 ? m1 : m0;
+        m2 = m3 < m2 ? m3 : m2;
+        return m2 < m0 ? m2 : m0;
+    }
+
+    double maxPortableRaw(const double *p, std::size_t n) {
+        double m0 = p[0], m1 = p[0], m2 = p[0], m3 = p[0];
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            m0 = p[i] > m0 ? p[i] : m0;
+            m1 = p[i + 1] > m1 ? p[i + 1] : m1;
+            m2 = p[i + 2] > m2 ? p[i + 2] : m2;
+            m3 = p[i + 3] > m3 ? p[i + 3] : m3;
+        }
+        for (; i < n; ++i) m0 = p[i] > m0 ? p[i] : m0;
+        m0 = m1 > m0 ? m1 : m0;
+        m2 = m3 > m2 ? m3 : m2;
+        return m2 > m0 ? m2 : m0;
+    }
+
+    double sumPortableRaw(const double *p, std::size_t n) {
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            s0 += p[i];
+            s1 += p[i + 1];
+            s2 += p[i + 2];
+            s3 += p[i + 3];
+        }
+        for (; i < n; ++i) s0 += p[i];
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    // One pass with four lanes of each accumulator; the sum lanes are combined like sumPortableRaw's
+    MinMaxSum minMaxSumPortableRaw(const double *p, std::size_t n) {
+        double lo0 = p[0], lo1 = p[0], lo2 = p[0], lo3 = p[0];
+        double hi0 = p[0], hi1 = p[0], hi2 = p[0], hi3 = p[0];
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            lo0 = p[i] < lo0 ? p[i] : lo0;
+            lo1 = p[i + 1] < lo1 ? p[i + 1] : lo1;
+            lo2 = p[i + 2] < lo2 ? p[i + 2] : lo2;
+            lo3 = p[i + 3] < lo3 ? p[i + 3] : lo3;
+            hi0 = p[i] > hi0 ? p[i] : hi0;
+            hi1 = p[i + 1] > hi1 ? p[i + 1] : hi1;
+            hi2 = p[i + 2] > hi2 ? p[i + 2] : hi2;
+            hi3 = p[i + 3] > hi3 ? p[i + 3] : hi3;
+            s0 += p[i];
+            s1 += p[i + 1];
+            s2 += p[i + 2];
+            s3 += p[i + 3];
+        }
+        for (; i < n; ++i) {
+            lo0 = p[i] < lo0 ? p[i] : lo0;
+            hi0 = p[i] > hi0 ? p[i] : hi0;
+            s0 += p[i];
+        }
+        lo0 = lo1 < lo0 ? lo1 : lo0;
+        lo2 = lo3 < lo2 ? lo3 : lo2;
+        hi0 = hi1 > hi0 ? hi1 : hi0;
+        hi2 = hi3 > hi2 ? hi3 : hi2;
+        return {lo2 < lo0 ? lo2 : lo0, hi2 > hi0 ? hi2 : hi0, (s0 + s1) + (s2 + s3)};
+    }
+
+    VolumeNotional volumeNotionalPortableRaw(const double *p, const double *a, std::size_t n) {
+        double v0 = 0, v1 = 0, n0 = 0, n1 = 0;
+        std::size_t i = 0;
+        for (; i + 2 <= n; i += 2) {
+            v0 += a[i];
+            v1 += a[i + 1];
+            n0 += p[i] * a[i];
+            n1 += p[i + 1] * a[i + 1];
+        }
+        for (; i < n; ++i) {
+            v0 += a[i];
+            n0 += p[i] * a[i];
+        }
+        return {v0 + v1, n0 + n1};
+    }
+
+#ifdef ADVISORBOT_X86_KERNELS
+    // ---- AVX2 kernels: two 4-wide accumulators, so 8 prices per iteration
+
+    __attribute__((target("avx2"))) double horizontalMin(__m256d v) {
+        double lanes[4];
+        _mm256_storeu_pd(lanes, v);
+        double a = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+        double b = lanes[2] < lanes[3] ? lanes[2] : lanes[3];
+        return a < b ? a : b;
+    }
+
+    __attribute__((target("avx2"))) double horizontalMax(__m256d v) {
+        double lanes[4];
+        _mm256_storeu_pd(lanes, v);
+        double a = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+        double b = lanes[2] > lanes[3] ? lanes[2] : lanes[3];
+        return a > b ? a : b;
+    }
+
+    __attribute__((target("avx2"))) double horizontalSum(__m256d v) {
+        double lanes[4];
+        _mm256_storeu_pd(lanes, v);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    __attribute__((target("avx2"))) double minAvx2(const double *p, std::size_t n) {
+        __m256d m0 = _mm256_set1_pd(p[0]), m1 = m0;
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            m0 = _mm256_min_pd(m0, _mm256_loadu_pd(p + i));
+            m1 = _mm256_min_pd(m1, _mm256_loadu_pd(p + i + 4));
+        }
+        double m = horizontalMin(_mm256_min_pd(m0, m1));
+        for (; i < n; ++i) m = p[i] < m ? p[i] : m;
+        return m;
+    }
+
+    __attribute__((target("avx2"))) double maxAvx2(const double *p, std::size_t n) {
+        __m256d m0 = _mm256_set1_pd(p[0]), m1 = m0;
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            m0 = _mm256_max_pd(m0, _mm256_loadu_pd(p + i));
+            m1 = _mm256_max_pd(m1, _mm256_loadu_pd(p + i + 4));
+        }
+        double m = horizontalMax(_mm256_max_pd(m0, m1));
+        for (; i < n; ++i) m = p[i] > m ? p[i] : m;
+        return m;
+    }
+
+    __attribute__((target("avx2"))) double sumAvx2(const double *p, std::size_t n) {
+        __m256d s0 = _mm256_setzero_pd(), s1 = s0;
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            s0 = _mm256_add_pd(s0, _mm256_loadu_pd(p + i));
+            s1 = _mm256_add_pd(s1, _mm256_loadu_pd(p + i + 4));
+        }
+        double s = horizontalSum(_mm256_add_pd(s0, s1));
+        for (; i < n; ++i) s += p[i];
+        return s;
+    }
+
+    __attribute__((target("avx2"))) MinMaxSum minMaxSumAvx2(const double *p, std::size_t n) {
+        __m256d lo = _mm256_set1_pd(p[0]), hi = lo, s = _mm256_setzero_pd();
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d v = _mm256_loadu_pd(p + i);
+            lo = _mm256_min_pd(lo, v);
+            hi = _mm256_max_pd(hi, v);
+            s = _mm256_add_pd(s, v);
+        }
+        MinMaxSum r{horizontalMin(lo), horizontalMax(hi), horizontalSum(s)};
+        for (; i < n; ++i) {
+            r.min = p[i] < r.min ? p[i] : r.min;
+            r.max = p[i] > r.max ? p[i] : r.max;
+            r.sum += p[i];
+        }
+        return r;
+    }
+
+    // multiply and add separately rather than fused, so that every instruction set rounds the products alike
+    __attribute__((target("avx2"))) VolumeNotional volumeNotionalAvx2(const double *p, const double *a, std::size_t n) {
+        __m256d v = _mm256_setzero_pd(), t = v;
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m256d amounts = _mm256_loadu_pd(a + i);
+            v = _mm256_add_pd(v, amounts);
+            t = _mm256_add_pd(t, _mm256_mul_pd(_mm256_loadu_pd(p + i), amounts));
+        }
+        VolumeNotional r{horizontalSum(v), horizontalSum(t)};
+        for (; i < n; ++i) {
+            r.volume += a[i];
+            r.notional += p[i] * a[i];
+        }
+        return r;
+    }
+
+    // ---- AVX-512 kernels: two 8-wide accumulators, so 16 prices per iteration
+
+    // GCC's own AVX-512 intrinsics trip its uninitialized-variable warnings once inlined; the warnings are spurious.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+    // The lanes are reduced through memory, which is cheap next to the main loop.
+    __attribute__((target("avx512f"))) double horizontalMin(__m512d v) {
+        double lanes[8];
+        _mm512_storeu_pd(lanes, v);
+        double m = lanes[0];
+        for (const double l: lanes) m = l < m ? l : m;
+        return m;
+    }
+
+    __attribute__((target("avx512f"))) double horizontalMax(__m512d v) {
+        double lanes[8];
+        _mm512_storeu_pd(lanes, v);
+        double m = lanes[0];
+        for (const double l: lanes) m = l > m ? l : m;
+        return m;
+    }
+
+    __attribute__((target("avx512f"))) double horizontalSum(__m512d v) {
+        double lanes[8];
+        _mm512_storeu_pd(lanes, v);
+        return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    }
+
+    __attribute__((target("avx512f"))) double minAvx512(const double *p, std::size_t n) {
+        __m512d m0 = _mm512_set1_pd(p[0]), m1 = m0;
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            m0 = _mm512_min_pd(m0, _mm512_loadu_pd(p + i));
+            m1 = _mm512_min_pd(m1, _mm512_loadu_pd(p + i + 8));
+        }
+        double m = horizontalMin(_mm512_min_pd(m0, m1));
+        for (; i < n; ++i) m = p[i] < m ? p[i] : m;
+        return m;
+    }
+
+    __attribute__((target("avx512f"))) double maxAvx512(const double *p, std::size_t n) {
+        __m512d m0 = _mm512_set1_pd(p[0]), m1 = m0;
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            m0 = _mm512_max_pd(m0, _mm512_loadu_pd(p + i));
+            m1 = _mm512_max_pd(m1, _mm512_loadu_pd(p + i + 8));
+        }
+        double m = horizontalMax(_mm512_max_pd(m0, m1));
+        for (; i < n; ++i) m = p[i] > m ? p[i] : m;
+        return m;
+    }
+
+    __attribute__((target("avx512f"))) double sumAvx512(const double *p, std::size_t n) {
+        __m512d s0 = _mm512_setzero_pd(), s1 = s0;
+        std::size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            s0 = _mm512_add_pd(s0, _mm512_loadu_pd(p + i));
+            s1 = _mm512_add_pd(s1, _mm512_loadu_pd(p + i + 8));
+        }
+        double s = horizontalSum(_mm512_add_pd(s0, s1));
+        for (; i < n; ++i) s += p[i];
+        return s;
+    }
+
+    __attribute__((target("avx512f"))) MinMaxSum minMaxSumAvx512(const double *p, std::size_t n) {
+        __m512d lo = _mm512_set1_pd(p[0]), hi = lo, s = _mm512_setzero_pd();
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512d v = _mm512_loadu_pd(p + i);
+            lo = _mm512_min_pd(lo, v);
+            hi = _mm512_max_pd(hi, v);
+            s = _mm512_add_pd(s, v);
+        }
+        MinMaxSum r{horizontalMin(lo), horizontalMax(hi), horizontalSum(s)};
+        for (; i < n; ++i) {
+            r.min = p[i] < r.min ? p[i] : r.min;
+            r.max = p[i] > r.max ? p[i] : r.max;
+            r.sum += p[i];
+        }
+        return r;
+    }
+
+    __attribute__((target("avx512f"))) VolumeNotional volumeNotionalAvx512(const double *p, const double *a,
+                                                                          std::size_t n) {
+        __m512d v = _mm512_setzero_pd(), t = v;
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m512d amounts = _mm512_loadu_pd(a + i);
+            v = _mm512_add_pd(v, amounts);
+            t = _mm512_add_pd(t, _mm512_mul_pd(_mm512_loadu_pd(p + i), amounts));
+        }
+        VolumeNotional r{horizontalSum(v), horizontalSum(t)};
+        for (; i < n; ++i) {
+            r.volume += a[i];
+            r.notional += p[i] * a[i];
+        }
+        return r;
+    }
+#pragma GCC diagnostic pop
+#endif
+
+    // The kernels chosen for this CPU.
+    struct KernelSet {
+        ReduceKernel min;
+        ReduceKernel max;
+        ReduceKernel sum;
+        MinMaxSumKernel minMaxSum;
+        VolumeNotionalKernel volumeNotional;
+        const char *name;
+    };
+
+    // Pick the widest instruction set the CPU supports.
+    KernelSet selectKernels() {
+#ifdef ADVISORBOT_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return {minAvx512, maxAvx512, sumAvx512, minMaxSumAvx512, volumeNotionalAvx512, "avx512"};
+        if (__builtin_cpu_supports("avx2"))
+            return {minAvx2, maxAvx2, sumAvx2, minMaxSumAvx2, volumeNotionalAvx2, "avx2"};
+#endif
+        return {minPortableRaw, maxPortableRaw, sumPortableRaw, minMaxSumPortableRaw, volumeNotionalPortableRaw, "portable"};
+    }
+
+    // The selection happens once, the first time a kernel is used.
+    const KernelSet &kernels() {
+        static const KernelSet selected = selectKernels();
+        return selected;
+    }
+
+    // Pairwise summation: split in halves until a block is small enough to add up directly.
+    double sumPairwiseRaw(const double *p, std::size_t n) {
+        if (n <= 256)
+            return kernels().sum(p, n);
+        std::size_t half = n / 2;
+        return sumPairwiseRaw(p, half) + sumPairwiseRaw(p + half, n - half);
+    }
+}
+
+double PriceKernels::min(ColumnSpan<double> prices) {
+    return kernels().min(prices.data(), prices.size());
+}
+
+double PriceKernels::max(ColumnSpan<double> prices) {
+    return kernels().max(prices.data(), prices.size());
+}
+
+double PriceKernels::sum(ColumnSpan<double> prices) {
+    return prices.empty() ? 0 : kernels().sum(prices.data(), prices.size());
+}
+
+MinMaxSum PriceKernels::minMaxSum(ColumnSpan<double> prices) {
+    return kernels().minMaxSum(prices.data(), prices.size());
+}
+
+VolumeNotional PriceKernels::volumeNotional(ColumnSpan<double> prices, ColumnSpan<double> amounts) {
+    return prices.empty() ? VolumeNotional{0, 0} : kernels().volumeNotional(prices.data(), amounts.data(), prices.size());
+}
+
+double PriceKernels::sumPairwise(ColumnSpan<double> prices) {
+    return prices.empty() ? 0 : sumPairwiseRaw(prices.data(), prices.size());
+}
+
+// Neumaier's variant of Kahan summation also handles terms larger than the running sum.
+double PriceKernels::sumKahan(ColumnSpan<double> prices) {
+    double sum = 0;
+    double compensation = 0;
+    for (const double p: prices) {
+        double t = sum + p;
+        if (std::fabs(sum) >= std::fabs(p))
+            compensation += (sum - t) + p;
+        else
+            compensation += (p - t) + sum;
+        sum = t;
+    }
+    return sum + compensation;
+}
+
+std::string PriceKernels::instructionSet() {
+    return kernels().name;
+}
+
+double PriceKernels::minPortable(ColumnSpan<double> prices) {
+    return minPortableRaw(prices.data(), prices.size());
+}
+
+double PriceKernels::maxPortable(ColumnSpan<double> prices) {
+    return maxPortableRaw(prices.data(), prices.size());
+}
+
+double PriceKernels::sumPortable(ColumnSpan<double> prices) {
+    return prices.empty() ? 0 : sumPortableRaw(prices.data(), prices.size());
+}
+
+MinMaxSum PriceKernels::minMaxSumPortable(ColumnSpan<double> prices) {
+    return minMaxSumPortableRaw(prices.data(), prices.size());
+}
+
+VolumeNotional PriceKernels::volumeNotionalPortable(ColumnSpan<double> prices, ColumnSpan<double> amounts) {
+    return volumeNotionalPortableRaw(prices.data(), amounts.data(), prices.size());
+}
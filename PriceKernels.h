@@ -0,0 +1,61 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_PRICEKERNELS_H
+#define ADVISORBOT_PRICEKERNELS_H
+
+// include necessary standard C++ libraries and header files
+#include <string>
+#include "ColumnSpan.h"
+
+// Minimum, maximum and sum of a run of prices, computed in one pass.
+struct MinMaxSum {
+    double min;
+    double max;
+    double sum;
+};
+
+// Total amount and total price times amount of a run of orders, computed in one pass.
+struct VolumeNotional {
+    double volume;
+    double notional;
+};
+
+// Reduction kernels over contiguous runs of prices. On x86-64 the AVX-512 or AVX2 version of each kernel is
+// picked at startup according to what the CPU supports; everywhere else a portable version is used.
+// All kernels expect a non-empty span, callers decide what an empty span means.
+class PriceKernels {
+    public:
+        // Smallest price.
+        static double min(ColumnSpan<double> prices);
+
+        // Largest price.
+        static double max(ColumnSpan<double> prices);
+
+        // Sum of the prices, accumulated in several independent lanes.
+        static double sum(ColumnSpan<double> prices);
+
+        // Minimum, maximum and sum in a single pass over the prices.
+        static MinMaxSum minMaxSum(ColumnSpan<double> prices);
+
+        // Sum of the amounts and of price times amount in a single pass over both columns, which must be
+        // equally long. An empty run gives zeros.
+        static VolumeNotional volumeNotional(ColumnSpan<double> prices, ColumnSpan<double> amounts);
+
+        // Sum of the prices by pairwise (cascade) summation: the error grows with log(n) instead of n.
+        static double sumPairwise(ColumnSpan<double> prices);
+
+        // Sum of the prices with Kahan-Babuska (Neumaier) compensation: the error does not grow with n.
+        static double sumKahan(ColumnSpan<double> prices);
+
+        // Name of the instruction set the dispatched kernels use ("avx512", "avx2" or "portable").
+        static std::string instructionSet();
+
+        // The portable kernels, always available, e.g. to compare against in benchmarks.
+        static double minPortable(ColumnSpan<double> prices);
+        static double maxPortable(ColumnSpan<double> prices);
+        static double sumPortable(ColumnSpan<double> prices);
+        static MinMaxSum minMaxSumPortable(ColumnSpan<double> prices);
+        static VolumeNotional volumeNotionalPortable(ColumnSpan<double> prices, ColumnSpan<double> amounts);
+};
+
+#endif //ADVISORBOT_PRICEKERNELS_H
@@ -0,0 +1,111 @@
+// include necessary C++ libraries and header files
+#include <algorithm>
+#include "PriceLadder.h"
+#include "Metrics.h"
+
+// Sort the orders of every bucket of the time step by price and merge equal prices into one level
+TimestepLadders::TimestepLadders(const OrderStore &store, const OrderIndex &index, std::uint32_t timestampId) {
+    std::size_t productCount = store.products.size();
+    starts.reserve(productCount * OrderIndex::orderTypeCount + 1);
+    std::vector<PriceLevel> orders;
+    for (std::uint32_t p = 0; p < productCount; ++p) {
+        for (std::size_t o = 0; o < OrderIndex::orderTypeCount; ++o) {
+            OrderBookType type = static_cast<OrderBookType>(o);
+            starts.push_back(static_cast<std::uint32_t>(levelData.size()));
+
+            // the orders of the bucket are one contiguous range of the columns
+            std::pair<std::size_t, std::size_t> rows = index.bucket(timestampId, p, type);
+            orders.clear();
+            for (std::size_t i = rows.first; i < rows.second; ++i)
+                orders.push_back({store.prices[i], store.amounts[i], 1});
+
+            // best first: the highest bid, the lowest ask
+            if (type == OrderBookType::bid)
+                std::sort(orders.begin(), orders.end(), [](const PriceLevel &a, const PriceLevel &b) {
+                    return a.price > b.price;
+                });
+            else
+                std::sort(orders.begin(), orders.end(), [](const PriceLevel &a, const PriceLevel &b) {
+                    return a.price < b.price;
+                });
+
+            for (const PriceLevel &order: orders) {
+                if (levelData.size() > starts.back() && levelData.back().price == order.price) {
+                    levelData.back().amount += order.amount;
+                    ++levelData.back().orders;
+                } else {
+                    levelData.push_back(order);
+                }
+            }
+        }
+    }
+    starts.push_back(static_cast<std::uint32_t>(levelData.size()));
+    levelData.shrink_to_fit();
+}
+
+// Look up the run of levels of one product and order type
+ColumnSpan<PriceLevel> TimestepLadders::levels(std::uint32_t productId, OrderBookType type) const {
+    std::size_t k = static_cast<std::size_t>(productId) * OrderIndex::orderTypeCount + static_cast<std::size_t>(type);
+    if (k + 1 >= starts.size() || starts[k] == starts[k + 1])
+        return {};
+    return {levelData.data() + starts[k], starts[k + 1] - starts[k]};
+}
+
+// The levels and the offsets by their capacity
+std::size_t TimestepLadders::memoryUsage() const {
+    return levelData.capacity() * sizeof(PriceLevel) + starts.capacity() * sizeof(std::uint32_t);
+}
+
+// Hand out cached ladders; a miss builds them without holding the lock, so other time steps aren't held up
+std::shared_ptr<const TimestepLadders> LadderCache::get(const OrderStore &store, const OrderIndex &index,
+                                                        std::uint32_t timestampId) {
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        for (Entry &entry: entries) {
+            if (entry.timestampId == timestampId) {
+                entry.lastUsed = ++uses;
+                return entry.ladders;
+            }
+        }
+    }
+
+    std::shared_ptr<const TimestepLadders> built = std::make_shared<TimestepLadders>(store, index, timestampId);
+
+    std::lock_guard<std::mutex> lock{mutex};
+    // another thread may have built the same time step in the meantime
+    for (Entry &entry: entries) {
+        if (entry.timestampId == timestampId) {
+            entry.lastUsed = ++uses;
+            return entry.ladders;
+        }
+    }
+    // make room by dropping the least recently used time step
+    if (entries.size() >= capacity && !entries.empty()) {
+        auto oldest = std::min_element(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            return a.lastUsed < b.lastUsed;
+        });
+        entries.erase(oldest);
+    }
+    entries.push_back({timestampId, built, ++uses});
+    // the lock is already held, so add up the entries here rather than through memoryUsage()
+    std::size_t bytes = entries.capacity() * sizeof(Entry);
+    for (const Entry &entry: entries) bytes += entry.ladders->memoryUsage();
+    Metrics::setMemory("ladders", bytes);
+    return built;
+}
+
+// Drop the entries whose time steps changed
+void LadderCache::clear(std::uint32_t fromTimestep) {
+    std::lock_guard<std::mutex> lock{mutex};
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [fromTimestep](const Entry &entry) {
+        return entry.timestampId >= fromTimestep;
+    }), entries.end());
+}
+
+// Add up the ladders currently cached
+std::size_t LadderCache::memoryUsage() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    std::size_t bytes = entries.capacity() * sizeof(Entry);
+    for (const Entry &entry: entries) bytes += entry.ladders->memoryUsage();
+    return bytes;
+}
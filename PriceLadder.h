@@ -0,0 +1,80 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_PRICELADDER_H
+#define ADVISORBOT_PRICELADDER_H
+
+// include necessary standard C++ libraries and header files
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "ColumnSpan.h"
+#include "OrderStore.h"
+#include "OrderIndex.h"
+#include "OrderBookEntry.h"
+
+// One price level of a ladder: all orders of one side at the same price, merged.
+struct PriceLevel {
+    double price;
+    // total amount of the orders at this price
+    double amount;
+    // number of orders at this price
+    std::uint32_t orders;
+};
+
+// The price ladders of every product and order type at one time step. Each ladder is sorted best price first
+// (highest bid, lowest ask), and all of them share one flat array: the levels of one (product, order type) are a
+// contiguous run of it, found through an offset table laid out like OrderIndex.
+class TimestepLadders {
+    public:
+        // Build the ladders of one time step from the rows of an indexed store.
+        TimestepLadders(const OrderStore &store, const OrderIndex &index, std::uint32_t timestampId);
+
+        // Return the levels of one product and order type, best first; empty if there are no such orders.
+        ColumnSpan<PriceLevel> levels(std::uint32_t productId, OrderBookType type) const;
+
+        // Return how many bytes the ladders take up.
+        std::size_t memoryUsage() const;
+
+    private:
+        std::vector<PriceLevel> levelData;
+        // first level of every (product, order type), followed by the number of levels
+        std::vector<std::uint32_t> starts;
+};
+
+// Builds the ladders of a time step the first time they are asked for and keeps those of the most recently used
+// time steps, so that stepping through the book builds each time step once and every product's ladders come
+// from the same build. Safe to use from several threads at once.
+class LadderCache {
+    public:
+        // Keep the ladders of up to 'capacity' time steps.
+        explicit LadderCache(std::size_t capacity = 64) : capacity(capacity) {
+        }
+
+        // Return the ladders of a time step, building them from the store and index if they aren't cached. The
+        // ladders stay valid for as long as they are held, even once they are dropped from the cache.
+        std::shared_ptr<const TimestepLadders> get(const OrderStore &store, const OrderIndex &index,
+                                                   std::uint32_t timestampId);
+
+        // Drop the ladders of the time steps from 'fromTimestep' on, after their rows changed.
+        void clear(std::uint32_t fromTimestep = 0);
+
+        // Return how many bytes the cached ladders take up.
+        std::size_t memoryUsage() const;
+
+    private:
+        struct Entry {
+            std::uint32_t timestampId;
+            std::shared_ptr<const TimestepLadders> ladders;
+            // value of 'uses' when the entry was last handed out
+            std::uint64_t lastUsed;
+        };
+
+        std::size_t capacity;
+        mutable std::mutex mutex;
+        std::vector<Entry> entries;
+        std::uint64_t uses = 0;
+};
+
+#endif //ADVISORBOT_PRICELADDER_H
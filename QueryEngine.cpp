@@ -0,0 +1,767 @@
+// include necessary C++ libraries and header files
+#include <chrono>
+#include <limits>
+#include <sstream>
+#include <algorithm>
+#include "QueryEngine.h"
+#include "Calculator.h"
+#include "Timestamp.h"
+#include "Metrics.h"
+
+// The commands the engine answers
+bool QueryEngine::isCommand(const std::string &name) {
+    return name == "prod" || name == "min" || name == "max" || name == "avg" || name == "vwap" ||
+           name == "volume" || name == "notional" || name == "best" || name == "spread" || name == "mid" ||
+           name == "depth" || name == "predict" ||
+           name == "time" || name == "step" || name == "list";
+}
+
+// Only step moves the cursor, everything else just reads
+bool QueryEngine::isReadOnly(const std::vector<std::string> &cmd) {
+    return cmd.empty() || cmd[0] != "step";
+}
+
+// Only the commands that look at orders need them indexed and summarised
+LoadStage QueryEngine::requiredStage(const std::vector<std::string> &cmd) {
+    if (!cmd.empty() && (cmd[0] == "prod" || cmd[0] == "time" || cmd[0] == "step"))
+        return LoadStage::dictionaries;
+    return LoadStage::ready;
+}
+
+// The earliest time step of the first day that has any
+QueryCursor QueryEngine::start() const {
+    // a followed file may have no lines yet; the cursor is found again (see OrderBook::findTime) once it has
+    if (book && book->getTimestamps().empty())
+        return {"", 0};
+    if (blocks) {
+        if (blocks->getTimesteps().empty())
+            throw QueryError("No time steps in the dataset");
+        return {Timestamp::format(blocks->getTimesteps().front()), 0};
+    }
+    for (std::size_t d = 0; d < dayCount(); ++d) {
+        std::shared_ptr<const OrderBook> dayBook = day(d);
+        if (!dayBook->getTimestamps().empty())
+            return {dayBook->getEarliestTime(), 0};
+    }
+    throw QueryError("No time steps in the dataset");
+}
+
+// Hand the command to the function answering it
+QueryResult QueryEngine::run(const std::vector<std::string> &cmd, QueryCursor &cursor) const {
+    if (cmd.empty())
+        throw QueryError("Empty input, no command specified");
+
+    // every command is timed under its name (unknown ones all under "invalid"), whether it succeeds or not; a day
+    // of a catalog that can't be read fails the command, not the session
+    static const std::string invalidCommand = "invalid";
+    const std::string &name = isCommand(cmd[0]) ? cmd[0] : invalidCommand;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        QueryResult result = answer(cmd, cursor);
+        Metrics::recordCommand(name, std::chrono::steady_clock::now() - start, false);
+        return result;
+    } catch (const QueryError &) {
+        Metrics::recordCommand(name, std::chrono::steady_clock::now() - start, true);
+        throw;
+    } catch (const std::runtime_error &e) {
+        Metrics::recordCommand(name, std::chrono::steady_clock::now() - start, true);
+        throw QueryError("Couldn't load the data for this command", e.what());
+    }
+}
+
+// Hand the command to the function answering it
+QueryResult QueryEngine::answer(const std::vector<std::string> &cmd, QueryCursor &cursor) const {
+    if (book && book->getTimestamps().empty())
+        throw QueryError("No time steps in the dataset");
+    if (blocks)
+        return answerFromBlocks(cmd, cursor);
+    if (cmd[0] == "prod")
+        return products(cursor);
+    if (cmd[0] == "min" || cmd[0] == "max")
+        return minMax(cmd, cursor);
+    if (cmd[0] == "avg")
+        return average(cmd, cursor);
+    if (cmd[0] == "vwap" || cmd[0] == "volume" || cmd[0] == "notional")
+        return volume(cmd, cursor);
+    if (cmd[0] == "best" || cmd[0] == "spread" || cmd[0] == "mid")
+        return topOfBook(cmd, cursor);
+    if (cmd[0] == "depth")
+        return depth(cmd, cursor);
+    if (cmd[0] == "predict")
+        return predict(cmd, cursor);
+    if (cmd[0] == "list")
+        return list(cmd, cursor);
+
+    QueryResult result;
+    if (cmd[0] == "time") {
+        result.messages.push_back(cursor.first);
+        return result;
+    }
+    if (cmd[0] == "step") {
+        cursor = next(cursor);
+        result.messages.push_back("now at " + cursor.first);
+        return result;
+    }
+    throw QueryError("Invalid command");
+}
+
+// The products, comma separated in words and one per item
+QueryResult QueryEngine::products(const QueryCursor &cursor) const {
+    QueryResult result;
+    std::string line;
+    for (const std::string &p: day(dayOf(cursor))->getProducts()) {
+        // no comma before the first product
+        if (!line.empty()) line += ',';
+        line += p;
+        result.items.push_back(p);
+    }
+    result.messages.push_back(line);
+    return result;
+}
+
+// The minimum or maximum of the current time step, or of a time window
+QueryResult QueryEngine::minMax(const std::vector<std::string> &cmd, const QueryCursor &cursor) const {
+    if (cmd.size() < 3) // must be something like '<min/max> <product> <bid/ask>'
+        throw QueryError("Invalid arguments to 'min'/'max'");
+
+    const std::string &minOrMax = cmd[0];
+    const std::string &product = cmd[1];
+    const std::string &orderTypeName = cmd[2];
+    std::shared_ptr<const OrderBook> dayBook = day(dayOf(cursor));
+    std::uint32_t id = productId(cursor, product);
+    OrderBookType type = orderType(*dayBook, orderTypeName);
+
+    // look up the summary of the orders at the current time, or over the time window given after the order type
+    QueryResult result;
+    PriceAggregate prices;
+    std::pair<std::int64_t, std::int64_t> times;
+    std::string window;
+    if (cmd.size() > 3) {
+        if (!parseTimeWindow(cmd, 3, cursor, times, window))
+            throw QueryError("Invalid argument for <window>");
+        std::size_t timesteps;
+        prices = between(product, type, times.first, times.second, timesteps);
+        // an empty window has nothing to report
+        if (timesteps == 0) {
+            result.messages.push_back("There are no time steps " + window);
+            return result;
+        }
+        window = " " + window;
+    } else {
+        // a product that only earlier days of a catalog have has no orders now
+        if (id != Dictionary::npos)
+            prices = dayBook->getAggregate(type, id, static_cast<std::uint32_t>(cursor.second));
+    }
+
+    // turn min/max into its policy once and reduce the summary with it
+    result.hasValue = true;
+    result.value = Calculator::withMinMaxPolicy(minOrMax, [&](auto policy) {
+        return Calculator::reduce<decltype(policy)>(prices);
+    });
+
+    std::ostringstream text;
+    text << "The " << minOrMax << " " << orderTypeName << " for " << product << window << " is " << result.value;
+    result.messages.push_back(text.str());
+    return result;
+}
+
+// The average over a number of time steps up to the current one, or over a time window
+QueryResult QueryEngine::average(const std::vector<std::string> &cmd, const QueryCursor &cursor) const {
+    if (cmd.size() < 4) // must be something like 'avg <product> <ask/bid> <timesteps/window>'
+        throw QueryError("Invalid arguments to 'avg'");
+
+    const std::string &product = cmd[1];
+    const std::string &orderTypeName = cmd[2];
+
+    // the fourth argument is either a time window or a number of time steps
+    std::pair<std::int64_t, std::int64_t> times;
+    std::string window;
+    bool timeWindow = parseTimeWindow(cmd, 3, cursor, times, window);
+    int timeSteps = 0;
+    if (!timeWindow) {
+        try {
+            timeSteps = std::stoi(cmd[3]);
+        } catch (const std::exception &e) {
+            throw QueryError("Invalid argument for <timesteps>", "Bad value for 'timesteps' when calling 'avg': " + cmd[3]);
+        }
+    }
+
+    std::shared_ptr<const OrderBook> dayBook = day(dayOf(cursor));
+    productId(cursor, product);
+    OrderBookType type = orderType(*dayBook, orderTypeName);
+    QueryResult result;
+    std::ostringstream text;
+
+    // a time window is answered from the summary of all of its time steps together
+    if (timeWindow) {
+        std::size_t timesteps;
+        PriceAggregate prices = between(product, type, times.first, times.second, timesteps);
+        if (timesteps == 0) {
+            result.messages.push_back("There are no time steps " + window);
+            return result;
+        }
+        result.hasValue = true;
+        result.value = Calculator::reduce<Mean>(prices);
+        text << "The average " << product << " " << orderTypeName << " price " << window << " ("
+             << timesteps << " timesteps) was " << result.value;
+        result.messages.push_back(text.str());
+        return result;
+    }
+
+    // a window needs at least one time step
+    if (timeSteps < 1)
+        throw QueryError("Invalid argument for <timesteps>", "Bad value for 'timesteps' when calling 'avg': " + cmd[3]);
+
+    // the window covers the requested number of time steps up to and including the current one; if it goes back
+    // further than the first time step, every time step up to the current one is used
+    std::size_t availableSteps;
+    WindowAggregate totals = lastTimesteps(product, type, cursor, static_cast<std::size_t>(timeSteps), availableSteps);
+    std::size_t timeStepsBack = static_cast<std::size_t>(timeSteps);
+    if (timeStepsBack > availableSteps) {
+        timeStepsBack = availableSteps;
+        result.messages.push_back("number of timesteps (" + std::to_string(timeSteps) + ") is too far back.");
+        result.messages.push_back("current step is " + std::to_string(availableSteps) +
+                                  ", therefore the maximum amount of " + std::to_string(timeStepsBack) +
+                                  " timesteps will be used.");
+    }
+
+    // the totals of the window give the average with every order weighted equally
+    result.hasValue = true;
+    result.value = Mean::window(totals);
+    text << "The average " << product << " " << orderTypeName << " price over the last " << timeStepsBack
+         << " timesteps was " << result.value;
+    result.messages.push_back(text.str());
+    return result;
+}
+
+// The volume-weighted average price, volume or notional of the current time step, of a number of time steps up to
+// the current one, or of a time window
+QueryResult QueryEngine::volume(const std::vector<std::string> &cmd, const QueryCursor &cursor) const {
+    if (cmd.size() < 3) // must be something like '<vwap/volume/notional> <product> <bid/ask>'
+        throw QueryError("Invalid arguments to 'vwap'/'volume'/'notional'");
+
+    const std::string &measure = cmd[0];
+    const std::string &product = cmd[1];
+    const std::string &orderTypeName = cmd[2];
+    std::shared_ptr<const OrderBook> dayBook = day(dayOf(cursor));
+    std::uint32_t id = productId(cursor, product);
+    OrderBookType type = orderType(*dayBook, orderTypeName);
+
+    // the optional fourth argument is either a time window or a number of time steps
+    QueryResult result;
+    std::pair<std::int64_t, std::int64_t> times;
+    std::string window;
+    if (cmd.size() > 3 && parseTimeWindow(cmd, 3, cursor, times, window)) {
+        std::size_t timesteps;
+        PriceAggregate orders = between(product, type, times.first, times.second, timesteps);
+        if (timesteps == 0) {
+            result.messages.push_back("There are no time steps " + window);
+            return result;
+        }
+        result.value = Calculator::withVolumePolicy(measure, [&](auto policy) {
+            return Calculator::reduce<decltype(policy)>(orders);
+        });
+        window = " " + window;
+    } else if (cmd.size() > 3) {
+        int timeSteps = 0;
+        try {
+            timeSteps = std::stoi(cmd[3]);
+        } catch (const std::exception &e) {
+            timeSteps = 0;
+        }
+        if (timeSteps < 1)
+            throw QueryError("Invalid argument for <timesteps/window>",
+                             "Bad value for 'timesteps' when calling '" + measure + "': " + cmd[3]);
+
+        // as with avg, a window reaching back before the first time step covers every time step so far
+        std::size_t availableSteps;
+        WindowAggregate totals = lastTimesteps(product, type, cursor, static_cast<std::size_t>(timeSteps),
+                                               availableSteps);
+        result.value = Calculator::withVolumePolicy(measure, [&](auto policy) {
+            return decltype(policy)::window(totals);
+        });
+        window = " over the last " + std::to_string(availableSteps) + " timesteps";
+    } else if (id != Dictionary::npos) {
+        // a product that only earlier days of a catalog have has no orders now
+        const PriceAggregate &orders = dayBook->getAggregate(type, id, static_cast<std::uint32_t>(cursor.second));
+        result.value = Calculator::withVolumePolicy(measure, [&](auto policy) {
+            return Calculator::reduce<decltype(policy)>(orders);
+        });
+    }
+    result.hasValue = true;
+
+    std::ostringstream text;
+    text << "The " << (measure == "vwap" ? "VWAP" : measure) << " of " << product << " " << orderTypeName << window
+         << " is " << result.value;
+    result.messages.push_back(text.str());
+    return result;
+}
+
+// The best price of one side, or the spread or mid price of one product or of every product, at the current time step
+QueryResult QueryEngine::topOfBook(const std::vector<std::string> &cmd, const QueryCursor &cursor) const {
+    const std::string &measure = cmd[0];
+    if (measure == "best" && cmd.size() < 3) // must be something like 'best <product> <bid/ask>'
+        throw QueryError("Invalid arguments to 'best'");
+
+    std::shared_ptr<const OrderBook> dayBook = day(dayOf(cursor));
+    std::shared_ptr<const TimestepLadders> ladders = dayBook->getLadders(static_cast<std::uint32_t>(cursor.second));
+    QueryResult result;
+    std::ostringstream text;
+
+    if (measure == "best") {
+        const std::string &product = cmd[1];
+        std::uint32_t id = productId(cursor, product);
+        OrderBookType type = orderType(*dayBook, cmd[2]);
+        // a product that only earlier days of a catalog have has no orders now
+        ColumnSpan<PriceLevel> levels = id == Dictionary::npos ? ColumnSpan<PriceLevel>{} : ladders->levels(id, type);
+        if (levels.empty()) {
+            result.messages.push_back("There are no " + cmd[2] + "s for " + product + " in the current time step");
+            return result;
+        }
+        result.hasValue = true;
+        result.value = levels[0].price;
+        text << "The best " << cmd[2] << " for " << product << " is " << result.value << " (" << levels[0].amount
+             << " in " << levels[0].orders << " order" << (levels[0].orders == 1 ? "" : "s") << ")";
+        result.messages.push_back(text.str());
+        return result;
+    }
+
+    // the spread or mid price of one product, false if it doesn't have both bids and asks
+    auto figure = [&](std::uint32_t id, double &value) {
+        if (id == Dictionary::npos)
+            return false;
+        ColumnSpan<PriceLevel> bids = ladders->levels(id, OrderBookType::bid);
+        ColumnSpan<PriceLevel> asks = ladders->levels(id, OrderBookType::ask);
+        if (bids.empty() || asks.empty())
+            return false;
+        value = measure == "spread" ? asks[0].price - bids[0].price : (asks[0].price + bids[0].price) / 2;
+        return true;
+    };
+    std::string name = measure == "mid" ? "mid price" : measure;
+
+    if (cmd.size() > 1) {
+        const std::string &product = cmd[1];
+        if (!figure(productId(cursor, product), result.value)) {
+            result.messages.push_back(product + " needs both bids and asks in the current time step for a " + name);
+            return result;
+        }
+        result.hasValue = true;
+        text << "The " << name << " of " << product << " is " << result.value;
+        result.messages.push_back(text.str());
+        return result;
+    }
+
+    // every product of the day, from the same ladders
+    const std::vector<std::string> &products = dayBook->getProducts();
+    for (std::uint32_t p = 0; p < products.size(); ++p) {
+        double value;
+        if (!figure(p, value))
+            continue;
+        std::ostringstream item;
+        item << products[p] << ": " << value;
+        result.items.push_back(item.str());
+    }
+    if (result.items.empty()) {
+        result.messages.push_back("No product has both bids and asks in the current time step: (" + cursor.first + ").");
+    } else {
+        result.messages.push_back(name + " per product for current time step (" + cursor.first + "):");
+        result.itemsInText = true;
+    }
+    return result;
+}
+
+// The best price levels of one side at the current time step
+QueryResult QueryEngine::depth(const std::vector<std::string> &cmd, const QueryCursor &cursor) const {
+    if (cmd.size() < 3) // must be something like 'depth <product> <bid/ask> [<levels>]'
+        throw QueryError("Invalid arguments to 'depth'");
+
+    const std::string &product = cmd[1];
+    const std::string &orderTypeName = cmd[2];
+    std::size_t count = 5;
+    if (cmd.size() > 3) {
+        int levels = 0;
+        try {
+            levels = std::stoi(cmd[3]);
+        } catch (const std::exception &e) {
+            levels = 0;
+        }
+        if (levels < 1)
+            throw QueryError("Invalid argument for <levels>", "Bad value for 'levels' when calling 'depth': " + cmd[3]);
+        count = static_cast<std::size_t>(levels);
+    }
+
+    std::shared_ptr<const OrderBook> dayBook = day(dayOf(cursor));
+    std::uint32_t id = productId(cursor, product);
+    OrderBookType type = orderType(*dayBook, orderTypeName);
+    std::shared_ptr<const TimestepLadders> ladders = dayBook->getLadders(static_cast<std::uint32_t>(cursor.second));
+    ColumnSpan<PriceLevel> levels = id == Dictionary::npos ? ColumnSpan<PriceLevel>{} : ladders->levels(id, type);
+
+    // one item per level, best first, and the amount they add up to as the value
+    QueryResult result;
+    count = std::min(count, levels.size());
+    double total = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        std::ostringstream item;
+        item << levels[i].price << " | " << levels[i].amount << " | " << levels[i].orders;
+        result.items.push_back(item.str());
+        total += levels[i].amount;
+    }
+
+    if (result.items.empty()) {
+        result.messages.push_back("There are no " + orderTypeName + "s for " + product + " in the current time step");
+        return result;
+    }
+    result.hasValue = true;
+    result.value = total;
+    std::ostringstream text;
+    text << "The top " << count << " " << orderTypeName << " levels for " << product << " (price | amount | orders) hold "
+         << total << " in total:";
+    result.messages.push_back(text.str());
+    result.itemsInText = true;
+    return result;
+}
+
+// The average of the per time step minimum or maximum of every time step so far
+QueryResult QueryEngine::predict(const std::vector<std::string> &cmd, const QueryCursor &cursor) const {
+    if (cmd.size() < 4) // must be something like 'predict <min/max> <product> <bid/ask> [<model>]'
+        throw QueryError("Invalid arguments to 'predict'");
+
+    const std::string &minOrMax = cmd[1];
+    const std::string &product = cmd[2];
+    const std::string &orderTypeName = cmd[3];
+    if (minOrMax != "min" && minOrMax != "max")
+        throw QueryError("Invalid argument for <min/max>");
+    PredictionModel model = PredictionModel::mean;
+    if (cmd.size() > 4 && !PredictionTable::parseModel(cmd[4], model))
+        throw QueryError("Invalid argument for <model>", "Invalid argument for <" + PredictionTable::modelNames() +
+                                                         ">: " + cmd[4]);
+    std::shared_ptr<const OrderBook> dayBook = day(dayOf(cursor));
+    std::uint32_t id = productId(cursor, product);
+    OrderBookType type = orderType(*dayBook, orderTypeName);
+    QueryResult result;
+    result.hasValue = true;
+
+    if (model == PredictionModel::mean) {
+        // read from the totals of every time step so far, with min/max turned into its policy once
+        std::size_t timesteps;
+        WindowAggregate totals = lastTimesteps(product, type, cursor, std::numeric_limits<std::size_t>::max(),
+                                               timesteps);
+        result.value = Calculator::withMinMaxPolicy(minOrMax, [&](auto policy) {
+            return decltype(policy)::window(totals);
+        });
+    } else if (id != Dictionary::npos) {
+        // the incremental models were run up to the current time step when the day was loaded; in a catalog
+        // they start again with every day
+        result.value = dayBook->getPredictions().forecast(model, id, type, minOrMax == "max",
+                                                          static_cast<std::uint32_t>(cursor.second));
+    }
+
+    std::ostringstream text;
+    text << "The predicted " << minOrMax << " " << orderTypeName << " price of " << product
+         << " for the next time step is " << result.value;
+    if (model != PredictionModel::mean)
+        text << " (" << cmd[4] << ")";
+    result.messages.push_back(text.str());
+    return result;
+}
+
+// Every order of one type in the current time step
+QueryResult QueryEngine::list(const std::vector<std::string> &cmd, const QueryCursor &cursor) const {
+    if (cmd.size() < 2)
+        throw QueryError("Invalid argument for list <bid/ask>");
+    const std::string &orderTypeName = cmd[1];
+    std::shared_ptr<const OrderBook> dayBook = day(dayOf(cursor));
+    if (!dayBook->isValidOrderType(orderTypeName))
+        throw QueryError("Invalid argument for list <bid/ask>", "Invalid argument for list <bid/ask>: " + orderTypeName);
+
+    // every product's orders for the current time step are one range of the index
+    OrderBookType type = OrderBookEntry::stringToOrderBookType(orderTypeName);
+    std::uint32_t productCount = static_cast<std::uint32_t>(dayBook->getProducts().size());
+    QueryResult result;
+    for (std::uint32_t p = 0; p < productCount; ++p) {
+        OrderRange orders = dayBook->getOrderRange(type, p, static_cast<std::uint32_t>(cursor.second));
+        for (std::size_t i = 0; i < orders.size(); ++i) {
+            result.items.push_back(orders[i].toString());
+        }
+    }
+
+    if (result.items.empty()) {
+        result.messages.push_back("No " + orderTypeName + "s found for current time step: (" + cursor.first + ").");
+    } else {
+        result.messages.push_back(orderTypeName + "s for current time step (" + cursor.first + "):");
+        result.itemsInText = true;
+    }
+    return result;
+}
+
+// The few commands the blocks can answer without summaries: every order is read from the blocks the zone maps leave
+QueryResult QueryEngine::answerFromBlocks(const std::vector<std::string> &cmd, QueryCursor &cursor) const {
+    QueryResult result;
+    const std::vector<std::int64_t> &timesteps = blocks->getTimesteps();
+    std::int64_t now = timesteps[static_cast<std::size_t>(cursor.second)];
+
+    if (cmd[0] == "prod") {
+        std::string line;
+        for (const std::string &p: blocks->getProducts()) {
+            if (!line.empty()) line += ',';
+            line += p;
+            result.items.push_back(p);
+        }
+        result.messages.push_back(line);
+        return result;
+    }
+    if (cmd[0] == "time") {
+        result.messages.push_back(cursor.first);
+        return result;
+    }
+    if (cmd[0] == "step") {
+        std::size_t t = (static_cast<std::size_t>(cursor.second) + 1) % timesteps.size();
+        cursor = {Timestamp::format(timesteps[t]), static_cast<int>(t)};
+        result.messages.push_back("now at " + cursor.first);
+        return result;
+    }
+
+    // the order type is the second argument of list, the third of min and max
+    auto orderType = [](const std::string &name) {
+        if (name != "bid" && name != "ask")
+            throw QueryError("Invalid argument for <bid/ask>", "Invalid argument for <bid/ask>: " + name);
+        return OrderBookEntry::stringToOrderBookType(name);
+    };
+
+    if (cmd[0] == "list") {
+        if (cmd.size() < 2)
+            throw QueryError("Invalid argument for list <bid/ask>");
+        const std::string &orderTypeName = cmd[1];
+        OrderBookType type = orderType(orderTypeName);
+        const std::vector<std::string> &products = blocks->getProducts();
+        for (const OrderBookEntry &order: blocks->getOrders(type, "", now, now)) {
+            result.items.push_back(cursor.first + " | " + products[order.productId] + " | " + orderTypeName +
+                                   " | " + std::to_string(order.price));
+        }
+        if (result.items.empty()) {
+            result.messages.push_back("No " + orderTypeName + "s found for current time step: (" + cursor.first + ").");
+        } else {
+            result.messages.push_back(orderTypeName + "s for current time step (" + cursor.first + "):");
+            result.itemsInText = true;
+        }
+        return result;
+    }
+
+    if (cmd[0] == "min" || cmd[0] == "max") {
+        if (cmd.size() < 3) // must be something like '<min/max> <product> <bid/ask>'
+            throw QueryError("Invalid arguments to 'min'/'max'");
+        const std::string &product = cmd[1];
+        const std::string &orderTypeName = cmd[2];
+        const std::vector<std::string> &products = blocks->getProducts();
+        if (!std::binary_search(products.begin(), products.end(), product))
+            throw QueryError("Unknown product", "Unknown product: " + product);
+        OrderBookType type = orderType(orderTypeName);
+
+        // the current time step, or the time window given after the order type
+        std::pair<std::int64_t, std::int64_t> times{now, now};
+        std::string window;
+        if (cmd.size() > 3) {
+            if (!parseTimeWindow(cmd, 3, cursor, times, window))
+                throw QueryError("Invalid argument for <window>");
+            std::pair<std::uint32_t, std::uint32_t> ids = blocks->getTimestepsBetween(times.first, times.second);
+            if (ids.first == ids.second) {
+                result.messages.push_back("There are no time steps " + window);
+                return result;
+            }
+            window = " " + window;
+        }
+
+        // like the summaries, a time without orders has a minimum and maximum of 0
+        result.hasValue = true;
+        if (!blocks->getExtreme(type, product, times.first, times.second, cmd[0] == "max", result.value))
+            result.value = 0;
+        std::ostringstream text;
+        text << "The " << cmd[0] << " " << orderTypeName << " for " << product << window << " is " << result.value;
+        result.messages.push_back(text.str());
+        return result;
+    }
+
+    if (isCommand(cmd[0]))
+        throw QueryError("Not available from block storage",
+                         "'" + cmd[0] + "' needs the order book in memory; from block storage only prod, min, max, "
+                                        "list, time and step are answered");
+    throw QueryError("Invalid command");
+}
+
+// The time step after the current one, moving on to the next day (that has any) after the last one of a day
+QueryCursor QueryEngine::next(const QueryCursor &cursor) const {
+    std::size_t d = dayOf(cursor);
+    std::shared_ptr<const OrderBook> dayBook = day(d);
+    // the time steps are numbered in time order, so the next one is found from the index of the current one
+    if (dayCount() == 1 || static_cast<std::size_t>(cursor.second) + 1 < dayBook->getTimestamps().size())
+        return dayBook->getNextTime(static_cast<std::uint32_t>(cursor.second));
+
+    // after the last day comes the first one again
+    for (std::size_t i = 1; i <= dayCount(); ++i) {
+        std::shared_ptr<const OrderBook> nextBook = day((d + i) % dayCount());
+        if (!nextBook->getTimestamps().empty())
+            return {nextBook->getEarliestTime(), 0};
+    }
+    return cursor;
+}
+
+std::size_t QueryEngine::dayCount() const {
+    return catalog ? catalog->size() : 1;
+}
+
+// Without a catalog the one book is shared without being owned
+std::shared_ptr<const OrderBook> QueryEngine::day(std::size_t day) const {
+    if (catalog)
+        return catalog->day(day);
+    return std::shared_ptr<const OrderBook>(std::shared_ptr<const OrderBook>(), book);
+}
+
+// The day of the catalog that the cursor's time falls on
+std::size_t QueryEngine::dayOf(const QueryCursor &cursor) const {
+    std::int64_t micros;
+    if (!catalog || !Timestamp::parse(cursor.first, micros))
+        return 0;
+    return catalog->dayOf(micros);
+}
+
+// A day of a catalog ends where the next one starts; the last one (and the one book) never ends
+std::pair<std::int64_t, std::int64_t> QueryEngine::dayBounds(std::size_t day) const {
+    std::int64_t first = std::numeric_limits<std::int64_t>::min();
+    std::int64_t last = std::numeric_limits<std::int64_t>::max();
+    if (catalog) {
+        if (day > 0)
+            first = catalog->dayStart(day);
+        if (day + 1 < catalog->size())
+            last = catalog->dayStart(day + 1) - 1;
+    }
+    return {first, last};
+}
+
+// Resolve a product name, rejecting products that no day so far has
+std::uint32_t QueryEngine::productId(const QueryCursor &cursor, const std::string &product) const {
+    std::size_t d = dayOf(cursor);
+    std::uint32_t id = day(d)->getProductId(product);
+    if (id != Dictionary::npos)
+        return id;
+    // earlier days are looked up in the products of the days loaded so far, without loading any of them again
+    if (catalog && catalog->hadProductBefore(d, product))
+        return Dictionary::npos;
+    throw QueryError("Unknown product", "Unknown product: " + product);
+}
+
+// Resolve an order type name, accepting only bid and ask
+OrderBookType QueryEngine::orderType(const OrderBook &dayBook, const std::string &name) const {
+    auto it = dayBook.orderBookTypes.find(name);
+    if (it == dayBook.orderBookTypes.end())
+        throw QueryError("Invalid argument for <bid/ask>", "Invalid argument for <bid/ask>: " + name);
+    return it->second;
+}
+
+// Combine the summaries of the days the times fall on
+PriceAggregate QueryEngine::between(const std::string &product, OrderBookType type, std::int64_t fromMicros,
+                                    std::int64_t toMicros, std::size_t &timesteps) const {
+    PriceAggregate prices;
+    timesteps = 0;
+    if (fromMicros > toMicros)
+        return prices;
+
+    std::size_t firstDay = catalog ? catalog->dayOf(fromMicros) : 0;
+    std::size_t lastDay = catalog ? catalog->dayOf(toMicros) : 0;
+    for (std::size_t d = firstDay; d <= lastDay; ++d) {
+        // only the part of the window on this day
+        std::pair<std::int64_t, std::int64_t> bounds = dayBounds(d);
+        std::shared_ptr<const OrderBook> dayBook = day(d);
+        std::pair<std::uint32_t, std::uint32_t> ids =
+                dayBook->getTimestepsBetween(std::max(fromMicros, bounds.first), std::min(toMicros, bounds.second));
+        timesteps += ids.second - ids.first;
+
+        std::uint32_t id = dayBook->getProductId(product);
+        if (ids.first == ids.second || id == Dictionary::npos)
+            continue;
+        PriceAggregate part = dayBook->getRangeAggregate(type, id, ids.first, ids.second - 1);
+        prices.add(part);
+    }
+    return prices;
+}
+
+// Go back from the cursor day by day; whole earlier days come from their summaries, without loading them again
+WindowAggregate QueryEngine::lastTimesteps(const std::string &product, OrderBookType type, const QueryCursor &cursor,
+                                           std::size_t count, std::size_t &timesteps) const {
+    WindowAggregate totals;
+    std::size_t d = dayOf(cursor);
+    std::size_t last = static_cast<std::size_t>(cursor.second);
+
+    // the current day, up to and including the current time step
+    std::shared_ptr<const OrderBook> dayBook = day(d);
+    timesteps = std::min(count, last + 1);
+    std::uint32_t id = dayBook->getProductId(product);
+    if (id != Dictionary::npos)
+        totals.add(dayBook->getAggregates().window(id, type, static_cast<std::uint32_t>(last + 1 - timesteps),
+                                                   static_cast<std::uint32_t>(last)));
+
+    // then the days before it, latest first
+    while (timesteps < count && d > 0) {
+        --d;
+        std::size_t dayTimesteps = catalog->timesteps(d);
+        std::size_t take = std::min(count - timesteps, dayTimesteps);
+        timesteps += take;
+        if (take == 0)
+            continue;
+        if (take == dayTimesteps) {
+            totals.add(catalog->totals(d, product, type));
+            continue;
+        }
+        // only the end of this day
+        dayBook = day(d);
+        id = dayBook->getProductId(product);
+        if (id != Dictionary::npos)
+            totals.add(dayBook->getAggregates().window(id, type, static_cast<std::uint32_t>(dayTimesteps - take),
+                                                       static_cast<std::uint32_t>(dayTimesteps - 1)));
+    }
+    return totals;
+}
+
+// Turn the window arguments into a time range
+bool QueryEngine::parseTimeWindow(const std::vector<std::string> &cmd, std::size_t first, const QueryCursor &cursor,
+                                  std::pair<std::int64_t, std::int64_t> &window, std::string &description) const {
+    if (cmd.size() <= first)
+        return false;
+
+    // the time of the current time step; windows given as a duration end here
+    std::int64_t now = blocks ? blocks->getTimesteps()[static_cast<std::size_t>(cursor.second)]
+                              : day(dayOf(cursor))->getTimestampMicros(static_cast<std::uint32_t>(cursor.second));
+
+    // a duration such as 5m covers the time steps from that long ago up to the current one
+    std::int64_t duration;
+    if (Timestamp::parseDuration(cmd[first], duration)) {
+        // one that reaches back past the start of the data starts there instead, so that nothing overflows
+        std::int64_t earliest = blocks ? blocks->getTimesteps().front()
+                                       : catalog ? catalog->dayStart(0) : book->getTimestampMicros(0);
+        window = {duration >= now - earliest ? earliest : now - duration, now};
+        description = "over the last " + cmd[first];
+        return true;
+    }
+    if (cmd[first] != "between")
+        return false;
+
+    // each bound is either "<date> <time>" (two tokens) or a time of day on the current date (one token)
+    std::vector<std::string> args(cmd.begin() + first + 1, cmd.end());
+    std::string from, to;
+    if (args.size() == 4) {
+        from = args[0] + " " + args[1];
+        to = args[2] + " " + args[3];
+    } else if (args.size() == 2) {
+        std::string today = cursor.first.substr(0, 11);
+        from = today + args[0];
+        to = today + args[1];
+    } else {
+        throw QueryError("Invalid arguments to 'between', expected between <t1> <t2>");
+    }
+
+    std::int64_t fromMicros, toMicros;
+    if (!Timestamp::parse(from, fromMicros) || !Timestamp::parse(to, toMicros))
+        throw QueryError("Invalid argument for <t1>/<t2>", "Bad time when calling 'between': " + from + " / " + to);
+    window = {fromMicros, toMicros};
+    description = "between " + from + " and " + to;
+    return true;
+}
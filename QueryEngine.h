@@ -0,0 +1,176 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_QUERYENGINE_H
+#define ADVISORBOT_QUERYENGINE_H
+
+// include necessary standard C++ libraries and header files
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+#include "OrderBook.h"
+#include "DayCatalog.h"
+#include "BlockStore.h"
+
+// Where a session is in the dataset: the current timestamp and its time step id.
+using QueryCursor = std::pair<std::string, int>;
+
+// What a session answers from: one order book, a catalog of daily ones, or the column blocks of a file too large
+// for memory. Holding it keeps them alive.
+struct QuerySource {
+    std::shared_ptr<OrderBook> book;
+    std::shared_ptr<DayCatalog> catalog;
+    std::shared_ptr<BlockStore> blocks;
+
+    explicit operator bool() const { return book || catalog || blocks; }
+};
+
+// The answer to one command, both in words and in machine-readable form.
+struct QueryResult {
+    // the answer in words, one line per element, as the interactive bot prints it after its prompt
+    std::vector<std::string> messages;
+
+    // the number min, max, avg, vwap, volume, notional, best, spread, mid, depth and predict answer with
+    bool hasValue = false;
+    double value = 0;
+
+    // list-like answers: the products for prod, the orders for list, the levels for depth, the products' figures for
+    // spread and mid without a product
+    std::vector<std::string> items;
+    // whether the items are part of the answer in words as well, printed one per line after the messages
+    bool itemsInText = false;
+};
+
+// A command that can't be answered. what() is the short reason; detail() is an optional line with the
+// offending input, which the interactive bot prints before the reason.
+class QueryError : public std::invalid_argument {
+    public:
+        explicit QueryError(const std::string &what, std::string _detail = "")
+                : std::invalid_argument(what), detailText(std::move(_detail)) {
+        }
+
+        const std::string &detail() const { return detailText; }
+
+    private:
+        std::string detailText;
+};
+
+// Answers the bot's commands (prod, min, max, avg, vwap, volume, notional, best, spread, mid, depth, predict, time,
+// step, list) against an OrderBook without
+// printing anything, so that the same answers can be shown to a user, written as JSON or CSV, or sent over a
+// connection. The engine keeps no state of its own: every call gets the cursor of its session, so one engine can
+// serve many sessions, and read-only commands can run on several threads at once.
+// Against a DayCatalog the cursor is in the day its timestamp falls on; step moves on to the next day after the
+// last time step of a day, and avg, predict and time windows take in earlier days as far as they reach.
+// Against a BlockStore only prod, min, max, list, time and step are answered, by reading the blocks themselves.
+class QueryEngine {
+    public:
+        explicit QueryEngine(const OrderBook &_book) : book(&_book) {
+        }
+
+        explicit QueryEngine(DayCatalog &_catalog) : catalog(&_catalog) {
+        }
+
+        // Answer from whichever of the two the source holds; the source must outlive the engine.
+        explicit QueryEngine(const QuerySource &source)
+                : book(source.book.get()), catalog(source.catalog.get()), blocks(source.blocks.get()) {
+        }
+
+        // Return the cursor a session starts with: the earliest time step of the (first day's) order book, or
+        // {"", 0} if the one order book has no time steps yet. Throws QueryError if a catalog or block store has none.
+        QueryCursor start() const;
+
+        // Determine whether the word names a command the engine answers.
+        static bool isCommand(const std::string &name);
+
+        // Determine whether a command only reads the order book and the cursor (everything except step).
+        static bool isReadOnly(const std::vector<std::string> &cmd);
+
+        // Return how far an order book must be loaded before it can answer a command: prod, time and step only
+        // need the products and timestamps, the other commands need the index and the summaries too.
+        static LoadStage requiredStage(const std::vector<std::string> &cmd);
+
+        // Answer a tokenised command at the cursor's time step; step moves the cursor.
+        // Throws QueryError if the command or its arguments are invalid.
+        QueryResult run(const std::vector<std::string> &cmd, QueryCursor &cursor) const;
+
+    private:
+        // Answer a command that isn't empty.
+        QueryResult answer(const std::vector<std::string> &cmd, QueryCursor &cursor) const;
+
+        // Answer a command that isn't empty from the block store.
+        QueryResult answerFromBlocks(const std::vector<std::string> &cmd, QueryCursor &cursor) const;
+
+        // prod - list available products
+        QueryResult products(const QueryCursor &cursor) const;
+
+        // min/max <product> <bid/ask> [<window>]
+        QueryResult minMax(const std::vector<std::string> &cmd, const QueryCursor &cursor) const;
+
+        // avg <product> <bid/ask> <timesteps/window>
+        QueryResult average(const std::vector<std::string> &cmd, const QueryCursor &cursor) const;
+
+        // vwap/volume/notional <product> <bid/ask> [<timesteps/window>]
+        QueryResult volume(const std::vector<std::string> &cmd, const QueryCursor &cursor) const;
+
+        // best <product> <bid/ask>, spread/mid [<product>] - from the price ladders of the current time step;
+        // spread and mid without a product answer for every product
+        QueryResult topOfBook(const std::vector<std::string> &cmd, const QueryCursor &cursor) const;
+
+        // depth <product> <bid/ask> [<levels>] - the best price levels of the current time step
+        QueryResult depth(const std::vector<std::string> &cmd, const QueryCursor &cursor) const;
+
+        // predict <min/max> <product> <bid/ask> [<model>]
+        QueryResult predict(const std::vector<std::string> &cmd, const QueryCursor &cursor) const;
+
+        // list <bid/ask> - the orders of the current time step
+        QueryResult list(const std::vector<std::string> &cmd, const QueryCursor &cursor) const;
+
+        // step - the cursor of the time step after the current one
+        QueryCursor next(const QueryCursor &cursor) const;
+
+        // Return the number of days: those of the catalog, or the one order book.
+        std::size_t dayCount() const;
+
+        // Return the order book of a day. Throws QueryError if the day can't be loaded.
+        std::shared_ptr<const OrderBook> day(std::size_t day) const;
+
+        // Return the day the cursor is in.
+        std::size_t dayOf(const QueryCursor &cursor) const;
+
+        // Return the first and last time (in microseconds since the epoch) a day covers.
+        std::pair<std::int64_t, std::int64_t> dayBounds(std::size_t day) const;
+
+        // Return the id of a product in the cursor's day, or Dictionary::npos if only earlier days of a catalog
+        // have it. Throws QueryError if no day up to the cursor's has it.
+        std::uint32_t productId(const QueryCursor &cursor, const std::string &product) const;
+
+        // Return the order type named by "bid" or "ask"; throws QueryError otherwise.
+        OrderBookType orderType(const OrderBook &dayBook, const std::string &name) const;
+
+        // Return the summary of all orders of a product and order type between two times (inclusive, in
+        // microseconds since the epoch), across days, together with the number of time steps in between.
+        PriceAggregate between(const std::string &product, OrderBookType type, std::int64_t fromMicros,
+                               std::int64_t toMicros, std::size_t &timesteps) const;
+
+        // Return the totals of a product and order type over the last 'count' time steps up to and including the
+        // cursor's, going back into earlier days as needed, together with the number of time steps there were.
+        WindowAggregate lastTimesteps(const std::string &product, OrderBookType type, const QueryCursor &cursor,
+                                      std::size_t count, std::size_t &timesteps) const;
+
+        // Read a time window from the arguments starting at cmd[first]: a duration that ends at the current time
+        // ("5m") or "between <t1> <t2>", where each time is a full timestamp or a time of day on the current date.
+        // Resolves it to the times [from, to] in microseconds and describes it for output. Returns false if
+        // cmd[first] is not a time window; throws QueryError if it is a malformed one.
+        bool parseTimeWindow(const std::vector<std::string> &cmd, std::size_t first, const QueryCursor &cursor,
+                             std::pair<std::int64_t, std::int64_t> &window, std::string &description) const;
+
+        // exactly one of the three is set
+        const OrderBook *book = nullptr;
+        DayCatalog *catalog = nullptr;
+        const BlockStore *blocks = nullptr;
+};
+
+#endif //ADVISORBOT_QUERYENGINE_H
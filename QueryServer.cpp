@@ -0,0 +1,391 @@
+// include necessary C++ libraries and header files
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <thread>
+#include <iterator>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "QueryServer.h"
+#include "CSVReader.h"
+
+// the longest command line a client may send, and how much unsent output a client may have before the server stops
+// reading its commands
+static const std::size_t maxLineLength = 64 * 1024;
+static const std::size_t maxBacklog = 1024 * 1024;
+// the most lines one job answers
+static const std::size_t maxJobLines = 256;
+// how long a followed data file may go without being looked at while jobs keep running
+static const std::chrono::milliseconds followInterval{50};
+
+// set by SIGINT and SIGTERM to end run()
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+    stopRequested = 1;
+}
+
+// The pool's helper threads answer the jobs and the thread of the loop doesn't, so a pool of one more thread than
+// requested has as many threads answering as requested
+static unsigned poolSize(unsigned threads) {
+    return (threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads) + 1;
+}
+
+QueryServer::QueryServer(const QuerySource &_source, const ServerOptions &_options)
+        : source(_source), options(_options), engine(_source), startCursor(engine.start()),
+          pool(poolSize(_options.threads)) {
+    listen();
+}
+
+QueryServer::~QueryServer() {
+    // no job may still be answering a connection that is closed
+    pool.wait();
+    for (auto &entry: connections) {
+        entry.second.answering = false;
+    }
+    while (!connections.empty()) {
+        close(connections.begin()->first);
+    }
+    if (listener >= 0)
+        ::close(listener);
+    if (epoll >= 0)
+        ::close(epoll);
+    if (completions >= 0)
+        ::close(completions);
+    if (!socketPath.empty())
+        ::unlink(socketPath.c_str());
+}
+
+void QueryServer::listen() {
+    // the address is "unix:<path>" or "tcp:<port>"
+    const std::string &address = options.address;
+    sockaddr_un unixAddress{};
+    sockaddr_in tcpAddress{};
+    sockaddr *bound = nullptr;
+    socklen_t boundLength = 0;
+    if (address.rfind("unix:", 0) == 0 && address.size() > 5 && address.size() - 5 < sizeof(unixAddress.sun_path)) {
+        socketPath = address.substr(5);
+        unixAddress.sun_family = AF_UNIX;
+        std::strcpy(unixAddress.sun_path, socketPath.c_str());
+        bound = reinterpret_cast<sockaddr *>(&unixAddress);
+        boundLength = sizeof(unixAddress);
+        // a socket file left behind by an earlier server would make bind fail
+        ::unlink(socketPath.c_str());
+    } else if (address.rfind("tcp:", 0) == 0) {
+        int port = 0;
+        try {
+            port = std::stoi(address.substr(4));
+        } catch (const std::exception &e) {
+            port = 0;
+        }
+        if (port < 1 || port > 65535) {
+            std::cout << "QueryServer: bad port in " << address << std::endl;
+            throw std::runtime_error("Bad server address!");
+        }
+        // only clients on this machine can connect
+        tcpAddress.sin_family = AF_INET;
+        tcpAddress.sin_port = htons(static_cast<std::uint16_t>(port));
+        tcpAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bound = reinterpret_cast<sockaddr *>(&tcpAddress);
+        boundLength = sizeof(tcpAddress);
+    } else {
+        std::cout << "QueryServer: expected unix:<path> or tcp:<port>, got " << address << std::endl;
+        throw std::runtime_error("Bad server address!");
+    }
+
+    listener = ::socket(bound->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if (listener >= 0 && bound->sa_family == AF_INET)
+        ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (listener < 0 || ::bind(listener, bound, boundLength) < 0 || ::listen(listener, SOMAXCONN) < 0) {
+        std::cout << "QueryServer: couldn't listen on " << address << ": " << std::strerror(errno) << std::endl;
+        throw std::runtime_error("Couldn't open server socket!");
+    }
+
+    epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    completions = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event completion{};
+    completion.events = EPOLLIN;
+    completion.data.fd = completions;
+    if (epoll < 0 || ::epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event) < 0 || completions < 0 ||
+        ::epoll_ctl(epoll, EPOLL_CTL_ADD, completions, &completion) < 0) {
+        std::cout << "QueryServer: couldn't create the event loop: " << std::strerror(errno) << std::endl;
+        throw std::runtime_error("Couldn't create event loop!");
+    }
+    std::cout << "QueryServer listening on " << address << std::endl;
+}
+
+void QueryServer::run() {
+    // end the loop on Ctrl-C or kill, and report clients that went away through send() rather than SIGPIPE
+    struct sigaction action{};
+    action.sa_handler = requestStop;
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::vector<epoll_event> events(64);
+    while (!stopRequested) {
+        int ready = ::epoll_wait(epoll, events.data(), static_cast<int>(events.size()), -1);
+        if (ready < 0) {
+            // a signal interrupted the wait; the loop condition decides whether to go on
+            if (errno == EINTR)
+                continue;
+            std::cout << "QueryServer: epoll_wait failed: " << std::strerror(errno) << std::endl;
+            throw std::runtime_error("Event loop failed!");
+        }
+
+        // do the socket work: accept clients, read commands, take in finished answers, send what is left of
+        // earlier ones
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listener) {
+                accept();
+                continue;
+            }
+            if (fd == completions) {
+                complete();
+                continue;
+            }
+            auto it = connections.find(fd);
+            if (it == connections.end())
+                continue;
+            bool ok = true;
+            if (it->second.closing && (events[i].events & (EPOLLHUP | EPOLLERR))) {
+                // a client that is gone altogether has nothing more to send, and can't take its answers
+                ok = false;
+            } else {
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    ok = receive(it->second);
+                if (ok && (events[i].events & EPOLLOUT))
+                    ok = send(it->second);
+            }
+            if (!ok)
+                close(fd);
+        }
+
+        dispatch();
+
+        // close the sessions that have ended and have nothing left to answer or send
+        std::vector<int> finished;
+        for (auto &entry: connections) {
+            const Connection &connection = entry.second;
+            if (connection.closing && !connection.answering && connection.pending.empty() &&
+                connection.output.empty())
+                finished.push_back(entry.first);
+        }
+        for (int fd: finished) {
+            close(fd);
+        }
+    }
+    std::cout << "QueryServer stopping" << std::endl;
+}
+
+void QueryServer::accept() {
+    while (true) {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            // EAGAIN: no more clients waiting; anything else is the client's problem, not the server's
+            return;
+
+        // every session starts at the earliest time step
+        Connection &connection = connections[fd];
+        connection.fd = fd;
+        connection.cursor = startCursor;
+        if (options.format == BatchFormat::csv)
+            connection.output = std::string(BatchRunner::csvHeader()) + '\n';
+        watch(connection, true);
+    }
+}
+
+bool QueryServer::receive(Connection &connection) {
+    char buffer[16 * 1024];
+    while (!connection.closing && connection.output.size() < maxBacklog) {
+        ssize_t received = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection.input.append(buffer, static_cast<std::size_t>(received));
+        } else if (received == 0) {
+            // the client closed its side: answer what it sent, then close
+            connection.closing = true;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+
+    // split off the complete lines; a line that grows too long without ending is refused
+    std::size_t start = 0;
+    for (std::size_t end; (end = connection.input.find('\n', start)) != std::string::npos; start = end + 1) {
+        connection.pending.emplace_back(connection.input, start, end - start);
+    }
+    connection.input.erase(0, start);
+    if (connection.input.size() > maxLineLength)
+        return false;
+    // an unfinished last line counts once the client has closed its side, and a socket at its end stays readable,
+    // so it is no longer watched for input
+    if (connection.closing) {
+        if (!connection.input.empty())
+            connection.pending.push_back(connection.input);
+        connection.input.clear();
+        watch(connection);
+    }
+    return true;
+}
+
+bool QueryServer::send(Connection &connection) {
+    std::size_t sent = 0;
+    while (sent < connection.output.size()) {
+        ssize_t written = ::send(connection.fd, connection.output.data() + sent, connection.output.size() - sent,
+                                 MSG_NOSIGNAL);
+        if (written >= 0) {
+            sent += static_cast<std::size_t>(written);
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+    connection.output.erase(0, sent);
+    watch(connection);
+    return true;
+}
+
+void QueryServer::dispatch() {
+    bool waiting = false;
+    for (auto &entry: connections) {
+        waiting = waiting || (!entry.second.answering && !entry.second.pending.empty());
+    }
+    if (!waiting)
+        return;
+
+    // pick up the orders appended to the data file (when following it) while no query is running, and find every
+    // cursor's time again in case the time steps were renumbered, or the file was replaced
+    if (source.book && source.book->isFollowing()) {
+        auto now = std::chrono::steady_clock::now();
+        if (running == 0) {
+            lastFollow = now;
+            if (source.book->follow() > 0) {
+                startCursor = engine.start();
+                for (auto &entry: connections)
+                    entry.second.cursor = source.book->findTime(entry.second.cursor.first);
+            }
+        } else if (now - lastFollow >= followInterval) {
+            // so that a steady stream of queries can't keep the appended orders out for good
+            return;
+        }
+    }
+
+    // one job per connection, the commands of each one in order
+    for (auto &entry: connections) {
+        Connection &connection = entry.second;
+        if (connection.answering || connection.pending.empty())
+            continue;
+        std::size_t lines = std::min(connection.pending.size(), maxJobLines);
+        connection.answered.assign(std::make_move_iterator(connection.pending.begin()),
+                                   std::make_move_iterator(connection.pending.begin() + lines));
+        connection.pending.erase(connection.pending.begin(), connection.pending.begin() + lines);
+        connection.answering = true;
+        ++running;
+        Connection *target = &connection;
+        pool.submit([this, target] {
+            answer(*target);
+            {
+                std::lock_guard<std::mutex> lock(completedMutex);
+                completed.push_back(target->fd);
+            }
+            std::uint64_t one = 1;
+            ssize_t written = ::write(completions, &one, sizeof(one));
+            (void) written;
+        });
+    }
+}
+
+void QueryServer::answer(Connection &connection) {
+    std::ostringstream output;
+    for (std::string &line: connection.answered) {
+        ++connection.lines;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        BatchRunner::Command command;
+        command.line = connection.lines;
+        command.text = line;
+        command.tokens = CSVReader::tokenise(line, ' ');
+        // blank lines and comments get no answer, exit ends the session
+        if (command.tokens.empty() || command.tokens[0][0] == '#')
+            continue;
+        if (command.tokens[0] == "exit") {
+            connection.exited = true;
+            break;
+        }
+        BatchRunner::answer(engine, command, connection.cursor);
+        BatchRunner::write(output, command, options.format);
+    }
+    connection.answered.clear();
+    connection.answers = output.str();
+}
+
+void QueryServer::complete() {
+    std::uint64_t count;
+    ssize_t received = ::read(completions, &count, sizeof(count));
+    (void) received;
+    std::vector<int> finished;
+    {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        finished.swap(completed);
+    }
+
+    for (int fd: finished) {
+        // a connection isn't forgotten while a job is answering it
+        Connection &connection = connections.at(fd);
+        connection.answering = false;
+        --running;
+        connection.output += connection.answers;
+        connection.answers.clear();
+        // exit ends the session; whatever came after it gets no answer
+        if (connection.exited) {
+            connection.closing = true;
+            connection.pending.clear();
+        }
+        if (connection.dropped || !send(connection))
+            close(fd);
+    }
+}
+
+void QueryServer::watch(const Connection &connection, bool added) {
+    epoll_event event{};
+    event.data.fd = connection.fd;
+    if (!connection.closing && connection.output.size() < maxBacklog)
+        event.events |= EPOLLIN;
+    if (!connection.output.empty())
+        event.events |= EPOLLOUT;
+    ::epoll_ctl(epoll, added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+void QueryServer::close(int fd) {
+    // a connection can fail and end in the same round
+    auto it = connections.find(fd);
+    if (it == connections.end())
+        return;
+    ::epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+    // one that a job is answering is closed once the job has finished
+    if (it->second.answering) {
+        it->second.dropped = true;
+        return;
+    }
+    ::close(fd);
+    connections.erase(fd);
+}
@@ -0,0 +1,121 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_QUERYSERVER_H
+#define ADVISORBOT_QUERYSERVER_H
+
+// include necessary standard C++ libraries and header files
+#include <string>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <unordered_map>
+#include "OrderBook.h"
+#include "QueryEngine.h"
+#include "BatchRunner.h"
+#include "WorkerPool.h"
+
+// Where the server listens, how it answers and with how many threads (0 = one per core).
+struct ServerOptions {
+    // "unix:<path>" for a Unix-domain socket, or "tcp:<port>" for a TCP port on the loopback address
+    std::string address;
+    BatchFormat format = BatchFormat::json;
+    unsigned threads = 0;
+};
+
+// Serves the bot's commands to many clients at once from one order book (or catalog of them). Clients send one command per line and
+// get one result per command back, in the batch mode's JSON or CSV format; exit (or closing the connection) ends a
+// session. Every connection has its own time cursor, starting at the earliest time step, so step only moves the
+// client that sent it. A single epoll loop does all the socket work, and hands each connection's commands to a job
+// on a worker pool, one job per connection at a time so that they are answered in order. The loop goes on serving
+// the other clients while a job runs; the job reports back through an eventfd the loop watches, and its answers are
+// sent as soon as they are in.
+class QueryServer {
+    public:
+        // Open the listening socket. Prints a message and throws std::runtime_error if it can't be opened, or
+        // QueryError if the data has no time step to start at.
+        QueryServer(const QuerySource &_source, const ServerOptions &_options);
+
+        // Close every connection and the listening socket, removing a Unix-domain socket's file.
+        ~QueryServer();
+
+        // A server owns its sockets, so it can be neither copied nor assigned.
+        QueryServer(const QueryServer &) = delete;
+        QueryServer &operator=(const QueryServer &) = delete;
+
+        // Serve clients until the process receives SIGINT or SIGTERM.
+        void run();
+
+    private:
+        // One client: its unanswered input, its unsent output and where it is in the dataset.
+        struct Connection {
+            int fd = -1;
+            std::string input;
+            std::string output;
+            // the complete lines received but not yet answered, and the number of lines received so far
+            std::deque<std::string> pending;
+            std::size_t lines = 0;
+            QueryCursor cursor;
+            // the client closed its side, or sent exit; the connection is closed once its output is sent
+            bool closing = false;
+            // a job is answering the connection; until it has finished, only the job touches the lines it answers,
+            // its answers, 'exited', 'lines' and the cursor
+            bool answering = false;
+            std::vector<std::string> answered;
+            std::string answers;
+            bool exited = false;
+            // the connection failed while a job was answering it, and is closed once the job has finished
+            bool dropped = false;
+        };
+
+        // Create, bind and listen on the socket named by the address.
+        void listen();
+
+        // Accept every waiting client.
+        void accept();
+
+        // Read what the client sent and split off the complete lines. Returns false if the connection failed.
+        bool receive(Connection &connection);
+
+        // Send as much of the output as the socket takes. Returns false if the connection failed.
+        bool send(Connection &connection);
+
+        // Hand the pending lines of every connection without a running job to the pool, a bounded number per job so
+        // that a client with a long script takes turns with the others. A followed data file is
+        // looked at first when no job is running; once it hasn't been for a while, new jobs wait for the running ones.
+        void dispatch();
+
+        // Answer the lines handed to a connection's job in order. Runs on the pool.
+        void answer(Connection &connection);
+
+        // Take in the answers of the jobs that have finished, and send them.
+        void complete();
+
+        // Listen for input only while the output isn't backed up, and for writability while there is output.
+        void watch(const Connection &connection, bool added = false);
+
+        // Close a connection and forget it.
+        void close(int fd);
+
+        QuerySource source;
+        ServerOptions options;
+        QueryEngine engine;
+        // where every session starts
+        QueryCursor startCursor;
+        WorkerPool pool;
+        // the Unix-domain socket's file, empty for TCP
+        std::string socketPath;
+        int listener = -1;
+        int epoll = -1;
+        std::unordered_map<int, Connection> connections;
+        // the eventfd the jobs signal, and the connections whose jobs have finished since the loop last looked
+        int completions = -1;
+        std::mutex completedMutex;
+        std::vector<int> completed;
+        // the number of jobs running, and when the followed data file was last looked at
+        std::size_t running = 0;
+        std::chrono::steady_clock::time_point lastFollow;
+};
+
+#endif //ADVISORBOT_QUERYSERVER_H
@@ -0,0 +1,122 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_REDUCEPOLICIES_H
+#define ADVISORBOT_REDUCEPOLICIES_H
+
+// include necessary standard C++ libraries and header files
+#include <limits>
+#include <cstddef>
+#include "ColumnSpan.h"
+#include "PriceKernels.h"
+#include "OrderBookEntry.h"
+#include "OrderStore.h"
+#include "AggregateTable.h"
+
+// Reduction policies for the templated Calculator functions. Each policy says how to fold a run of prices
+// element by element (initial, combine, finish), how to reduce a contiguous price column in one kernel call,
+// and what it means for the precomputed summaries of a bucket and of a window of time steps (0 if the window
+// has no orders).
+// Picking the policy at compile time lets every reduction be inlined and specialised.
+
+// Smallest price.
+struct Min {
+    static double initial() { return std::numeric_limits<double>::infinity(); }
+    static double combine(double acc, double price) { return price < acc ? price : acc; }
+    static double finish(double acc, std::size_t) { return acc; }
+    static double column(ColumnSpan<double> prices) { return PriceKernels::min(prices); }
+
+    // Minimum of one bucket, and the average of the per time step minimum over a window.
+    static double bucket(const PriceAggregate &aggregate) { return aggregate.min; }
+    static double window(const WindowAggregate &window) {
+        return window.steps == 0 ? 0 : window.minSum / (double) window.steps;
+    }
+};
+
+// Largest price.
+struct Max {
+    static double initial() { return -std::numeric_limits<double>::infinity(); }
+    static double combine(double acc, double price) { return price > acc ? price : acc; }
+    static double finish(double acc, std::size_t) { return acc; }
+    static double column(ColumnSpan<double> prices) { return PriceKernels::max(prices); }
+
+    // Maximum of one bucket, and the average of the per time step maximum over a window.
+    static double bucket(const PriceAggregate &aggregate) { return aggregate.max; }
+    static double window(const WindowAggregate &window) {
+        return window.steps == 0 ? 0 : window.maxSum / (double) window.steps;
+    }
+};
+
+// Total of the prices.
+struct Sum {
+    static double initial() { return 0; }
+    static double combine(double acc, double price) { return acc + price; }
+    static double finish(double acc, std::size_t) { return acc; }
+    static double column(ColumnSpan<double> prices) { return PriceKernels::sumPairwise(prices); }
+
+    // Total of one bucket, and the average of the per time step total over a window.
+    static double bucket(const PriceAggregate &aggregate) { return aggregate.sum; }
+    static double window(const WindowAggregate &window) {
+        return window.steps == 0 ? 0 : window.sum / (double) window.steps;
+    }
+};
+
+// Average price.
+struct Mean {
+    static double initial() { return 0; }
+    static double combine(double acc, double price) { return acc + price; }
+    static double finish(double acc, std::size_t count) { return acc / (double) count; }
+    static double column(ColumnSpan<double> prices) {
+        return PriceKernels::sumPairwise(prices) / (double) prices.size();
+    }
+
+    // Average of one bucket, and the average over a window with every order weighted equally.
+    static double bucket(const PriceAggregate &aggregate) { return aggregate.sum / (double) aggregate.count; }
+    static double window(const WindowAggregate &window) {
+        return window.count == 0 ? 0 : window.sum / (double) window.count;
+    }
+};
+
+// Volume-weighted policies need the amounts as well as the prices, so they only reduce the precomputed summaries,
+// where volume and notional are folded in alongside the prices. Over a window they give the total of all of its
+// orders rather than a per time step average.
+
+// Volume-weighted average price: the notional divided by the volume.
+struct Vwap {
+    static double bucket(const PriceAggregate &aggregate) {
+        return aggregate.volume == 0 ? 0 : aggregate.notional / aggregate.volume;
+    }
+    static double window(const WindowAggregate &window) {
+        return window.volume == 0 ? 0 : window.notional / window.volume;
+    }
+};
+
+// Total amount ordered.
+struct Volume {
+    static double bucket(const PriceAggregate &aggregate) { return aggregate.volume; }
+    static double window(const WindowAggregate &window) { return window.volume; }
+};
+
+// Total value ordered: the sum of price times amount.
+struct Notional {
+    static double bucket(const PriceAggregate &aggregate) { return aggregate.notional; }
+    static double window(const WindowAggregate &window) { return window.notional; }
+};
+
+// Projections turn the elements of a range into the price to reduce.
+
+// The element is the price itself.
+struct Identity {
+    double operator()(double price) const { return price; }
+};
+
+// The price of an OrderBookEntry.
+struct EntryPrice {
+    double operator()(const OrderBookEntry &entry) const { return entry.price; }
+};
+
+// The price of a row of an OrderStore.
+struct RowPrice {
+    double operator()(const OrderRow &row) const { return row.price(); }
+};
+
+#endif //ADVISORBOT_REDUCEPOLICIES_H
@@ -0,0 +1,299 @@
+// include necessary C++ libraries and header files
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include "Snapshot.h"
+#include "MappedFile.h"
+#include "OrderIndex.h"
+
+namespace {
+    // Fixed-size header at the start of every snapshot file.
+    struct SnapshotHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint64_t sourceSize;
+        std::int64_t sourceModifiedNanos;
+        std::uint64_t rows;
+        std::uint32_t blocks;
+        std::uint32_t reserved;
+        // checksum of all the header fields above
+        std::uint64_t headerChecksum;
+    };
+
+    // Header in front of every block payload.
+    struct BlockHeader {
+        char tag[4];
+        std::uint32_t reserved;
+        std::uint64_t length;
+        std::uint64_t checksum;
+    };
+
+    const char snapshotMagic[8] = {'C', 'I', 'S', 'N', 'A', 'P', 0, 0};
+    const std::uint32_t byteOrderMarker = 0x01020304;
+
+    // Round a length up to the next multiple of 8 so that every block payload stays aligned.
+    std::size_t padded(std::size_t length) {
+        return (length + 7) & ~static_cast<std::size_t>(7);
+    }
+
+    // Append the raw bytes of a value to a buffer.
+    template<typename T>
+    void appendRaw(std::string &buffer, const T &value) {
+        buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    // View the raw bytes of a column.
+    template<typename T>
+    std::string_view columnBytes(const std::vector<T> &column) {
+        return {reinterpret_cast<const char *>(column.data()), column.size() * sizeof(T)};
+    }
+
+    // Copy a column block payload into a column.
+    template<typename T>
+    void copyColumn(const char *payload, std::uint64_t rows, std::vector<T> &column) {
+        column.resize(rows);
+        if (rows != 0) std::memcpy(column.data(), payload, rows * sizeof(T));
+    }
+
+    // Serialise a list of strings as a dictionary block payload.
+    std::string encodeDictionary(const std::vector<std::string> &values) {
+        std::string payload;
+        appendRaw(payload, static_cast<std::uint32_t>(values.size()));
+        std::uint32_t offset = 0;
+        appendRaw(payload, offset);
+        for (const std::string &v: values) {
+            offset += static_cast<std::uint32_t>(v.size());
+            appendRaw(payload, offset);
+        }
+        for (const std::string &v: values) payload += v;
+        return payload;
+    }
+
+    // Deserialise a dictionary block payload. Returns false if the payload is inconsistent.
+    bool decodeDictionary(const char *payload, std::uint64_t length, std::vector<std::string> &values) {
+        std::uint32_t count;
+        if (length < sizeof(count)) return false;
+        std::memcpy(&count, payload, sizeof(count));
+
+        std::uint64_t offsetsBytes = (static_cast<std::uint64_t>(count) + 1) * sizeof(std::uint32_t);
+        if (length < sizeof(count) + offsetsBytes) return false;
+        const char *offsets = payload + sizeof(count);
+        const char *chars = offsets + offsetsBytes;
+        std::uint64_t charsLength = length - sizeof(count) - offsetsBytes;
+
+        values.clear();
+        values.reserve(count);
+        std::uint32_t begin, end;
+        std::memcpy(&begin, offsets, sizeof(begin));
+        for (std::uint32_t i = 0; i < count; ++i) {
+            std::memcpy(&end, offsets + (i + 1) * sizeof(std::uint32_t), sizeof(end));
+            if (end < begin || end > charsLength) return false;
+            values.emplace_back(chars + begin, end - begin);
+            begin = end;
+        }
+        return true;
+    }
+}
+
+// The snapshot lives next to its CSV file.
+std::string Snapshot::pathFor(const std::string &csvFile) {
+    return csvFile + ".snap";
+}
+
+// A fast 64-bit checksum: every word is mixed into the state with a xor and a multiplication (FNV style).
+std::uint64_t Snapshot::checksum(const void *data, std::size_t length) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    const std::uint64_t prime = 0x100000001b3ULL;
+
+    std::size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for (; i < length; ++i) {
+        hash = (hash ^ bytes[i]) * prime;
+    }
+    return hash ^ length;
+}
+
+// Whole seconds aren't enough: a file rewritten with the same size within the same second would look unchanged.
+bool Snapshot::sourceInfo(const std::string &csvFile, SourceInfo &source) {
+    struct stat info{};
+    if (stat(csvFile.c_str(), &info) != 0)
+        return false;
+    source.size = static_cast<std::uint64_t>(info.st_size);
+    source.modifiedNanos = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+bool Snapshot::write(const std::string &snapshotFile, const SourceInfo &source, const OrderStore &store) {
+    SnapshotHeader header{};
+    std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version = version;
+    header.byteOrder = byteOrderMarker;
+    header.sourceSize = source.size;
+    header.sourceModifiedNanos = source.modifiedNanos;
+    header.rows = store.size();
+
+    // the dictionaries are encoded, the columns are written exactly as they are laid out in memory
+    std::string productDictionary = encodeDictionary(store.products.values());
+    std::string timestampDictionary = encodeDictionary(store.timestamps.values());
+    std::vector<std::pair<const char *, std::string_view>> blocks = {
+            {"PROD", productDictionary},
+            {"TIME", timestampDictionary},
+            {"PRIC", columnBytes(store.prices)},
+            {"AMNT", columnBytes(store.amounts)},
+            {"TSID", columnBytes(store.timestampIds)},
+            {"PRID", columnBytes(store.productIds)},
+            {"SIDE", columnBytes(store.orderTypes)}
+    };
+    header.blocks = static_cast<std::uint32_t>(blocks.size());
+    header.headerChecksum = checksum(&header, offsetof(SnapshotHeader, headerChecksum));
+
+    // write to a temporary file first and move it into place once it is complete
+    std::string tempFile = snapshotFile + ".tmp";
+    std::ofstream out{tempFile, std::ios::binary | std::ios::trunc};
+    if (!out) return false;
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    const char zeros[8] = {};
+    for (const auto &block: blocks) {
+        BlockHeader blockHeader{};
+        std::memcpy(blockHeader.tag, block.first, sizeof(blockHeader.tag));
+        blockHeader.length = block.second.size();
+        blockHeader.checksum = checksum(block.second.data(), block.second.size());
+        out.write(reinterpret_cast<const char *>(&blockHeader), sizeof(blockHeader));
+        out.write(block.second.data(), static_cast<std::streamsize>(block.second.size()));
+        out.write(zeros, static_cast<std::streamsize>(padded(block.second.size()) - block.second.size()));
+    }
+    out.close();
+
+    if (!out || std::rename(tempFile.c_str(), snapshotFile.c_str()) != 0) {
+        std::remove(tempFile.c_str());
+        return false;
+    }
+    std::cout << "Snapshot::write wrote " << store.size() << " entries to " << snapshotFile << std::endl;
+    return true;
+}
+
+bool Snapshot::read(const std::string &snapshotFile, const std::string &csvFile, OrderStore &store) {
+    // a missing snapshot is the normal first-run case, so fail quietly
+    struct stat info{};
+    if (stat(snapshotFile.c_str(), &info) != 0)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file{snapshotFile};
+    std::string_view data = file.view();
+
+    // validate the header and make sure the CSV file hasn't changed since the snapshot was taken
+    SnapshotHeader header{};
+    SourceInfo source;
+    if (data.size() < sizeof(header)) return false;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0 ||
+        header.headerChecksum != checksum(&header, offsetof(SnapshotHeader, headerChecksum)) ||
+        header.version != version || header.byteOrder != byteOrderMarker) {
+        std::cout << "Snapshot::read " << snapshotFile << " has an unsupported format, ignoring it" << std::endl;
+        return false;
+    }
+    if (!sourceInfo(csvFile, source) ||
+        source.size != header.sourceSize || source.modifiedNanos != header.sourceModifiedNanos) {
+        std::cout << "Snapshot::read " << snapshotFile << " is stale, ignoring it" << std::endl;
+        return false;
+    }
+
+    // locate and verify every block
+    const char *prices = nullptr, *amounts = nullptr, *timestampIds = nullptr, *productIds = nullptr, *sides = nullptr;
+    std::vector<std::string> productList, timestampList;
+    bool haveProducts = false, haveTimestamps = false;
+    std::size_t pos = sizeof(header);
+    for (std::uint32_t b = 0; b < header.blocks; ++b) {
+        BlockHeader blockHeader{};
+        if (data.size() - pos < sizeof(blockHeader)) return false;
+        std::memcpy(&blockHeader, data.data() + pos, sizeof(blockHeader));
+        pos += sizeof(blockHeader);
+        if (data.size() - pos < blockHeader.length) return false;
+
+        const char *payload = data.data() + pos;
+        if (checksum(payload, blockHeader.length) != blockHeader.checksum) {
+            std::cout << "Snapshot::read " << snapshotFile << " failed its checksum, ignoring it" << std::endl;
+            return false;
+        }
+
+        std::string tag{blockHeader.tag, sizeof(blockHeader.tag)};
+        std::uint64_t rowBytes = 0;
+        if (tag == "PROD") {
+            haveProducts = decodeDictionary(payload, blockHeader.length, productList);
+        } else if (tag == "TIME") {
+            haveTimestamps = decodeDictionary(payload, blockHeader.length, timestampList);
+        } else if (tag == "PRIC") {
+            prices = payload;
+            rowBytes = sizeof(double);
+        } else if (tag == "AMNT") {
+            amounts = payload;
+            rowBytes = sizeof(double);
+        } else if (tag == "TSID") {
+            timestampIds = payload;
+            rowBytes = sizeof(std::uint32_t);
+        } else if (tag == "PRID") {
+            productIds = payload;
+            rowBytes = sizeof(std::uint32_t);
+        } else if (tag == "SIDE") {
+            sides = payload;
+            rowBytes = sizeof(std::uint8_t);
+        }
+        // column blocks must hold exactly one value per row
+        if (rowBytes != 0 && blockHeader.length != rowBytes * header.rows) return false;
+
+        pos += padded(blockHeader.length);
+        if (pos > data.size()) pos = data.size();
+    }
+    if (!haveProducts || !haveTimestamps || !prices || !amounts || !timestampIds || !productIds || !sides)
+        return false;
+
+    // every id has to point into its dictionary
+    auto outOfRange = [&header](const char *column, std::size_t limit) {
+        for (std::uint64_t i = 0; i < header.rows; ++i) {
+            std::uint32_t id;
+            std::memcpy(&id, column + i * sizeof(id), sizeof(id));
+            if (id >= limit) return true;
+        }
+        return false;
+    };
+    if (outOfRange(timestampIds, timestampList.size()) || outOfRange(productIds, productList.size()))
+        return false;
+    // and every side to an order type, since the index uses it as a position
+    for (std::uint64_t i = 0; i < header.rows; ++i) {
+        if (static_cast<std::uint8_t>(sides[i]) >= OrderIndex::orderTypeCount)
+            return false;
+    }
+
+    // the columns are copied as they are, no text has to be parsed
+    OrderStore loaded;
+    copyColumn(prices, header.rows, loaded.prices);
+    copyColumn(amounts, header.rows, loaded.amounts);
+    copyColumn(timestampIds, header.rows, loaded.timestampIds);
+    copyColumn(productIds, header.rows, loaded.productIds);
+    copyColumn(sides, header.rows, loaded.orderTypes);
+    loaded.products.assign(std::move(productList));
+    loaded.timestamps.assign(std::move(timestampList));
+    if (!loaded.parseTimestamps()) {
+        std::cout << "Snapshot::read " << snapshotFile << " has a malformed timestamp, ignoring it" << std::endl;
+        return false;
+    }
+    store = std::move(loaded);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Snapshot::read loaded " << store.size() << " entries from " << snapshotFile << " in "
+              << elapsed.count() * 1000.0 << " ms" << std::endl;
+    return true;
+}
@@ -0,0 +1,59 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_SNAPSHOT_H
+#define ADVISORBOT_SNAPSHOT_H
+
+// include necessary standard C++ libraries and header files
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "OrderStore.h"
+
+/*
+Binary snapshot of a parsed CSV data file, so that later runs can skip parsing altogether.
+
+Layout (native byte order, every section starts on an 8 byte boundary):
+    header   magic "CISNAP\0\0", format version, byte order marker, size and modification time (in nanoseconds)
+             of the source CSV file, number of rows, number of blocks and a checksum of the header itself
+    blocks   each block starts with {tag, reserved, payload length, payload checksum} followed by its payload:
+             PROD / TIME   dictionaries: uint32 count, uint32 offsets[count + 1], characters
+             PRIC / AMNT   double price / amount per row
+             TSID / PRID   uint32 timestamp / product dictionary index per row
+             SIDE          uint8 order type per row
+
+A snapshot is only used when its version and byte order match this build, the source CSV still has the recorded
+size and modification time, every checksum is intact and every id and side is in range. Otherwise the caller falls
+back to the CSV file.
+*/
+class Snapshot {
+    public:
+        // Return the path of the snapshot that belongs to the given CSV data file.
+        static std::string pathFor(const std::string &csvFile);
+
+        // Size and modification time (in nanoseconds) of a CSV data file.
+        struct SourceInfo {
+            std::uint64_t size = 0;
+            std::int64_t modifiedNanos = 0;
+        };
+
+        // Look up the size and modification time of a CSV data file. Returns false if it can't be read.
+        static bool sourceInfo(const std::string &csvFile, SourceInfo &source);
+
+        // Write a snapshot of the columns and dictionaries of the given store, recording the size and modification
+        // time its CSV file had before it was parsed, so that rows appended during the parse make the snapshot stale.
+        // Returns false if the snapshot could not be written; a failed write never leaves a partial file behind.
+        static bool write(const std::string &snapshotFile, const SourceInfo &source, const OrderStore &store);
+
+        // Map a snapshot and replace the contents of 'store' with it.
+        // Returns false, leaving the store untouched, if the snapshot is missing, stale or corrupt.
+        static bool read(const std::string &snapshotFile, const std::string &csvFile, OrderStore &store);
+
+        // Current version of the snapshot format. Bump whenever the layout changes.
+        static const std::uint32_t version = 3;
+
+        // Checksum of a block of bytes, processed a 64-bit word at a time. The block files use it too.
+        static std::uint64_t checksum(const void *data, std::size_t length);
+};
+
+#endif //ADVISORBOT_SNAPSHOT_H
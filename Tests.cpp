@@ -0,0 +1,424 @@
+// Checks of advisorbot against a direct scan of the orders of a data file: the window() and range() totals of the
+// AggregateTable, the time step navigation of the OrderBook (getNextTime, findTime) and the time windows of the
+// QueryEngine (durations, "between", and durations that reach back past the start of the data).
+// Build and run with:
+//   make test             generates a small data file with generate-orders and runs the checks on it
+//   ./tests <data.csv>
+// The data file should have products without orders at some time steps, so that windows cross empty steps;
+// "make test" generates one with a skewed spread of the orders over the products.
+// Prints every failed check and exits with 1 if there were any.
+// The snapshot of the data file is neither read nor written; the snapshot checks work on a copy of the file.
+
+// include necessary C++ libraries and header files
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "OrderBook.h"
+#include "QueryEngine.h"
+#include "ReducePolicies.h"
+#include "Timestamp.h"
+#include "Snapshot.h"
+#include "CSVReader.h"
+
+namespace {
+    std::size_t checks = 0;
+    std::size_t failures = 0;
+
+    // Count a check, and report it if it failed.
+    void check(bool passed, const std::string &what) {
+        ++checks;
+        if (!passed) {
+            ++failures;
+            std::cout << "FAILED: " << what << std::endl;
+        }
+    }
+
+    // Whether two sums agree up to the rounding of adding them up in a different order.
+    bool close(double a, double b) {
+        double scale = std::fmax(1.0, std::fmax(std::fabs(a), std::fabs(b)));
+        return std::fabs(a - b) <= 1e-9 * scale;
+    }
+
+    // Swallows what the loaders print about themselves.
+    class Quiet {
+        public:
+            Quiet() : saved(std::cout.rdbuf(discard.rdbuf())) {
+            }
+
+            ~Quiet() { std::cout.rdbuf(saved); }
+
+        private:
+            std::ostringstream discard;
+            std::streambuf *saved;
+    };
+
+    // The totals of a run of time steps of one product and order type, added up from the orders themselves.
+    struct Expected {
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        double sum = 0;
+        std::uint64_t count = 0;
+        double minSum = 0;
+        double maxSum = 0;
+        std::uint64_t steps = 0;
+        double volume = 0;
+        double notional = 0;
+        // time steps without orders in the run
+        std::size_t emptySteps = 0;
+    };
+
+    // The orders of every time step of one product and order type, as getOrders returns them.
+    struct Scan {
+        std::string product;
+        OrderBookType type;
+        std::vector<std::vector<OrderRow>> steps;
+    };
+
+    // Look at the orders of every time step of one product and order type.
+    Scan scan(const OrderBook &book, const std::string &product, OrderBookType type) {
+        Scan result{product, type, {}};
+        for (const std::string &timestamp: book.getTimestamps())
+            result.steps.push_back(book.getOrders(type, product, timestamp));
+        return result;
+    }
+
+    // Add up the orders of the time steps [first, last].
+    Expected expect(const Scan &orders, std::size_t first, std::size_t last) {
+        Expected totals;
+        for (std::size_t t = first; t <= last; ++t) {
+            if (orders.steps[t].empty()) {
+                ++totals.emptySteps;
+                continue;
+            }
+            double stepMin = std::numeric_limits<double>::infinity();
+            double stepMax = -std::numeric_limits<double>::infinity();
+            for (const OrderRow &row: orders.steps[t]) {
+                stepMin = std::fmin(stepMin, row.price());
+                stepMax = std::fmax(stepMax, row.price());
+                totals.sum += row.price();
+                totals.volume += row.amount();
+                totals.notional += row.price() * row.amount();
+                ++totals.count;
+            }
+            totals.min = std::fmin(totals.min, stepMin);
+            totals.max = std::fmax(totals.max, stepMax);
+            totals.minSum += stepMin;
+            totals.maxSum += stepMax;
+            ++totals.steps;
+        }
+        return totals;
+    }
+
+    // Name a window in the report of a failed check.
+    std::string describe(const Scan &orders, std::size_t first, std::size_t last) {
+        return orders.product + (orders.type == OrderBookType::bid ? " bid" : " ask") + " [" +
+               std::to_string(first) + ", " + std::to_string(last) + "]";
+    }
+
+    // Compare window() and range() of the time steps [first, last] with the orders; returns the number of empty
+    // time steps the window has.
+    std::size_t checkWindow(const OrderBook &book, const Scan &orders, std::uint32_t productId,
+                            std::size_t first, std::size_t last) {
+        Expected expected = expect(orders, first, last);
+        std::string name = describe(orders, first, last);
+        auto firstStep = static_cast<std::uint32_t>(first);
+        auto lastStep = static_cast<std::uint32_t>(last);
+
+        WindowAggregate window = book.getAggregates().window(productId, orders.type, firstStep, lastStep);
+        check(window.count == expected.count, "window count of " + name);
+        check(window.steps == expected.steps, "window steps of " + name);
+        check(close(window.sum, expected.sum), "window sum of " + name);
+        check(close(window.minSum, expected.minSum), "window minSum of " + name);
+        check(close(window.maxSum, expected.maxSum), "window maxSum of " + name);
+        check(close(window.volume, expected.volume), "window volume of " + name);
+        check(close(window.notional, expected.notional), "window notional of " + name);
+        double average = expected.count == 0 ? 0 : expected.sum / (double) expected.count;
+        check(close(Mean::window(window), average), "window average of " + name);
+
+        PriceAggregate range = book.getAggregates().range(productId, orders.type, firstStep, lastStep);
+        check(range.count == expected.count, "range count of " + name);
+        check(range.min == expected.min, "range min of " + name);
+        check(range.max == expected.max, "range max of " + name);
+        check(close(range.sum, expected.sum), "range sum of " + name);
+        check(close(range.volume, expected.volume), "range volume of " + name);
+        check(close(range.notional, expected.notional), "range notional of " + name);
+        return expected.emptySteps;
+    }
+
+    // window() and range() over single time steps, the whole day, runs of several lengths, and the time steps
+    // around every empty one.
+    void testWindows(const OrderBook &book) {
+        std::size_t stepCount = book.getTimestamps().size();
+        std::size_t crossingEmpty = 0;
+        for (const std::string &product: book.getProducts()) {
+            std::uint32_t productId = book.getProductId(product);
+            for (OrderBookType type: {OrderBookType::bid, OrderBookType::ask}) {
+                Scan orders = scan(book, product, type);
+                // N = 1
+                for (std::size_t t = 0; t < stepCount; ++t)
+                    checkWindow(book, orders, productId, t, t);
+                // N = all
+                checkWindow(book, orders, productId, 0, stepCount - 1);
+                // runs of a few lengths, from every few time steps
+                for (std::size_t length: {2, 3, 7, 50}) {
+                    for (std::size_t first = 0; first + length <= stepCount; first += 5)
+                        checkWindow(book, orders, productId, first, first + length - 1);
+                }
+                // windows that start, end and lie around an empty time step
+                for (std::size_t t = 1; t + 1 < stepCount; ++t) {
+                    if (!orders.steps[t].empty())
+                        continue;
+                    checkWindow(book, orders, productId, t, t + 1);
+                    checkWindow(book, orders, productId, t - 1, t);
+                    if (checkWindow(book, orders, productId, t - 1, t + 1) < 3)
+                        ++crossingEmpty;
+                }
+            }
+        }
+        check(crossingEmpty > 0, "the data file has windows with both empty and non-empty time steps");
+    }
+
+    // getNextTime moves on by one time step and wraps around; findTime and getNextTime find the next time step
+    // after a time that isn't in the dataset.
+    void testNavigation(OrderBook &book) {
+        const std::vector<std::string> &timestamps = book.getTimestamps();
+        std::size_t stepCount = timestamps.size();
+        check(book.getEarliestTime() == timestamps.front(), "getEarliestTime");
+
+        for (std::size_t t = 0; t < stepCount; ++t) {
+            std::size_t next = t + 1 < stepCount ? t + 1 : 0;
+            std::pair<std::string, int> expected{timestamps[next], static_cast<int>(next)};
+            check(book.getNextTime(timestamps[t]) == expected, "getNextTime of " + timestamps[t]);
+            check(book.getNextTime(static_cast<std::uint32_t>(t)) == expected,
+                  "getNextTime of id " + std::to_string(t));
+            check(book.findTime(timestamps[t]) == std::make_pair(timestamps[t], static_cast<int>(t)),
+                  "findTime of " + timestamps[t]);
+
+            // a time just after this time step, before the next one
+            std::int64_t micros = book.getTimestampMicros(static_cast<std::uint32_t>(t));
+            if (t + 1 < stepCount && book.getTimestampMicros(static_cast<std::uint32_t>(t + 1)) > micros + 1) {
+                std::string between = Timestamp::format(micros + 1);
+                check(book.findTime(between) == expected, "findTime of " + between);
+                check(book.getNextTime(between) == expected, "getNextTime of " + between);
+            }
+        }
+
+        // before the first time step, after the last one, and not a time at all
+        std::pair<std::string, int> earliest{timestamps.front(), 0};
+        std::string before = Timestamp::format(book.getTimestampMicros(0) - Timestamp::second);
+        std::string after = Timestamp::format(book.getTimestampMicros(static_cast<std::uint32_t>(stepCount - 1)) + 1);
+        check(book.findTime(before) == earliest, "findTime before the first time step");
+        check(book.findTime(after) == earliest, "findTime after the last time step");
+        check(book.findTime("not a time") == earliest, "findTime of text that isn't a time");
+    }
+
+    // Answer a command at a time step and return its value, or NaN if it has none or fails.
+    double answer(const QueryEngine &engine, const OrderBook &book, std::size_t step,
+                  const std::vector<std::string> &cmd) {
+        QueryCursor cursor{book.getTimestamps()[step], static_cast<int>(step)};
+        try {
+            QueryResult result = engine.run(cmd, cursor);
+            return result.hasValue ? result.value : std::nan("");
+        } catch (const QueryError &e) {
+            return std::nan("");
+        }
+    }
+
+    // The time windows of the engine cover the time steps they should: the last N time steps, a duration up to the
+    // current time (clamped at the start of the data when it reaches back further), and "between" two times. A window
+    // without orders answers 0.
+    void testTimeWindows(const OrderBook &book) {
+        std::int64_t value;
+        check(Timestamp::parseDuration("5m", value) && value == 300 * Timestamp::second, "parseDuration of 5m");
+        check(Timestamp::parseDuration("106751991d", value), "parseDuration of the longest number of days");
+        check(!Timestamp::parseDuration("106751992d", value), "parseDuration of too many days");
+        check(Timestamp::parseDuration("999999999999999999us", value), "parseDuration of 18 digits");
+        check(!Timestamp::parseDuration("1000000000000000000us", value), "parseDuration of 19 digits");
+        check(!Timestamp::parseDuration("0s", value), "parseDuration of nothing");
+        check(!Timestamp::parseDuration("5", value), "parseDuration without a unit");
+
+        QueryEngine engine(book);
+        const std::vector<std::string> &timestamps = book.getTimestamps();
+        std::size_t stepCount = timestamps.size();
+        for (const std::string &product: book.getProducts()) {
+            for (OrderBookType type: {OrderBookType::bid, OrderBookType::ask}) {
+                Scan orders = scan(book, product, type);
+                std::string side = type == OrderBookType::bid ? "bid" : "ask";
+                for (std::size_t t = 0; t < stepCount; t += 7) {
+                    std::string at = " at " + timestamps[t];
+                    auto average = [](const Expected &e) { return e.count == 0 ? 0 : e.sum / (double) e.count; };
+
+                    // the last N time steps, N = 1, all of them, and more than there are
+                    Expected one = expect(orders, t, t);
+                    Expected all = expect(orders, 0, t);
+                    check(close(answer(engine, book, t, {"avg", product, side, "1"}), average(one)),
+                          "avg " + product + " " + side + " 1" + at);
+                    check(close(answer(engine, book, t, {"avg", product, side, std::to_string(t + 1)}), average(all)),
+                          "avg " + product + " " + side + " " + std::to_string(t + 1) + at);
+                    check(close(answer(engine, book, t, {"avg", product, side, std::to_string(t + 5)}), average(all)),
+                          "avg " + product + " " + side + " " + std::to_string(t + 5) + at);
+
+                    // the time steps of the last minute
+                    std::int64_t now = book.getTimestampMicros(static_cast<std::uint32_t>(t));
+                    std::size_t first = t;
+                    while (first > 0 && book.getTimestampMicros(static_cast<std::uint32_t>(first - 1)) >=
+                                        now - 60 * Timestamp::second)
+                        --first;
+                    Expected minute = expect(orders, first, t);
+                    double minuteAverage = answer(engine, book, t, {"avg", product, side, "1m"});
+                    check(close(minuteAverage, average(minute)),
+                          "avg " + product + " " + side + " 1m" + at);
+
+                    // a duration reaching back past the start of the data covers all of it
+                    double longest = answer(engine, book, t, {"avg", product, side, "106751991d"});
+                    check(close(longest, average(all)),
+                          "avg " + product + " " + side + " 106751991d" + at);
+                    double maximum = answer(engine, book, t, {"max", product, side, "106751991d"});
+                    check(maximum == (all.count == 0 ? 0 : all.max),
+                          "max " + product + " " + side + " 106751991d" + at);
+
+                    // between two full timestamps, each given as a date and a time
+                    std::size_t from = t / 2;
+                    Expected part = expect(orders, from, t);
+                    std::string fromDate = timestamps[from].substr(0, 10), fromTime = timestamps[from].substr(11);
+                    std::string toDate = timestamps[t].substr(0, 10), toTime = timestamps[t].substr(11);
+                    double lowest = answer(engine, book, t, {"min", product, side, "between", fromDate, fromTime,
+                                                             toDate, toTime});
+                    check(lowest == (part.count == 0 ? 0 : part.min),
+                          "min " + product + " " + side + " between " + timestamps[from] + " and " + timestamps[t]);
+                }
+            }
+        }
+    }
+
+    // Copy the orders of some products of the book into a store, grouped by (timestamp, product, order type) as in
+    // the book's own store.
+    void copyOrders(const OrderBook &book, const std::vector<std::string> &products, OrderStore &store) {
+        for (const std::string &timestamp: book.getTimestamps()) {
+            for (const std::string &product: products) {
+                for (OrderBookType type: {OrderBookType::bid, OrderBookType::ask}) {
+                    for (const OrderRow &row: book.getOrders(type, product, timestamp))
+                        store.append(row.price(), row.amount(), store.internTimestamp(timestamp),
+                                     store.products.intern(product), type);
+                }
+            }
+        }
+    }
+
+    // addRows() with rows of a product that is new gives the same totals as building the table from scratch.
+    void testNewProduct(const OrderBook &book) {
+        std::vector<std::string> products = book.getProducts();
+        std::string added = products.back();
+        products.pop_back();
+
+        OrderStore store;
+        copyOrders(book, products, store);
+        AggregateTable grown;
+        grown.build(store);
+        std::size_t firstRow = store.size();
+        copyOrders(book, {added}, store);
+        grown.addRows(store, firstRow);
+
+        AggregateTable built;
+        built.build(store);
+        std::uint32_t last = static_cast<std::uint32_t>(built.timestamps() - 1);
+        for (std::uint32_t p = 0; p < store.products.size(); ++p) {
+            for (OrderBookType type: {OrderBookType::bid, OrderBookType::ask}) {
+                std::string name = store.products.values()[p] + (type == OrderBookType::bid ? " bid" : " ask");
+                for (std::uint32_t first: {0u, last / 3, last / 2}) {
+                    WindowAggregate expected = built.window(p, type, first, last);
+                    WindowAggregate window = grown.window(p, type, first, last);
+                    std::string what = " after a new product of " + name + " from " + std::to_string(first);
+                    check(window.count == expected.count && window.steps == expected.steps, "window count" + what);
+                    // both add up the same buckets in the same order, so they agree exactly
+                    check(window.sum == expected.sum && window.minSum == expected.minSum &&
+                          window.maxSum == expected.maxSum && window.volume == expected.volume &&
+                          window.notional == expected.notional, "window totals" + what);
+                    PriceAggregate range = grown.range(p, type, first, last);
+                    PriceAggregate expectedRange = built.range(p, type, first, last);
+                    check(range.count == expectedRange.count && range.min == expectedRange.min &&
+                          range.max == expectedRange.max, "range" + what);
+                }
+            }
+        }
+    }
+
+    // A snapshot records the CSV file as it was before parsing: one written after rows were appended to the file
+    // during the parse is stale, and one of an unchanged file is read back.
+    void testSnapshot(const std::string &dataFile) {
+        std::string copy = dataFile + ".snapshot-test.csv";
+        std::string snapshotFile = Snapshot::pathFor(copy);
+        std::string lastLine;
+        {
+            std::ifstream in{dataFile};
+            std::ofstream out{copy, std::ios::trunc};
+            for (std::string line; std::getline(in, line);) {
+                out << line << '\n';
+                lastLine = line;
+            }
+        }
+
+        Snapshot::SourceInfo before;
+        OrderStore store;
+        {
+            Quiet quiet;
+            check(Snapshot::sourceInfo(copy, before), "sourceInfo of the copy of the data file");
+            CSVReader::load(copy, LoadOptions{}, store);
+        }
+        // the exchange appends to the file while it is being parsed
+        std::ofstream{copy, std::ios::app} << lastLine << '\n';
+
+        OrderStore readBack;
+        {
+            Quiet quiet;
+            check(Snapshot::write(snapshotFile, before, store), "snapshot written after the file grew");
+            check(!Snapshot::read(snapshotFile, copy, readBack), "snapshot of a file that grew while parsed is stale");
+
+            Snapshot::SourceInfo now;
+            Snapshot::sourceInfo(copy, now);
+            OrderStore whole;
+            CSVReader::load(copy, LoadOptions{}, whole);
+            check(Snapshot::write(snapshotFile, now, whole), "snapshot written of an unchanged file");
+            check(Snapshot::read(snapshotFile, copy, readBack) && readBack.size() == store.size() + 1,
+                  "snapshot of an unchanged file is read back");
+        }
+        std::remove(snapshotFile.c_str());
+        std::remove(copy.c_str());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: tests <data.csv>" << std::endl;
+        return 2;
+    }
+
+    LoadOptions options;
+    options.useSnapshot = false;
+    OrderBook book;
+    try {
+        Quiet quiet;
+        book.load(argv[1], options);
+    } catch (const std::exception &e) {
+        std::cerr << "tests: can't read " << argv[1] << ": " << e.what() << std::endl;
+        return 2;
+    }
+    if (book.getTimestamps().size() < 3) {
+        std::cerr << "tests: " << argv[1] << " needs at least 3 time steps" << std::endl;
+        return 2;
+    }
+
+    testWindows(book);
+    testNavigation(book);
+    testTimeWindows(book);
+    testNewProduct(book);
+    testSnapshot(argv[1]);
+
+    std::cout << checks - failures << " of " << checks << " checks passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+// include necessary C++ libraries and header files
+#include <cstdio>
+#include <limits>
+#include "Timestamp.h"
+
+namespace {
+    // Read exactly 'digits' decimal digits starting at 'pos'.
+    bool readNumber(std::string_view text, std::size_t pos, std::size_t digits, int &value) {
+        if (pos + digits > text.size())
+            return false;
+        value = 0;
+        for (std::size_t i = pos; i < pos + digits; ++i) {
+            if (text[i] < '0' || text[i] > '9')
+                return false;
+            value = value * 10 + (text[i] - '0');
+        }
+        return true;
+    }
+
+    // Number of days from 1970-01-01 to the given date of the proleptic Gregorian calendar.
+    std::int64_t daysFromCivil(int year, int month, int day) {
+        year -= month <= 2;
+        const int era = (year >= 0 ? year : year - 399) / 400;
+        const int yearOfEra = year - era * 400;
+        const int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return static_cast<std::int64_t>(era) * 146097 + dayOfEra - 719468;
+    }
+
+    // The inverse of daysFromCivil.
+    void civilFromDays(std::int64_t days, int &year, int &month, int &day) {
+        days += 719468;
+        const std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const int dayOfEra = static_cast<int>(days - era * 146097);
+        const int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        const int monthIndex = (5 * dayOfYear + 2) / 153;
+        day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+        month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        year = static_cast<int>(yearOfEra + era * 400) + (month <= 2);
+    }
+
+    int daysInMonth(int year, int month) {
+        static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        return month == 2 && leap ? 29 : days[month - 1];
+    }
+}
+
+// Parse the fixed-width fields of a timestamp by hand, which is much faster than going through a stream
+bool Timestamp::parse(std::string_view text, std::int64_t &micros) {
+    int year, month, day, hour, minute, secondOfMinute;
+    if (!readNumber(text, 0, 4, year) || (text.size() > 4 && text[4] != '/' && text[4] != '-') ||
+        !readNumber(text, 5, 2, month) || (text.size() > 7 && text[7] != text[4]) ||
+        !readNumber(text, 8, 2, day) || (text.size() > 10 && text[10] != ' ' && text[10] != 'T') ||
+        !readNumber(text, 11, 2, hour) || (text.size() > 13 && text[13] != ':') ||
+        !readNumber(text, 14, 2, minute) || (text.size() > 16 && text[16] != ':') ||
+        !readNumber(text, 17, 2, secondOfMinute))
+        return false;
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month) || hour > 23 || minute > 59 ||
+        secondOfMinute > 59)
+        return false;
+
+    // an optional fraction of a second, scaled to microseconds
+    std::int64_t fraction = 0;
+    if (text.size() > 19) {
+        std::size_t digits = text.size() - 20;
+        if (text[19] != '.' || digits == 0 || digits > 6)
+            return false;
+        int value;
+        if (!readNumber(text, 20, digits, value))
+            return false;
+        fraction = value;
+        for (std::size_t i = digits; i < 6; ++i) fraction *= 10;
+    }
+
+    std::int64_t seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + secondOfMinute;
+    micros = seconds * second + fraction;
+    return true;
+}
+
+// Split the microseconds into calendar fields and print them in the data file format
+std::string Timestamp::format(std::int64_t micros) {
+    std::int64_t seconds = micros / second;
+    std::int64_t fraction = micros % second;
+    if (fraction < 0) {
+        fraction += second;
+        --seconds;
+    }
+    std::int64_t days = seconds / 86400;
+    std::int64_t secondOfDay = seconds % 86400;
+    if (secondOfDay < 0) {
+        secondOfDay += 86400;
+        --days;
+    }
+
+    int year, month, day;
+    civilFromDays(days, year, month, day);
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%04d/%02d/%02d %02d:%02d:%02d.%06lld", year, month, day,
+                  static_cast<int>(secondOfDay / 3600), static_cast<int>(secondOfDay / 60 % 60),
+                  static_cast<int>(secondOfDay % 60), static_cast<long long>(fraction));
+    return buffer;
+}
+
+// Split the text into its number and its unit and scale the number by the unit
+bool Timestamp::parseDuration(std::string_view text, std::int64_t &micros) {
+    std::size_t digits = 0;
+    while (digits < text.size() && text[digits] >= '0' && text[digits] <= '9') ++digits;
+    // at most 18 digits, so that the number itself fits into 64 bits; whether it still does in microseconds is
+    // checked below
+    if (digits == 0 || digits > 18)
+        return false;
+
+    std::int64_t value = 0;
+    for (std::size_t i = 0; i < digits; ++i) value = value * 10 + (text[i] - '0');
+
+    std::string_view unit = text.substr(digits);
+    std::int64_t scale;
+    if (unit == "us") scale = 1;
+    else if (unit == "ms") scale = 1000;
+    else if (unit == "s") scale = second;
+    else if (unit == "m") scale = 60 * second;
+    else if (unit == "h") scale = 3600 * second;
+    else if (unit == "d") scale = 86400 * second;
+    else return false;
+
+    if (value == 0 || value > std::numeric_limits<std::int64_t>::max() / scale)
+        return false;
+    micros = value * scale;
+    return true;
+}
@@ -0,0 +1,31 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_TIMESTAMP_H
+#define ADVISORBOT_TIMESTAMP_H
+
+// include necessary standard C++ libraries
+#include <string>
+#include <cstdint>
+#include <string_view>
+
+// Conversions between the timestamps of the data files ("2020/06/01 11:57:30.328127", UTC) and microseconds
+// since the Unix epoch, so that times can be sorted, compared and subtracted as plain 64-bit integers.
+class Timestamp {
+    public:
+        // Parse "YYYY/MM/DD HH:MM:SS" with an optional fraction of up to 6 digits; '-' is accepted between the
+        // date fields and 'T' between date and time. Returns false if the text is not a valid timestamp.
+        static bool parse(std::string_view text, std::int64_t &micros);
+
+        // Format microseconds since the epoch in the data file format, with all 6 fractional digits.
+        static std::string format(std::int64_t micros);
+
+        // Parse a length of time such as "500ms", "30s", "5m", "2h" or "1d" (units us, ms, s, m, h and d) into
+        // microseconds. Returns false if the text is not a positive whole number followed by a unit, or if the
+        // length doesn't fit into 64 bits of microseconds.
+        static bool parseDuration(std::string_view text, std::int64_t &micros);
+
+        // Microseconds per second.
+        static const std::int64_t second = 1000000;
+};
+
+#endif //ADVISORBOT_TIMESTAMP_H
@@ -0,0 +1,110 @@
+// include necessary header files
+#include "WorkerPool.h"
+
+// Start the helper threads; the caller of run() is the remaining one
+WorkerPool::WorkerPool(unsigned threads) {
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+    for (unsigned i = 1; i < threads; ++i) {
+        this->threads.emplace_back([this] {
+            std::size_t seen = 0;
+            while (true) {
+                // sleep until there is a new batch, a job or the pool stops; a batch goes first, as its caller waits
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&] { return stopping || batch != seen || !jobs.empty(); });
+                    if (stopping)
+                        return;
+                    if (batch != seen) {
+                        seen = batch;
+                    } else {
+                        job = std::move(jobs.front());
+                        jobs.pop_front();
+                        ++runningJobs;
+                    }
+                }
+                if (!job) {
+                    work();
+                    continue;
+                }
+                job();
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--runningJobs == 0 && jobs.empty())
+                    idle.notify_all();
+            }
+        });
+    }
+}
+
+// Wake every thread to tell it to stop, then wait for them
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &t: threads) {
+        t.join();
+    }
+}
+
+// Publish the batch, help with it and wait until every task is finished
+void WorkerPool::run(std::size_t count, const std::function<void(std::size_t)> &task) {
+    if (count == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        this->count = count;
+        next = 0;
+        finished = 0;
+        ++batch;
+    }
+    wake.notify_all();
+    work();
+
+    // threads still busy with the last tasks finish them before the batch is cleared
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return finished == this->count; });
+    this->task = nullptr;
+}
+
+// Hand out task numbers one at a time, so a few slow tasks don't hold up the others. A number is taken and
+// reported under the lock, so run() can't return, and the task can't go away, while one is still running.
+void WorkerPool::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (task != nullptr && next < count) {
+        const std::function<void(std::size_t)> &current = *task;
+        std::size_t i = next++;
+        lock.unlock();
+        current(i);
+        lock.lock();
+        // the last one to finish wakes the caller
+        if (++finished == count)
+            done.notify_all();
+    }
+}
+
+// Hand the job to a sleeping helper thread, or run it here if there are none
+void WorkerPool::submit(std::function<void()> job) {
+    if (threads.empty()) {
+        job();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+void WorkerPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] { return runningJobs == 0 && jobs.empty(); });
+}
+
+// The helper threads plus the caller
+unsigned WorkerPool::size() const {
+    return static_cast<unsigned>(threads.size()) + 1;
+}
@@ -0,0 +1,70 @@
+// prevent header file from being included more than once
+#pragma once
+#ifndef ADVISORBOT_WORKERPOOL_H
+#define ADVISORBOT_WORKERPOOL_H
+
+// include necessary standard C++ libraries
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <cstddef>
+#include <functional>
+#include <condition_variable>
+
+// A fixed set of threads that work through numbered tasks together. The threads are started once and wait
+// between batches, so handing them many small batches costs no thread creation. The helper threads also run single
+// jobs that are submitted without waiting for them, in between batches.
+class WorkerPool {
+    public:
+        // Start the given number of threads (0 means one per hardware thread). The calling thread helps with
+        // every batch as well, so one fewer thread than requested is started.
+        explicit WorkerPool(unsigned threads = 0);
+
+        // Stop and join the threads.
+        ~WorkerPool();
+
+        // A pool owns its threads, so it can be neither copied nor assigned.
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+        // Call task(i) for every i in [0, count), spread over the threads, and return once all calls have
+        // finished. Every task must handle its own errors; tasks must not call run() themselves.
+        void run(std::size_t count, const std::function<void(std::size_t)> &task);
+
+        // Queue a job for the helper threads and return at once; jobs start in the order they were submitted. A
+        // pool without helper threads runs the job before returning. Jobs not yet started when the pool is destroyed
+        // are dropped. Every job must handle its own errors; jobs must not call run() themselves.
+        void submit(std::function<void()> job);
+
+        // Wait until every submitted job has finished.
+        void wait();
+
+        // Return the number of threads taking part in a batch, including the caller.
+        unsigned size() const;
+
+    private:
+        // Take tasks of the current batch until there are none left.
+        void work();
+
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        std::condition_variable idle;
+
+        // the current batch: its task, its size, the next task to hand out and the number finished
+        const std::function<void(std::size_t)> *task = nullptr;
+        std::size_t count = 0;
+        std::size_t next = 0;
+        std::size_t finished = 0;
+        // bumped for every batch so that sleeping threads notice a new one
+        std::size_t batch = 0;
+        bool stopping = false;
+
+        // the submitted jobs not yet started, and the number running
+        std::deque<std::function<void()>> jobs;
+        std::size_t runningJobs = 0;
+};
+
+#endif //ADVISORBOT_WORKERPOOL_H
@@ -1,15 +1,166 @@
 /*"main.cpp" is the main entry point for the program. It includes necessary headers and creates 
-an instance of the AdvisorMain class. It then calls the init function of the AdvisorMain class.*/
+an instance of the AdvisorMain class. It then calls the init function of the AdvisorMain class.
+With --batch it instead runs a script of commands and writes machine-readable results, with --serve it
+answers the commands of many clients over a socket, and with --backtest it scores the predict models.
+With --storage blocks a data file too large for memory is kept in column blocks on disk instead, and with
+--stats-file the metrics of the run are written to a file in the Prometheus text format every --stats-interval
+seconds and once more on exit.*/
 
+// for the command line options and the batch script
+#include <memory>
+#include <string>
+#include <fstream>
+#include <iostream>
 // for AdvisorMain class
 #include "AdvisorMain.h"
+// for the metrics dump file
+#include "Metrics.h"
 
-int main() {
-    // create an instance of AdvisorMain class
-    AdvisorMain app{};
+// writes the metrics dump file; a static, so that the last dump also happens when the bot exits with exit()
+static std::unique_ptr<MetricsDumper> metricsDumper;
 
-    // call the init function of AdvisorMain
-    app.init();
+// print how to run the program
+static int usage() {
+    std::cerr << "usage: advisorbot [--data <file|directory>] [--memory MB] [--storage memory|blocks] "
+                 "[--batch <file|-> | --serve unix:<path>|tcp:<port> | --backtest <file|->] [--format json|csv] "
+                 "[--threads N] [--stats-file <file>] [--stats-interval seconds]" << std::endl;
+    return 2;
+}
+
+int main(int argc, char *argv[]) {
+    // read the command line options; without --batch or --serve the bot is interactive
+    std::string dataFile = CSVDATAFILE;
+    std::size_t memoryBudget = std::size_t(CATALOGMEMORYMB) * 1024 * 1024;
+    std::string batchFile;
+    std::string serverAddress;
+    std::string backtestFile;
+    bool blockStorage = false;
+    std::string statsFile;
+    long statsInterval = 10;
+    BatchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        // every option takes a value
+        if (i + 1 >= argc)
+            return usage();
+        std::string value = argv[++i];
+        if (arg == "--data") {
+            dataFile = value;
+        } else if (arg == "--batch") {
+            batchFile = value;
+        } else if (arg == "--serve") {
+            serverAddress = value;
+        } else if (arg == "--backtest") {
+            backtestFile = value;
+        } else if (arg == "--format") {
+            if (!BatchRunner::parseFormat(value, options.format))
+                return usage();
+        } else if (arg == "--storage") {
+            if (value != "memory" && value != "blocks")
+                return usage();
+            blockStorage = value == "blocks";
+        } else if (arg == "--memory") {
+            try {
+                memoryBudget = static_cast<std::size_t>(std::stoul(value)) * 1024 * 1024;
+            } catch (const std::exception &e) {
+                return usage();
+            }
+        } else if (arg == "--stats-file") {
+            statsFile = value;
+        } else if (arg == "--stats-interval") {
+            try {
+                statsInterval = std::stol(value);
+            } catch (const std::exception &e) {
+                return usage();
+            }
+            if (statsInterval <= 0)
+                return usage();
+        } else if (arg == "--threads") {
+            try {
+                options.threads = static_cast<unsigned>(std::stoul(value));
+            } catch (const std::exception &e) {
+                return usage();
+            }
+        } else {
+            return usage();
+        }
+    }
+
+    if ((!batchFile.empty()) + (!serverAddress.empty()) + (!backtestFile.empty()) > 1)
+        return usage();
+
+    if (!statsFile.empty())
+        metricsDumper = std::make_unique<MetricsDumper>(statsFile, std::chrono::seconds(statsInterval));
+
+    if (!backtestFile.empty()) {
+        // the scores go to the file or standard output, everything else the program prints to standard error
+        std::ofstream file;
+        if (backtestFile != "-") {
+            file.open(backtestFile);
+            if (!file.is_open()) {
+                std::cerr << "Could not open " << backtestFile << std::endl;
+                return 2;
+            }
+        }
+        std::ostream scores(backtestFile == "-" ? std::cout.rdbuf() : file.rdbuf());
+        std::cout.rdbuf(std::cerr.rdbuf());
+
+        AdvisorMain app{dataFile, memoryBudget, blockStorage};
+        try {
+            app.runBacktest(scores, options);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return 2;
+        }
+        return 0;
+    }
+
+    if (!serverAddress.empty()) {
+        // load the order book once and share it with every client
+        AdvisorMain app{dataFile, memoryBudget, blockStorage};
+        try {
+            app.serve(ServerOptions{serverAddress, options.format, options.threads});
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (batchFile.empty()) {
+        // create an instance of AdvisorMain class
+        AdvisorMain app{dataFile, memoryBudget, blockStorage};
+
+        // call the init function of AdvisorMain
+        app.init();
+
+        return 0;
+    }
+
+    // read the script from stdin or a file
+    std::ifstream file;
+    if (batchFile != "-") {
+        file.open(batchFile);
+        if (!file.is_open()) {
+            std::cerr << "Could not open " << batchFile << std::endl;
+            return 2;
+        }
+    }
+    std::istream &input = batchFile == "-" ? std::cin : file;
+
+    // the results go to standard output; everything else the program prints (such as load progress) is sent to
+    // standard error so that it doesn't mix with them
+    std::ostream results(std::cout.rdbuf());
+    std::cout.rdbuf(std::cerr.rdbuf());
 
-    return 0;
+    AdvisorMain app{dataFile, memoryBudget, blockStorage};
+    std::size_t failed = 0;
+    try {
+        failed = app.runBatch(input, results, options);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+    // exit with 1 if any command failed
+    return failed == 0 ? 0 : 1;
 }